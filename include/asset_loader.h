@@ -0,0 +1,41 @@
+#ifndef INCLUDE_ASSET_LOADER_H
+#define INCLUDE_ASSET_LOADER_H
+
+#include <allegro5/allegro5.h>
+
+#define ASSET_LOADER_MAX_THREADS 8
+#define ASSET_LOADER_MAX_JOBS    64
+
+typedef enum asset_state {
+    ASSET_FREE,
+    ASSET_PENDING,
+    ASSET_READY,
+    ASSET_FAILED
+} Asset_State;
+
+/*
+* Handle to an asset being decoded on the loader pool. Once the future is done
+* the caller owns the (memory) bitmap and must release the future.
+*/
+typedef struct asset_future {
+    const char* name;
+    ALLEGRO_BITMAP* bitmap;
+    Asset_State state;
+    double decode_ms;
+} Asset_Future;
+
+int asset_loader_start(int thread_count);
+
+void asset_loader_stop();
+
+int asset_loader_thread_count();
+
+Asset_Future* asset_loader_request(const char* name);
+
+bool asset_future_is_done(Asset_Future* future);
+
+ALLEGRO_BITMAP* asset_future_wait(Asset_Future* future);
+
+void asset_future_release(Asset_Future* future);
+
+#endif
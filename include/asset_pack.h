@@ -0,0 +1,51 @@
+#ifndef INCLUDE_ASSET_PACK_H
+#define INCLUDE_ASSET_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <allegro5/allegro5.h>
+
+#define ASSET_PACK_FILE      "assets.pak"
+#define ASSET_PACK_MAGIC     0x4B505A57  /* "WZPK" little endian */
+#define ASSET_PACK_VERSION   1
+#define ASSET_NAME_SIZE      32
+#define ASSET_PACK_ALIGNMENT 16
+#define ASSET_PACK_MAX_SIDE  16384       /* largest packed image width or height */
+
+/*
+* On disk layout: header, entry index, then pixel blobs. Every blob is tightly
+* packed 32 bit RGBA (ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE) rows, aligned to
+* ASSET_PACK_ALIGNMENT bytes from the start of the file.
+*/
+typedef struct asset_pack_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+} Asset_Pack_Header;
+
+typedef struct asset_pack_entry {
+    char name[ASSET_NAME_SIZE];
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;
+    uint32_t size;
+} Asset_Pack_Entry;
+
+int asset_path(const char* file_name, char* out, size_t out_size);
+
+const unsigned char* map_file(const char* path, size_t* size);
+
+void unmap_file(const unsigned char* data, size_t size);
+
+int asset_pack_open(const char* path);
+
+void asset_pack_close();
+
+bool asset_pack_is_open();
+
+ALLEGRO_BITMAP* asset_pack_load_bitmap(const char* name);
+
+ALLEGRO_BITMAP* load_asset_bitmap(const char* name);
+
+#endif
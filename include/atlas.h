@@ -0,0 +1,68 @@
+#ifndef INCLUDE_ATLAS_H
+#define INCLUDE_ATLAS_H
+
+#include <allegro5/allegro5.h>
+
+#define ATLAS_MAX_WIDTH  1024
+#define ATLAS_PADDING    2
+#define ATLAS_MAX_FRAMES 64
+
+/* Every sprite sheet and tile set packed into the atlas */
+typedef enum atlas_sprite {
+    SPR_NONE = -1,
+    SPR_WIZARD,
+    SPR_SLIME,
+    SPR_DOOR,
+    SPR_FIREBOLT,
+    SPR_CROSSHAIR,
+    SPR_FOREST_TILES,
+    SPR_COUNT
+} Atlas_Sprite;
+
+/* Sub-rectangle of the atlas texture, in atlas pixel coordinates */
+typedef struct atlas_region {
+    int x, y, width, height;
+} Atlas_Region;
+
+/* Time spent decoding and packing the atlas, for startup profiling */
+typedef struct atlas_load_stats {
+    double asset_ms[SPR_COUNT];
+    double total_ms;
+    bool from_pack;
+} Atlas_Load_Stats;
+
+int atlas_request_assets();
+
+bool atlas_assets_ready();
+
+int atlas_build();
+
+int atlas_build_headless();
+
+int atlas_initialize();
+
+void atlas_destroy();
+
+Atlas_Load_Stats atlas_load_stats();
+
+const char* atlas_sprite_name(Atlas_Sprite sprite);
+
+bool atlas_is_initialized();
+
+ALLEGRO_BITMAP* atlas_bitmap();
+
+ALLEGRO_BITMAP* atlas_sub_bitmap(Atlas_Sprite sprite);
+
+int atlas_frame_count(Atlas_Sprite sprite);
+
+int atlas_frame_columns(Atlas_Sprite sprite);
+
+Atlas_Region atlas_sprite_region(Atlas_Sprite sprite);
+
+Atlas_Region atlas_frame(Atlas_Sprite sprite, int frame);
+
+void atlas_draw_frame(Atlas_Sprite sprite, int frame, float dx, float dy, int flags);
+
+void atlas_draw_rotated_frame(Atlas_Sprite sprite, int frame, float cx, float cy, float dx, float dy, float angle, int flags);
+
+#endif
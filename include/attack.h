@@ -2,21 +2,54 @@
 #define INCLUDE_ATTACK_H
 
 #include "collisions.h"
+#include "overlay.h"
+#include "mob_handler.h"
+#include "tile_map.h"
+
+#define MAX_PROJECTILES 256
 
 typedef struct projectile {
     int x, y, r, id, damage;
+    int prev_x, prev_y;
     double xspeed, yspeed;
     bool live;
     Hitbox hb;
 } Projectile;
 
+typedef enum projectile_hit_type {
+    HIT_NONE,
+    HIT_MOB,
+    HIT_WALL
+} Projectile_Hit_Type;
+
+/* Every projectile in flight, spawned by spells */
+typedef struct projectile_pool {
+    Projectile projectiles[MAX_PROJECTILES];
+    int next_free;      /* where the search for a free slot starts */
+} Projectile_Pool;
+
+/* Result of sweeping a projectile along one tick of movement */
+typedef struct projectile_hit {
+    Projectile_Hit_Type type;
+    int mob_index;
+    double toi;
+} Projectile_Hit;
+
 Projectile initialize_projectile(int r, int damage);
 
 void fire_projectile(Projectile* bullet, int startx, int starty, int endx, int endy, int speed);
 
-void update_projectile(Projectile* bullet);
+void launch_projectile(Projectile* bullet, int startx, int starty, double xspeed, double yspeed);
+
+void initialize_projectile_pool(Projectile_Pool* pool);
+
+Projectile* spawn_projectile(Projectile_Pool* pool, int startx, int starty, double xspeed, double yspeed, int r, int damage);
+
+Projectile_Hit update_projectile(Projectile* bullet, Mob_Handler* handler, Solid_Map* tiles, Hitbox walls[], int wall_count);
+
+void draw_projectile(Projectile* bullet, double alpha);
 
-void draw_projectile(Projectile* bullet);
+void draw_projectile_overlay(Overlay* ov, Projectile* bullet, bool hitboxes);
 
 
 #endif
\ No newline at end of file
@@ -15,6 +15,6 @@ void update_hitbox_position(Hitbox* hb, int new_pos_x, int new_pos_y);
 
 bool is_collision(Hitbox* hb1, Hitbox* hb2);
 
-void draw_hitbox(Hitbox* hb, ALLEGRO_COLOR color);
+bool swept_collision(Hitbox* moving, double dx, double dy, Hitbox* target, double* toi);
 
 #endif
@@ -0,0 +1,67 @@
+#ifndef INCLUDE_COMBAT_H
+#define INCLUDE_COMBAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "frame_arena.h"
+
+#define COMBAT_QUEUE_SIZE 512   /* events each producer can emit in a tick */
+#define COMBAT_PLAYER     -1    /* target or source that is the player, not a mob */
+
+/* Resolved in this order, whatever order they were detected in */
+typedef enum combat_event_type {
+    CE_HIT,         /* a projectile hit a mob */
+    CE_CONTACT,     /* a mob touched the player */
+    CE_DEATH,       /* a mob's health ran out, emitted while resolving */
+    CE_PICKUP,      /* the player picked something up */
+    CE_TYPE_COUNT
+} Combat_Event_Type;
+
+typedef enum pickup_kind {
+    PICKUP_KEY
+} Pickup_Kind;
+
+typedef struct combat_event {
+    Combat_Event_Type type;
+    int target;             /* mob index or COMBAT_PLAYER */
+    int source;             /* projectile or mob index, or the pickup kind */
+    float amount;           /* damage */
+    float x, y;             /* where it happened, for effects */
+    float dir_x, dir_y;
+    uint32_t sequence;      /* producer and emit order, the final tie break */
+} Combat_Event;
+
+/*
+* Each producer owns one queue, so detection passes can run on separate
+* threads without sharing anything.
+*/
+typedef enum combat_producer {
+    CP_CONTACT,
+    CP_PROJECTILES,
+    CP_INTERACT,
+    CP_RESOLVE,     /* events that resolving other events produces */
+    CP_COUNT
+} Combat_Producer;
+
+typedef struct combat_queue {
+    Combat_Event events[COMBAT_QUEUE_SIZE];
+    int count;
+    int dropped;
+} Combat_Queue;
+
+typedef struct combat_bus {
+    Combat_Queue queues[CP_COUNT];
+    int resolved;           /* events applied last tick */
+    int dropped;            /* events that didn't fit, ever */
+} Combat_Bus;
+
+void combat_bus_initialize(Combat_Bus* bus);
+
+bool combat_emit(Combat_Bus* bus, Combat_Producer producer, Combat_Event event);
+
+Combat_Event* combat_collect(Combat_Bus* bus, Combat_Producer first, Combat_Producer last, Frame_Arena* scratch, int* count);
+
+void combat_bus_clear(Combat_Bus* bus);
+
+#endif
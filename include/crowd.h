@@ -0,0 +1,79 @@
+#ifndef INCLUDE_CROWD_H
+#define INCLUDE_CROWD_H
+
+#include <stdbool.h>
+#include <allegro5/allegro5.h>
+
+#include "mob.h"
+#include "frame_arena.h"
+
+#define CROWD_CELL_SIZE      64     /* px, mobs wider than this are treated as this wide */
+#define CROWD_MAX_ITERATIONS 2
+#define CROWD_STIFFNESS      0.5f   /* share of an overlap each mob of the pair resolves per pass */
+#define CROWD_SETTLED        0.5f   /* px, overlaps below this are left alone */
+#define CROWD_MAX_THREADS    8
+
+typedef struct crowd_stats {
+    int mobs;
+    int pairs;              /* overlapping pairs seen in the first pass */
+    int iterations;
+    float worst_overlap;    /* px, in the last pass */
+    double solve_ms;
+} Crowd_Stats;
+
+struct crowd_solver;
+
+/* What each worker thread is handed: its solver and the band of rows it owns */
+typedef struct crowd_band {
+    struct crowd_solver* solver;
+    int band;
+} Crowd_Band;
+
+/*
+* Soft collision between mobs. Mobs are circles binned into a uniform grid,
+* and each pass moves every mob away from the neighbors it overlaps using only
+* the positions from the previous pass. No mob writes anything another mob
+* reads in the same pass, so the grid is split into bands of rows that run on
+* separate threads, and the result doesn't depend on how many there are.
+*/
+typedef struct crowd_solver {
+    /* Set up by each solve in the caller's scratch arena */
+    Mob* mobs;
+    int grid_cols, grid_rows;
+    int max_px, max_py;
+    int* cell_start;        /* first entry of each cell in order, one extra at the end */
+    int* order;             /* active mob indices sorted by cell */
+    int active;
+    float* x;               /* centers this pass reads */
+    float* y;
+    float* next_x;          /* centers this pass writes */
+    float* next_y;
+    float* radius;
+    float* sorted_x;        /* the same, in order, for the neighbor scans */
+    float* sorted_y;
+    float* sorted_radius;
+
+    /* Per band results, so workers never share a counter */
+    int band_pairs[CROWD_MAX_THREADS];
+    float band_worst[CROWD_MAX_THREADS];
+
+    int threads;
+    Crowd_Band bands[CROWD_MAX_THREADS];
+    ALLEGRO_THREAD* workers[CROWD_MAX_THREADS];
+    ALLEGRO_MUTEX* mutex;
+    ALLEGRO_COND* work_cond;
+    ALLEGRO_COND* done_cond;
+    int generation;         /* bumped to start a pass on the workers */
+    int pending;            /* workers still running the current pass */
+    bool stopping;
+
+    Crowd_Stats stats;
+} Crowd_Solver;
+
+int crowd_create(Crowd_Solver* cs, int threads);
+
+void crowd_destroy(Crowd_Solver* cs);
+
+int crowd_separate(Crowd_Solver* cs, Mob* mobs, int count, int max_px, int max_py, Frame_Arena* scratch);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef INCLUDE_FRAME_ARENA_H
+#define INCLUDE_FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "mem_track.h"
+
+#define FRAME_ARENA_ALIGN 16    /* every allocation starts on this boundary */
+
+/*
+* Linear scratch memory for one thread's frames or ticks. Allocating bumps an
+* offset, and resetting at the end of a frame just flips to the other buffer,
+* so anything allocated this frame is still valid through the next one (long
+* enough for a snapshot built from it to be consumed). Not thread safe, each
+* thread owns its arena.
+*/
+typedef struct frame_arena {
+    unsigned char* buffers[2];
+    size_t capacity;        /* bytes in each buffer */
+    size_t used;            /* bytes handed out from the current buffer */
+    int current;
+    size_t last_used;       /* bytes the last finished frame used */
+    size_t high_water;      /* most bytes any frame has used */
+    int failed;             /* allocations that didn't fit, ever */
+    Mem_Tag tag;
+} Frame_Arena;
+
+int frame_arena_create(Frame_Arena* arena, size_t capacity, Mem_Tag tag);
+
+void frame_arena_destroy(Frame_Arena* arena);
+
+void frame_arena_reset(Frame_Arena* arena);
+
+/*
+* Scratch memory that lives until the end of the next frame, or NULL if this
+* frame is out of room. Never falls back to the heap.
+*/
+static inline void* frame_arena_alloc(Frame_Arena* arena, size_t size) {
+    size_t start = (arena->used + FRAME_ARENA_ALIGN - 1) & ~(size_t)(FRAME_ARENA_ALIGN - 1);
+    if(start + size > arena->capacity || !arena->buffers[arena->current]) {
+        arena->failed++;
+        return NULL;
+    }
+    arena->used = start + size;
+    return arena->buffers[arena->current] + start;
+}
+
+#define FRAME_ARENA_ARRAY(arena, type, count) ((type*)frame_arena_alloc(arena, sizeof(type) * (count)))
+
+#endif
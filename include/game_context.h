@@ -0,0 +1,24 @@
+#ifndef INCLUDE_GAME_CONTEXT_H
+#define INCLUDE_GAME_CONTEXT_H
+
+#include <stdint.h>
+
+#include "random.h"
+#include "mob_handler.h"
+#include "terrain.h"
+
+/*
+* Everything a game's floors and rooms share while it runs: its random
+* stream, the mobs of the loaded room and that room's tiles. Each simulation
+* owns one and passes it down to whatever generates or loads rooms, so games
+* never share mutable state and any number of them can run in one process.
+*/
+struct game_context {
+    Rng rng;
+    Mob_Handler mobs;       /* the loaded room's, every room on the floor points here */
+    Room_Tiles tiles;       /* the loaded room's, rebuilt from its seed */
+};
+
+void game_context_initialize(Game_Context* game, uint64_t seed);
+
+#endif
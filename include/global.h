@@ -9,11 +9,12 @@
 #define OK     0
 #define ERROR -1
 
-extern bool show_hitboxes;
+typedef enum game_state {
+    GS_RUNNING,
+    GS_MENU
+} Game_State;
 
 int constrain(int min, int max, int val);
 float constrain_f(float min, float max, float val);
 
-void toggle_hitboxes();
-
 #endif
\ No newline at end of file
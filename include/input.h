@@ -0,0 +1,99 @@
+#ifndef INCLUDE_INPUT_H
+#define INCLUDE_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <allegro5/allegro5.h>
+
+#define INPUT_RING_SIZE 256   /* must be a power of two */
+
+/* Gameplay actions, raw keycodes never leave input.c */
+typedef enum input_action {
+    ACT_MOVE_UP,
+    ACT_MOVE_DOWN,
+    ACT_MOVE_LEFT,
+    ACT_MOVE_RIGHT,
+    ACT_FIRE_PRIMARY,
+    ACT_FIRE_SECONDARY,
+    ACT_INTERACT,
+    ACT_CONFIRM,
+    ACT_QUIT,
+    ACT_DEV_TOOLS,
+    ACT_TOGGLE_HITBOXES,
+    ACT_KILL_ROOM,
+    ACT_QUICKSAVE,
+    ACT_QUICKLOAD,
+    ACT_REWIND_PAUSE,
+    ACT_STEP_BACK,
+    ACT_STEP_FORWARD,
+    ACT_COUNT,
+    ACT_NONE = 0xFF
+} Input_Action;
+
+typedef enum input_event_type {
+    INPUT_ACTION_DOWN,
+    INPUT_ACTION_UP,
+    INPUT_MOUSE_MOVE
+} Input_Event_Type;
+
+/* One device event, stamped with the time allegro received it */
+typedef struct input_event {
+    double timestamp;
+    uint8_t type;
+    uint8_t action;
+    bool has_position;
+    int16_t x, y;
+} Input_Event;
+
+/*
+* Lock-free single producer (render/event thread) / single consumer
+* (simulation thread) ring of input events.
+*/
+typedef struct input_ring {
+    Input_Event events[INPUT_RING_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+} Input_Ring;
+
+/*
+* Action state for one simulation tick, one bit per action. 'pressed' and
+* 'released' only hold the edges seen during this tick.
+*/
+typedef struct input_state {
+    uint32_t held;
+    uint32_t pressed;
+    uint32_t released;
+    int mouse_x, mouse_y;
+    double press_time[ACT_COUNT];
+    double oldest_event_time;
+    int events_this_tick;
+} Input_State;
+
+void input_ring_initialize(Input_Ring* ring);
+
+bool input_translate_event(ALLEGRO_EVENT* event, Input_Event* out);
+
+bool input_push(Input_Ring* ring, Input_Event* event);
+
+bool input_pop(Input_Ring* ring, Input_Event* event);
+
+Input_State default_input_state();
+
+void input_begin_tick(Input_State* state, Input_Ring* ring);
+
+void input_clear(Input_State* state);
+
+static inline bool input_down(Input_State* state, Input_Action action) {
+    return ((state->held | state->pressed) >> action) & 1;
+}
+
+static inline bool input_pressed(Input_State* state, Input_Action action) {
+    return (state->pressed >> action) & 1;
+}
+
+static inline bool input_released(Input_State* state, Input_Action action) {
+    return (state->released >> action) & 1;
+}
+
+#endif
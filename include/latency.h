@@ -0,0 +1,69 @@
+#ifndef INCLUDE_LATENCY_H
+#define INCLUDE_LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LATENCY_PENDING      16     /* samples carried in every snapshot */
+#define LATENCY_BUCKET_MS    2.0
+#define LATENCY_BUCKETS      50     /* last bucket also counts everything slower */
+
+typedef enum latency_kind {
+    LAT_FIRE,
+    LAT_MOVE,
+    LAT_KIND_COUNT
+} Latency_Kind;
+
+/*
+* One input that changed the simulation. Stamped when allegro received the
+* event and when the tick that consumed it ran. Ids start at 1, 0 marks an
+* empty slot.
+*/
+typedef struct latency_sample {
+    uint32_t id;
+    Latency_Kind kind;
+    int64_t tick;
+    double input_time;
+    double tick_time;
+} Latency_Sample;
+
+/* Simulation side: the most recent samples, copied into every snapshot */
+typedef struct latency_queue {
+    Latency_Sample samples[LATENCY_PENDING];
+    uint32_t next_id;
+} Latency_Queue;
+
+typedef struct latency_histogram {
+    int buckets[LATENCY_BUCKETS];
+    int count;
+    double total_ms;
+    double min_ms, max_ms;
+} Latency_Histogram;
+
+/* Render side: input to present histograms, plus an optional csv log */
+typedef struct latency_recorder {
+    Latency_Histogram histograms[LAT_KIND_COUNT];
+    uint32_t last_id;
+    FILE* log;
+} Latency_Recorder;
+
+void latency_queue_initialize(Latency_Queue* q);
+
+void latency_queue_push(Latency_Queue* q, Latency_Kind kind, int64_t tick, double input_time, double tick_time);
+
+int latency_recorder_initialize(Latency_Recorder* r, const char* log_path);
+
+void latency_recorder_close(Latency_Recorder* r);
+
+int latency_record_presented(Latency_Recorder* r, const Latency_Sample samples[LATENCY_PENDING], double present_time);
+
+double latency_mean(Latency_Histogram* h);
+
+double latency_percentile(Latency_Histogram* h, double p);
+
+const char* latency_kind_name(Latency_Kind kind);
+
+void latency_print_report(Latency_Recorder* r);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef INCLUDE_LOG_H
+#define INCLUDE_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Severity levels, numeric so they can be compared by the preprocessor */
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE  4
+
+/* Calls below this level are compiled out entirely, e.g. -DLOG_COMPILE_LEVEL=2 */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_RING_SIZE     1024  /* records, must be a power of two */
+#define LOG_MESSAGE_SIZE  160
+#define LOG_RATE_LIMIT    5     /* messages per call site per window */
+#define LOG_RATE_WINDOW   1000  /* milliseconds */
+
+/*
+* Per call site rate limit state. Every LOG_* macro gets its own static one,
+* so a message repeated every tick only costs a few atomic ops once it is
+* being suppressed.
+*/
+typedef struct log_limiter {
+    int64_t window_start;   /* milliseconds */
+    int count;
+    int suppressed;
+} Log_Limiter;
+
+typedef struct log_stats {
+    uint64_t written;       /* records the log thread wrote out */
+    uint64_t dropped;       /* records lost because the ring was full */
+    uint64_t suppressed;    /* messages collapsed by rate limiting */
+} Log_Stats;
+
+int log_start(const char* path, int echo_level);
+
+void log_stop();
+
+void log_set_level(int level);
+
+void log_write(int level, const char* func, Log_Limiter* limiter, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+Log_Stats log_stats();
+
+#define LOG_AT(level, ...) do { \
+        static Log_Limiter log_limiter_; \
+        log_write(level, __func__, &log_limiter_, __VA_ARGS__); \
+    } while(0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while(0)
+#endif
+
+#endif
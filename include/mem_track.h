@@ -0,0 +1,54 @@
+#ifndef INCLUDE_MEM_TRACK_H
+#define INCLUDE_MEM_TRACK_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <allegro5/allegro5.h>
+
+#define MEM_MAX_BITMAPS 256
+
+/* Subsystem every tracked allocation and bitmap is charged to */
+typedef enum mem_tag {
+    MEM_TERRAIN,
+    MEM_MOBS,
+    MEM_ATTACK,
+    MEM_SPELLS,
+    MEM_PARTICLES,
+    MEM_SIM,
+    MEM_ASSETS,
+    MEM_UI,
+    MEM_TAG_COUNT
+} Mem_Tag;
+
+typedef struct mem_tag_stats {
+    int64_t live_bytes;         /* heap bytes currently allocated */
+    int64_t peak_bytes;
+    int64_t live_allocations;
+    int64_t total_allocations;
+    int64_t bitmap_bytes;       /* estimated, 4 bytes a pixel, sub bitmaps are free */
+    int bitmaps;
+} Mem_Tag_Stats;
+
+void* mem_alloc(Mem_Tag tag, size_t size, const char* file, int line);
+
+void* mem_calloc(Mem_Tag tag, size_t count, size_t size, const char* file, int line);
+
+void mem_free(void* ptr);
+
+ALLEGRO_BITMAP* mem_track_bitmap(Mem_Tag tag, ALLEGRO_BITMAP* bmp, const char* file, int line);
+
+void mem_destroy_bitmap(ALLEGRO_BITMAP* bmp);
+
+Mem_Tag_Stats mem_tag_stats(Mem_Tag tag);
+
+const char* mem_tag_name(Mem_Tag tag);
+
+int mem_report_leaks(FILE* out);
+
+#define MEM_ALLOC(tag, size)            mem_alloc(tag, size, __FILE__, __LINE__)
+#define MEM_CALLOC(tag, count, size)    mem_calloc(tag, count, size, __FILE__, __LINE__)
+#define MEM_TRACK_BITMAP(tag, bmp)      mem_track_bitmap(tag, bmp, __FILE__, __LINE__)
+
+#endif
@@ -2,10 +2,14 @@
 #define INCLUDE_MOB_H
 
 #include "collisions.h"
+#include "overlay.h"
+#include "atlas.h"
+#include "input.h"
 
 #define PLAYER_WIDTH  64
 #define PLAYER_HEIGHT 64
 #define PLAYER_SPEED  8
+#define SLIME_SPEED   8     /* until spawn_mobs rolls one */
 
 /* Should help support animations later on */
 typedef enum animation_state {
@@ -24,6 +28,7 @@ typedef enum mob_type {
 
 typedef struct mob {
     int position[2];
+    int prev_position[2];
     int id;
     int width;
     int height;
@@ -37,16 +42,24 @@ typedef struct mob {
     STATE current_state;
     int last_animation_frame;
     float animation_tracker;
-    ALLEGRO_BITMAP* sprite;
+    Atlas_Sprite sprite;
 
-    void (*update)(unsigned char key[], struct mob* self, int max_px, int max_py);
-    void (*draw)(struct mob* self, double delta_time);
+    void (*update)(Input_State* input, struct mob* self, int max_px, int max_py);
+    void (*draw)(struct mob* self, double alpha);
 } Mob;
 
 Mob default_mob();
 
 Mob initialize_mob(MOB_TYPE type, int id, int start_x, int start_y);
 
+void bind_mob_functions(Mob* m);
+
 void move_mob(Mob* mob, int new_xpos, int new_ypos);
 
+void animate_mob(Mob* m, double delta_time);
+
+void interpolate_mob_position(Mob* mob, double alpha, float out[2]);
+
+void draw_mob_overlay(Overlay* ov, Mob* m, double alpha, bool hitboxes);
+
 #endif
\ No newline at end of file
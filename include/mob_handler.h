@@ -9,6 +9,7 @@
 
 #include "mob.h"
 #include "global.h"
+#include "random.h"
 
 #define ABSOLUTE_MAX_MOBS 100
 
@@ -31,8 +32,8 @@ int remove_mob(Mob_Handler* handler, Mob* mob);
 
 void update_all_active_mobs(Mob_Handler* handler, int max_px, int max_py);
 
-void draw_all_active_mobs(Mob_Handler* handler, double delta_time);
+void draw_all_active_mobs(Mob_Handler* handler, double alpha);
 
-void spawn_mobs(Mob_Handler* handler, int max_px, int max_py, int floor_number);
+void spawn_mobs(Mob_Handler* handler, Rng* rng, int max_px, int max_py, int floor_number);
 
 #endif
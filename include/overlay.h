@@ -0,0 +1,73 @@
+#ifndef INCLUDE_OVERLAY_H
+#define INCLUDE_OVERLAY_H
+
+#include <stdbool.h>
+#include <allegro5/allegro5.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_primitives.h>
+
+#include "collisions.h"
+
+#define OVERLAY_MAX_QUADS  32768    /* bars, outlines and glyphs in one frame */
+#define OVERLAY_TEXT_SLOTS 128
+#define OVERLAY_TEXT_MAX   128      /* characters in one cached line */
+#define OVERLAY_KEY_MAX    8        /* inputs a cached line is keyed on */
+#define OVERLAY_GLYPHS     96       /* ascii 32..126, the last cell is solid for untextured quads */
+
+/*
+* One line of text formatted only when the inputs it is keyed on change.
+*/
+typedef struct overlay_text {
+    double key[OVERLAY_KEY_MAX];
+    int key_count;
+    bool valid;
+    int length;
+    char text[OVERLAY_TEXT_MAX];
+} Overlay_Text;
+
+typedef struct overlay_stats {
+    int quads;
+    int dropped;            /* quads that didn't fit this frame */
+    int texts;              /* lines drawn */
+    int formatted;          /* of those, lines whose inputs changed */
+} Overlay_Stats;
+
+/*
+* Everything drawn over the world: health bars, hitbox outlines, the minimap
+* and the dev tools. Bars and outlines are solid quads cut from one cell of
+* the glyph atlas, so the whole frame is a single indexed draw with a single
+* texture.
+*/
+typedef struct overlay {
+    ALLEGRO_BITMAP* atlas;      /* every glyph of the font, plus a solid cell */
+    int cell_width, cell_height;
+    int glyph_advance[OVERLAY_GLYPHS];
+    ALLEGRO_VERTEX* vertices;   /* four per quad */
+    int* indices;               /* six per quad, built once */
+    int quad_count;
+    Overlay_Text texts[OVERLAY_TEXT_SLOTS];
+    Overlay_Stats stats, last_stats;
+} Overlay;
+
+/* Inputs a line of overlay_textf is keyed on, any numbers */
+#define OVERLAY_KEY(...) ((const double[]){__VA_ARGS__}), (int)(sizeof((const double[]){__VA_ARGS__}) / sizeof(double))
+
+int overlay_create(Overlay* ov, ALLEGRO_FONT* font);
+
+void overlay_destroy(Overlay* ov);
+
+void overlay_begin(Overlay* ov);
+
+void overlay_rect(Overlay* ov, float x0, float y0, float x1, float y1, ALLEGRO_COLOR color);
+
+void overlay_outline(Overlay* ov, float x0, float y0, float x1, float y1, float thickness, ALLEGRO_COLOR color);
+
+void draw_hitbox(Overlay* ov, Hitbox* hb, ALLEGRO_COLOR color);
+
+void overlay_text(Overlay* ov, float x, float y, ALLEGRO_COLOR color, const char* text, int length);
+
+int overlay_textf(Overlay* ov, int slot, float x, float y, ALLEGRO_COLOR color, const double* key, int key_count, const char* format, ...);
+
+void overlay_flush(Overlay* ov);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef INCLUDE_PARTICLES_H
+#define INCLUDE_PARTICLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <allegro5/allegro5.h>
+#include <allegro5/allegro_primitives.h>
+
+#define PARTICLES_PER_BLEND 65536
+#define EFFECT_QUEUE_SIZE   64      /* effect events carried in every snapshot */
+
+typedef enum particle_blend {
+    BLEND_ALPHA,
+    BLEND_ADDITIVE,
+    BLEND_COUNT
+} Particle_Blend;
+
+typedef enum effect_kind {
+    FX_CAST,
+    FX_SPELL_HIT,
+    FX_WALL_HIT,
+    FX_SLIME_DEATH,
+    FX_KIND_COUNT
+} Effect_Kind;
+
+/*
+* Something the simulation wants shown. Particles are purely visual, so the
+* simulation only records events and the render thread owns the particles.
+* Ids start at 1, 0 marks an empty slot.
+*/
+typedef struct effect_event {
+    uint32_t id;
+    Effect_Kind kind;
+    float x, y;
+    float dir_x, dir_y;
+} Effect_Event;
+
+/* Simulation side: the most recent effect events, copied into every snapshot */
+typedef struct effect_queue {
+    Effect_Event events[EFFECT_QUEUE_SIZE];
+    uint32_t next_id;
+} Effect_Queue;
+
+/*
+* Particles of one blend mode, one array per attribute so the update kernels
+* stream through memory and vectorize. Colours are straight (not
+* premultiplied), alpha comes from the remaining life.
+*/
+typedef struct particle_pool {
+    int count, capacity;
+    float *x, *y, *vx, *vy;
+    float *life, *inv_life;
+    float *size, *gravity, *drag;
+    float *r, *g, *b;
+} Particle_Pool;
+
+typedef struct particle_system {
+    Particle_Pool pools[BLEND_COUNT];
+    ALLEGRO_VERTEX* vertices;   /* six per particle, shared by the pools */
+    uint32_t rng;
+    uint32_t last_event;
+} Particle_System;
+
+void effect_queue_initialize(Effect_Queue* q);
+
+void effect_queue_push(Effect_Queue* q, Effect_Kind kind, float x, float y, float dir_x, float dir_y);
+
+int create_particle_system(Particle_System* ps, int capacity_per_blend);
+
+void destroy_particle_system(Particle_System* ps);
+
+int particles_consume_effects(Particle_System* ps, const Effect_Event events[EFFECT_QUEUE_SIZE]);
+
+int particles_emit(Particle_System* ps, Effect_Kind kind, float x, float y, float dir_x, float dir_y);
+
+void particles_update(Particle_System* ps, float dt);
+
+int particles_build_vertices(Particle_System* ps, Particle_Blend blend);
+
+void particles_draw(Particle_System* ps);
+
+int particles_live(Particle_System* ps);
+
+#endif
@@ -1,10 +1,27 @@
 #ifndef INCLUDE_RANDOM_H
 #define INCLUDE_RANDOM_H
 
-void rng_initialize();
+#include <stdbool.h>
+#include <stdint.h>
 
-bool rng_percent_chance(double percent);
+/*
+* One generator per game, so games running side by side never share a
+* stream and each replays the same from the same seed.
+*/
+typedef struct rng {
+    uint64_t state;
+} Rng;
 
-int rng_random_int(int min, int max);
+void rng_initialize(Rng* rng);
 
-#endif
\ No newline at end of file
+void rng_seed(Rng* rng, uint64_t seed);
+
+bool rng_percent_chance(Rng* rng, double percent);
+
+int rng_random_int(Rng* rng, int min, int max);
+
+uint64_t rng_get_state(const Rng* rng);
+
+void rng_set_state(Rng* rng, uint64_t state);
+
+#endif
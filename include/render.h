@@ -0,0 +1,77 @@
+#ifndef INCLUDE_RENDER_H
+#define INCLUDE_RENDER_H
+
+#include <stdbool.h>
+#include <allegro5/allegro5.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_primitives.h>
+
+/* What one frame cost, as the GPU would see it */
+typedef struct render_stats {
+    int draw_calls;         /* held bitmap draws of one texture count once */
+    int texture_switches;
+    int vertices;
+    int bitmaps;            /* bitmap regions drawn, held or not */
+    int prims;
+} Render_Stats;
+
+struct render_backend;
+
+/*
+* Everything the game draws goes through one of these. The Allegro backend
+* draws, the null backend drops everything so the frame path runs without a
+* display, and the recording backend counts what a frame costs and passes it
+* on to another backend, if it has one.
+*/
+typedef struct render_backend {
+    const char* name;
+    void (*begin_frame)(struct render_backend* rb, ALLEGRO_COLOR clear);
+    void (*end_frame)(struct render_backend* rb);
+    void (*use_transform)(struct render_backend* rb, const ALLEGRO_TRANSFORM* transform);
+    void (*hold_drawing)(struct render_backend* rb, bool hold);
+    void (*set_blender)(struct render_backend* rb, int op, int src, int dst);
+    /* Region sx, sy, sw, sh of texture, rotated by angle around cx, cy and drawn at dx, dy */
+    void (*draw_region)(struct render_backend* rb, ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh,
+                        float cx, float cy, float dx, float dy, float angle, int flags);
+    /* indices may be NULL for an unindexed list */
+    void (*draw_prim)(struct render_backend* rb, const ALLEGRO_VERTEX* vertices, const int* indices, int count,
+                      ALLEGRO_BITMAP* texture, int type);
+    void (*draw_text)(struct render_backend* rb, const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text);
+
+    /* Recording backend only */
+    struct render_backend* inner;
+    bool held;
+    bool batching;          /* a held batch is open */
+    bool drawn;             /* anything drawn yet this frame */
+    const void* texture;    /* last texture drawn with, NULL for none */
+    Render_Stats stats;     /* this frame so far */
+    Render_Stats last_stats;
+} Render_Backend;
+
+void render_allegro_backend(Render_Backend* rb);
+
+void render_null_backend(Render_Backend* rb);
+
+void render_recording_backend(Render_Backend* rb, Render_Backend* inner);
+
+void render_set_backend(Render_Backend* rb);
+
+Render_Backend* render_backend();
+
+void render_begin_frame(ALLEGRO_COLOR clear);
+
+void render_end_frame();
+
+void render_use_transform(const ALLEGRO_TRANSFORM* transform);
+
+void render_hold_drawing(bool hold);
+
+void render_set_blender(int op, int src, int dst);
+
+void render_draw_region(ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh, float cx, float cy, float dx, float dy, float angle, int flags);
+
+void render_draw_prim(const ALLEGRO_VERTEX* vertices, const int* indices, int count, ALLEGRO_BITMAP* texture, int type);
+
+void render_draw_text(const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text);
+
+#endif
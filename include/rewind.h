@@ -0,0 +1,73 @@
+#ifndef INCLUDE_REWIND_H
+#define INCLUDE_REWIND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "mob.h"
+#include "mob_handler.h"
+#include "attack.h"
+#include "terrain.h"
+#include "mem_track.h"
+
+#define REWIND_MAX_FRAMES        1024               /* ticks of history, about 17 s */
+#define REWIND_KEYFRAME_INTERVAL 30                 /* ticks between keyframes */
+#define REWIND_BUFFER_SIZE       (2 * 1024 * 1024)  /* compressed bytes kept */
+
+/* The part of the simulation that is recorded every tick */
+typedef struct rewind_state {
+    Mob player;
+    Mob_Handler mobs;
+    Projectile_Pool projectiles;
+} Rewind_State;
+
+/*
+* One recorded tick. Keyframes are stored against an empty state, every other
+* frame is the XOR of its state with the keyframe before it, run length
+* encoded, so any frame is one keyframe plus one delta away.
+*/
+typedef struct rewind_frame {
+    int64_t tick;
+    uint32_t offset;    /* into the buffer */
+    uint32_t size;      /* compressed bytes */
+    bool is_keyframe;
+} Rewind_Frame;
+
+/*
+* Bounded history of the last ticks in the current room. Frames are written
+* into one byte ring, and once it or the frame ring is full the oldest frames
+* are dropped, a whole keyframe interval at a time.
+*/
+typedef struct rewind_buffer {
+    unsigned char* data;
+    uint32_t write;                 /* where the next frame is written */
+    Rewind_Frame frames[REWIND_MAX_FRAMES];
+    int first;                      /* oldest frame */
+    int count;
+    int since_keyframe;
+    Rewind_State keyframe;          /* state the newest deltas are against */
+    Rewind_State view;              /* decoded frame, while stepping */
+    const Room* room;               /* history never crosses rooms */
+
+    bool paused;
+    int cursor;                     /* frame shown while paused, 0 is the oldest */
+    uint32_t bytes;                 /* compressed bytes held */
+    double record_ms;               /* cost of recording the last tick */
+} Rewind_Buffer;
+
+int rewind_create(Rewind_Buffer* rb, Mem_Tag tag);
+
+void rewind_destroy(Rewind_Buffer* rb);
+
+void rewind_reset(Rewind_Buffer* rb);
+
+void rewind_record(Rewind_Buffer* rb, int64_t tick, const Room* room, const Mob* player, const Mob_Handler* mobs, const Projectile_Pool* projectiles);
+
+int rewind_seek(Rewind_Buffer* rb, int cursor, Mob* player, Mob_Handler* mobs, Projectile_Pool* projectiles);
+
+void rewind_pause(Rewind_Buffer* rb);
+
+void rewind_resume(Rewind_Buffer* rb);
+
+#endif
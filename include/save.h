@@ -0,0 +1,43 @@
+#ifndef INCLUDE_SAVE_H
+#define INCLUDE_SAVE_H
+
+#include <stdint.h>
+
+#include "simulation.h"
+
+#define SAVE_MAGIC      "WIZSAVE"
+#define SAVE_VERSION    1
+#define QUICKSAVE_FILE  "quicksave.sav"
+
+/*
+* On disk layout: header, then the index of every allocated floor chunk, then
+* the chunks themselves in index order. Rooms, mobs and projectiles are stored
+* as the structs they are in memory, so the header records their sizes and a
+* save only loads into a build with the same layout. Pointers in them are
+* meaningless on disk and are fixed up on load.
+*/
+typedef struct save_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t room_size, mob_size, chunk_size, handler_size, pool_size;
+    uint64_t rng_state;
+    int64_t tick;
+    int32_t floor_number, rows, cols;
+    int32_t key_found;
+    int32_t room_count, chunk_count;
+    int32_t room_row, room_col;     /* the room the player is in */
+} Save_Header;
+
+/* Everything that isn't part of the floor map, written as one block */
+typedef struct save_state {
+    Save_Header header;
+    Mob player;
+    Mob_Handler mobs;
+    Projectile_Pool projectiles;
+} Save_State;
+
+int save_game(Simulation* sim, const char* path);
+
+int load_game(Simulation* sim, const char* path);
+
+#endif
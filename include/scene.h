@@ -0,0 +1,16 @@
+#ifndef INCLUDE_SCENE_H
+#define INCLUDE_SCENE_H
+
+#include <allegro5/allegro5.h>
+#include <allegro5/allegro_font.h>
+
+#include "snapshot.h"
+#include "overlay.h"
+#include "latency.h"
+#include "particles.h"
+
+void camera_update(float* cameraPosition, float x, float y, float width, float height, float x_max, float y_max);
+
+void draw_snapshot(Snapshot* snap, double alpha, ALLEGRO_FONT* font, Overlay* ov, double fps, Latency_Recorder* latency, Particle_System* particles, double particle_ms);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef INCLUDE_SCHEDULER_H
+#define INCLUDE_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TICK_RATE          60.0
+#define MAX_CATCHUP_TICKS  5
+
+/*
+* Fixed timestep scheduler: real time is accumulated every frame and drained in
+* whole simulation ticks, the remainder is used to interpolate rendering.
+*/
+typedef struct scheduler {
+    double tick_dt;
+    double accumulator;
+    double last_time;
+    int max_catchup;
+    int steps_this_frame;
+    int64_t tick_count;
+    int64_t dropped_ticks;
+} Scheduler;
+
+Scheduler create_scheduler(double tick_rate, int max_catchup, double now);
+
+void scheduler_begin_frame(Scheduler* s, double now);
+
+bool scheduler_step(Scheduler* s);
+
+double scheduler_alpha(Scheduler* s);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef INCLUDE_SIMULATION_H
+#define INCLUDE_SIMULATION_H
+
+#include <allegro5/allegro5.h>
+
+#include "global.h"
+#include "mob.h"
+#include "terrain.h"
+#include "attack.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "input.h"
+#include "latency.h"
+#include "visibility.h"
+#include "spell.h"
+#include "spell_cache.h"
+#include "particles.h"
+#include "frame_arena.h"
+#include "rewind.h"
+#include "crowd.h"
+#include "combat.h"
+#include "game_context.h"
+
+#define SIM_SCRATCH_SIZE (64 * 1024)   /* per tick scratch, see frame_arena.h */
+#define SIM_CROWD_THREADS 1            /* a room holds too few mobs to be worth waking workers */
+
+/*
+* All gameplay state. It is owned by the simulation thread, the render thread
+* only ever sees it through the published snapshots.
+*/
+typedef struct simulation {
+    Scheduler scheduler;
+    Game_Context game;       /* rng, loaded room's mobs and tiles */
+    Game_State game_state;
+    Mob player;
+    Floor floor;
+    Room* current_room;
+    Projectile_Pool projectiles;
+    Spell_VM spells;
+    Spell_Cache spell_cache;
+    Spell_Program primary_spell, secondary_spell;
+    int spell_instructions;
+    Input_State input;
+    bool show_dev_tools;
+    bool show_hitboxes;
+    const char* load_path;  /* save to load once assets are ready, or NULL */
+
+    Input_Ring input_ring;   /* filled by the render thread, drained each tick */
+    Latency_Queue latency;   /* inputs acted on, measured by the render thread */
+    Visibility_Service visibility;
+    Effect_Queue effects;    /* shown by the render thread's particles */
+    int mobs_seeing_player;
+    Frame_Arena scratch;     /* per tick, reset when the tick ends */
+    Rewind_Buffer rewind;    /* recent ticks, stepped through from the dev tools */
+    Crowd_Solver crowd;      /* keeps mobs from stacking on each other */
+    Combat_Bus combat;       /* hits found this tick, applied by one resolve pass */
+
+    bool assets_ready;      /* written by the render thread */
+    bool quit_requested;    /* written by the simulation thread */
+    Triple_Buffer snapshots;
+    ALLEGRO_THREAD* thread;
+} Simulation;
+
+Simulation* create_simulation(uint64_t seed);
+
+void destroy_simulation(Simulation* sim);
+
+int simulation_start(Simulation* sim);
+
+void simulation_stop(Simulation* sim);
+
+void simulation_set_assets_ready(Simulation* sim);
+
+bool simulation_quit_requested(Simulation* sim);
+
+bool simulation_push_input(Simulation* sim, ALLEGRO_EVENT* event);
+
+void simulation_tick(Simulation* sim);
+
+void simulation_publish(Simulation* sim);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef INCLUDE_SNAPSHOT_H
+#define INCLUDE_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "global.h"
+#include "mob.h"
+#include "mob_handler.h"
+#include "terrain.h"
+#include "attack.h"
+#include "latency.h"
+#include "visibility.h"
+#include "spell_cache.h"
+#include "particles.h"
+#include "crowd.h"
+
+typedef struct minimap_cell {
+    bool is_initialized;
+    bool is_loaded;
+    Room_Type type;
+} Minimap_Cell;
+
+/*
+* Immutable copy of everything the render thread needs from one simulation
+* tick. Nothing in here points back into live simulation state: the room is
+* copied with its mob handler pointer cleared and its tiles pointing at the
+* copy in here, and mobs are copied compactly.
+*/
+typedef struct snapshot {
+    int64_t tick;
+    double publish_time;
+    double tick_dt;
+    int64_t dropped_ticks;
+    Game_State game_state;
+    bool show_dev_tools;
+    bool show_hitboxes;
+    int mouse_x, mouse_y;
+    Latency_Sample latency[LATENCY_PENDING];
+    Effect_Event effects[EFFECT_QUEUE_SIZE];
+    Visibility_Stats visibility;
+    int mobs_seeing_player;
+    size_t scratch_used, scratch_peak, scratch_capacity;
+    bool rewind_paused;
+    int rewind_frames, rewind_cursor;
+    uint32_t rewind_bytes;
+    double rewind_record_ms;
+    Crowd_Stats crowd;
+    int combat_events, combat_dropped;
+
+    Mob player;
+    Mob mobs[ABSOLUTE_MAX_MOBS];
+    int mob_count;
+    Projectile projectiles[MAX_PROJECTILES];
+    int projectile_count;
+    int active_spells;
+    int spell_instructions;
+    Spell_Pattern spell_patterns[SPELL_CACHE_SIZE];
+    int spell_pattern_count;
+
+    /* Current room, its texture map doubles as the tile cache for drawing */
+    Room room;
+    Room_Tiles room_tiles;
+    int floor_number;
+    bool key_found;
+    Atlas_Sprite tileset;
+    int minimap_row, minimap_col;   /* floor position of minimap[0][0] */
+    Minimap_Cell minimap[MINIMAP_SIZE][MINIMAP_SIZE];
+} Snapshot;
+
+/*
+* Lock-free single producer / single consumer triple buffer. The writer always
+* has a private back buffer, the reader a private front buffer, and the two
+* trade through the shared middle slot with a single atomic exchange.
+*/
+typedef struct triple_buffer {
+    Snapshot buffers[3];
+    int back;
+    int front;
+    int middle;
+} Triple_Buffer;
+
+void triple_buffer_initialize(Triple_Buffer* tb);
+
+Snapshot* triple_buffer_back(Triple_Buffer* tb);
+
+void triple_buffer_publish(Triple_Buffer* tb);
+
+bool triple_buffer_consume(Triple_Buffer* tb);
+
+Snapshot* triple_buffer_front(Triple_Buffer* tb);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef INCLUDE_SPELL_H
+#define INCLUDE_SPELL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPELL_NAME_SIZE      32
+#define SPELL_MAX_CODE       256
+#define SPELL_MAX_INSTANCES  4096
+#define SPELL_TICK_BUDGET    512    /* instructions per instance per tick */
+#define SPELL_MAX_NESTING    4
+#define SPELL_MAX_REPEAT     65535  /* largest count a repeat block takes */
+
+/*
+* Register file of a running spell. The first four drive 'fire', a-d are free
+* for the spell author, and the rest count down enclosing repeat blocks.
+*/
+typedef enum spell_register {
+    R_ANGLE,        /* degrees, relative to where the caster aimed */
+    R_SPEED,
+    R_DAMAGE,
+    R_SIZE,
+    R_A, R_B, R_C, R_D,
+    R_LOOP,
+    SPELL_REGISTERS = R_LOOP + SPELL_MAX_NESTING
+} Spell_Register;
+
+typedef enum spell_op {
+    OP_HALT,
+    OP_SET,     /* reg[a] = imm */
+    OP_ADD,     /* reg[a] += imm */
+    OP_MUL,     /* reg[a] *= imm */
+    OP_MOV,     /* reg[a] = reg[b] */
+    OP_ADDR,    /* reg[a] += reg[b] */
+    OP_FIRE,    /* emit a projectile from the fire registers */
+    OP_WAIT,    /* sleep imm ticks */
+    OP_DJNZ     /* if(--reg[a] > 0) goto b */
+} Spell_Op;
+
+typedef struct spell_instr {
+    uint8_t op;
+    uint8_t a;
+    uint16_t b;
+    float imm;
+} Spell_Instr;
+
+typedef struct spell_program {
+    char name[SPELL_NAME_SIZE];
+    uint32_t hash;          /* of the bytecode, identifies the spell's behaviour */
+    Spell_Instr code[SPELL_MAX_CODE];
+    int length;
+} Spell_Program;
+
+typedef struct spell_instance {
+    const Spell_Program* program;
+    float reg[SPELL_REGISTERS];
+    float x, y, aim;        /* caster position and aim, radians */
+    uint16_t pc;
+    uint16_t wait;
+} Spell_Instance;
+
+/* One projectile requested by a spell */
+typedef struct spell_emit {
+    float x, y;
+    float vx, vy;           /* pixels per tick */
+    float damage, size;
+} Spell_Emit;
+
+typedef void (*Spell_Emitter)(const Spell_Emit* emit, void* ctx);
+
+/*
+* Fixed pool of running spells, kept dense so a tick is one linear pass.
+* Nothing is allocated after initialization.
+*/
+typedef struct spell_vm {
+    Spell_Instance instances[SPELL_MAX_INSTANCES];
+    int count;
+    int64_t instructions;
+} Spell_VM;
+
+int spell_compile(const char* source, const char* name, Spell_Program* out, char* error, int error_size);
+
+int spell_load(const char* path, Spell_Program* out);
+
+void spell_vm_initialize(Spell_VM* vm);
+
+int spell_cast(Spell_VM* vm, const Spell_Program* program, float x, float y, float aim);
+
+int spell_vm_tick(Spell_VM* vm, Spell_Emitter emit, void* ctx);
+
+int spell_trace(const Spell_Program* program, int max_ticks, Spell_Emit emits[], uint16_t ticks[], int max_emits, int* duration);
+
+#endif
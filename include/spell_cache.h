@@ -0,0 +1,69 @@
+#ifndef INCLUDE_SPELL_CACHE_H
+#define INCLUDE_SPELL_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "spell.h"
+
+#define SPELL_CACHE_SIZE        32
+#define SPELL_CACHE_EMISSIONS   8192    /* shared by every cached pattern */
+#define SPELL_PATTERN_MAX_EMITS 512
+#define SPELL_PATTERN_MAX_TICKS 600     /* longer spells stay interpreted */
+#define SPELL_MAX_REPLAYS       4096
+
+/*
+* One precomputed shot, relative to a caster at the origin aiming along +x.
+* Rotating (vx, vy) onto the real aim direction needs no trig.
+*/
+typedef struct spell_emission {
+    uint16_t tick;
+    float offset_x, offset_y;
+    float vx, vy;
+    float damage, size;
+} Spell_Emission;
+
+/*
+* Cache entry for one spell definition. Spells that could not be flattened
+* keep an entry too, with is_pattern false, so they are not traced again.
+*/
+typedef struct spell_pattern {
+    uint32_t hash;
+    int length;         /* of the bytecode kept in the cache's code table */
+    char name[SPELL_NAME_SIZE];
+    bool is_pattern;
+    int first, count;   /* range in the cache's emission table */
+    int duration;       /* ticks from cast to the last emission */
+    int casts;
+} Spell_Pattern;
+
+typedef struct spell_replay {
+    const Spell_Pattern* pattern;
+    float x, y;
+    float dir_x, dir_y;
+    uint16_t tick;
+    uint16_t next;      /* next emission to play */
+} Spell_Replay;
+
+typedef struct spell_cache {
+    Spell_Pattern patterns[SPELL_CACHE_SIZE];
+    Spell_Instr codes[SPELL_CACHE_SIZE][SPELL_MAX_CODE];   /* per pattern, to confirm hash hits */
+    int pattern_count;
+    Spell_Emission emissions[SPELL_CACHE_EMISSIONS];
+    int emission_count;
+    Spell_Replay replays[SPELL_MAX_REPLAYS];
+    int replay_count;
+    /* Scratch for tracing one spell, per cache so simulations don't share it */
+    Spell_Emit trace_emits[SPELL_PATTERN_MAX_EMITS];
+    uint16_t trace_ticks[SPELL_PATTERN_MAX_EMITS];
+} Spell_Cache;
+
+void spell_cache_initialize(Spell_Cache* cache);
+
+Spell_Pattern* spell_cache_lookup(Spell_Cache* cache, const Spell_Program* program);
+
+int spell_cache_cast(Spell_Cache* cache, Spell_Pattern* pattern, float x, float y, float dir_x, float dir_y);
+
+int spell_cache_tick(Spell_Cache* cache, Spell_Emitter emit, void* ctx);
+
+#endif
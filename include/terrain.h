@@ -1,23 +1,36 @@
 #ifndef INCLUDE_TERRAIN_H
 #define INCLUDE_TERRAIN_H
 
+#include <stdint.h>
+
 #include "collisions.h"
 #include "mob.h"
 #include "global.h"
 #include "mob_handler.h"
+#include "atlas.h"
+#include "tile_map.h"
 
-#define ID_SIZE             8
+#define ID_SIZE             16
 #define MAX_ROOM_WIDTH_IDX  20
 #define MAX_ROOM_HEIGHT_IDX 15
 #define PX_PER_TILE         64
+#define FIRST_WALL_TEXTURE  4   /* tile set frames from here on are walls */
 
 #define DOOR_HEIGHT 128
 #define DOOR_WIDTH  32
 
-#define MAX_ROWS 20
-#define MAX_COLS 20
+#define WALL_THICKNESS 64
+#define MAX_ROOM_WALLS 8
+
+#define FLOOR_BASE_SIZE   11  /* rows and columns of the first floor */
+#define FLOOR_CHUNK_SHIFT 4   /* rooms are stored in 16x16 chunks */
+#define FLOOR_CHUNK_SIZE  (1 << FLOOR_CHUNK_SHIFT)
+#define FLOOR_CHUNK_MASK  (FLOOR_CHUNK_SIZE - 1)
+
+#define MINIMAP_SIZE 20       /* rooms across (and down) the minimap window */
 
-extern int floor_num;
+/* Defined in game_context.h, which needs the types below */
+typedef struct game_context Game_Context;
 
 typedef enum room_type {
   R_BASIC,     //Normal enemy spawn
@@ -30,42 +43,74 @@ typedef enum room_type {
   R_START,     //Starter Room, No Enemy Spawn
 } Room_Type;
 
+/*
+* Tiles of a room, only built while the room is loaded. Rooms on the floor map
+* keep just the seed they are rebuilt from, so a floor can hold many of them.
+*/
+typedef struct room_tiles {
+    int texture_map[MAX_ROOM_WIDTH_IDX][MAX_ROOM_HEIGHT_IDX];
+    Solid_Map solidity;
+    uint32_t generation;    /* bumped on every rebuild, so caches notice a new room */
+} Room_Tiles;
+
 typedef struct room {
     int width, height, row_pos, col_pos;
     char id[ID_SIZE];
-    int texture_map[MAX_ROOM_WIDTH_IDX][MAX_ROOM_HEIGHT_IDX];
-    ALLEGRO_BITMAP* door;
+    uint32_t tile_seed;
+    int start_distance;     /* doorways from the start room, -1 if unreachable */
     Room_Type type;
     bool is_initialized, is_loaded, is_spawnable, is_locked;
     int room_configuration[4];
     Hitbox north_door, south_door, east_door, west_door;
     Mob_Handler* m_handler_p;
+    Room_Tiles* tiles;
 } Room;
 
+typedef struct floor_chunk {
+    Room rooms[FLOOR_CHUNK_SIZE][FLOOR_CHUNK_SIZE];
+} Floor_Chunk;
+
+/*
+* The floor map is a grid of chunk pointers, and a chunk is only allocated once
+* generation touches one of its rooms. Room pointers stay valid until the floor
+* is destroyed.
+*/
 typedef struct floor {
   int number;
-  int start_row;
-  int stop_row;
-  int start_col;
-  int stop_col;
-  ALLEGRO_BITMAP* texture_p;
+  int rows;
+  int cols;
+  Atlas_Sprite tileset;
   bool key_found;
-  Room map[MAX_ROWS][MAX_COLS];
+  int chunk_rows;
+  int chunk_cols;
+  int chunk_count;    /* chunks allocated */
+  int room_count;     /* rooms generated */
+  Floor_Chunk** chunks;
 } Floor;
 
-int load_room(Room* r);
+int load_room(Game_Context* game, Room* r);
 
 int unload_room(Room* r);
 
-Room* change_rooms(Room map[MAX_ROWS][MAX_COLS], Room* current_room, Mob* p);
+Room* change_rooms(Game_Context* game, Floor* f, Room* current_room, Mob* p);
+
+int get_room_walls(Room* r, Hitbox walls[MAX_ROOM_WALLS]);
+
+void draw_room(Room* r, Atlas_Sprite tileset);
+
+int floor_size(int floor_num);
+
+int create_floor_map(Floor* f, int floor_num, int rows, int cols);
+
+int generate_floor(Floor* f, Game_Context* game, int floor_num, int rows, int cols, int init_row, int init_col);
 
-void draw_room(Room* r, ALLEGRO_BITMAP* room_texture_p, double delta_time);
+Room* floor_room(Floor* f, int row, int col);
 
-void generate_floor(Floor* f, int floor_num, int init_row, int init_col);
+Room* relink_floor(Floor* f, Game_Context* game, const Mob_Handler* mobs, int row, int col);
 
 void destroy_floor(Floor* floor_p);
 
-Room* update_dungeon_state(Floor* floor, Room* room, Mob* player);
+Room* update_dungeon_state(Game_Context* game, Floor* floor, Room* room, Mob* player);
 /* Externally visible for debugging purposes*/
 void print_floor(Floor* f);
 
@@ -0,0 +1,49 @@
+#ifndef INCLUDE_TILE_MAP_H
+#define INCLUDE_TILE_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "collisions.h"
+
+#define SOLID_MAP_MAX_COLS 32   /* one uint32_t per tile row */
+#define SOLID_MAP_MAX_ROWS 32
+
+/*
+* Solidity of a room's tiles, one bit per tile. Bit c of bits[r] is set when
+* the tile at column c, row r blocks movement and sight. Anything outside the
+* map counts as solid.
+*/
+typedef struct solid_map {
+    int cols, rows;
+    int tile_size;
+    uint32_t bits[SOLID_MAP_MAX_ROWS];
+} Solid_Map;
+
+/* First solid tile along a ray */
+typedef struct tile_hit {
+    int col, row;
+    double t;           /* fraction of the segment travelled, 0..1 */
+    float x, y;         /* point where the ray entered the tile */
+} Tile_Hit;
+
+/* Called for every tile a segment crosses, in order. Return true to stop. */
+typedef bool (*Tile_Visitor)(int col, int row, double t, void* ctx);
+
+void solid_map_initialize(Solid_Map* map, int cols, int rows, int tile_size);
+
+void solid_map_set(Solid_Map* map, int col, int row, bool solid);
+
+void solid_map_clear_box(Solid_Map* map, Hitbox* box);
+
+bool solid_map_tile(Solid_Map* map, int col, int row);
+
+bool solid_map_point(Solid_Map* map, float x, float y);
+
+bool solid_map_box(Solid_Map* map, Hitbox* box);
+
+bool solid_map_walk(Solid_Map* map, float x0, float y0, float x1, float y1, Tile_Visitor visit, void* ctx);
+
+bool solid_map_raycast(Solid_Map* map, float x0, float y0, float x1, float y1, Tile_Hit* hit);
+
+#endif
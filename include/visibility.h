@@ -0,0 +1,73 @@
+#ifndef INCLUDE_VISIBILITY_H
+#define INCLUDE_VISIBILITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tile_map.h"
+#include "mob_handler.h"
+
+#define VIS_MAX_QUERIES  256
+#define VIS_CACHE_SIZE   512    /* must be a power of two */
+#define VIS_BUCKET_SIZE  8      /* mobs tracked per tile before falling back to a full scan */
+
+/*
+* One line of sight request. Mobs at ignore_a/ignore_b (-1 for none) do not
+* block it, usually the looker and the target themselves.
+*/
+typedef struct visibility_query {
+    float from_x, from_y, to_x, to_y;
+    int ignore_a, ignore_b;
+    bool visible;
+} Visibility_Query;
+
+typedef struct visibility_cache_entry {
+    int key[6];
+    uint32_t generation;
+    bool visible;
+} Visibility_Cache_Entry;
+
+typedef struct visibility_stats {
+    int queries;
+    int cache_hits;
+    int tiles_walked;
+    int mob_tests;
+} Visibility_Stats;
+
+/*
+* Batched line of sight over a room's solid tiles and its mobs. Queries are
+* collected during a tick and answered together by visibility_resolve, which
+* buckets the mobs by tile once for the whole batch. Answers are cached until
+* a blocker moves, and a moved endpoint is simply a different query.
+*/
+typedef struct visibility_service {
+    Solid_Map* tiles;
+    Mob_Handler* handler;
+
+    Visibility_Query queries[VIS_MAX_QUERIES];
+    int query_count;
+
+    /* Mob indices overlapping each tile, and a bit per occupied tile */
+    uint32_t occupied[SOLID_MAP_MAX_ROWS];
+    uint8_t bucket_count[SOLID_MAP_MAX_ROWS][SOLID_MAP_MAX_COLS];
+    uint8_t bucket[SOLID_MAP_MAX_ROWS][SOLID_MAP_MAX_COLS][VIS_BUCKET_SIZE];
+
+    uint32_t tiles_generation;  /* of the tiles the cache was filled against */
+    uint32_t blocker_signature;
+    uint32_t generation;
+    Visibility_Cache_Entry cache[VIS_CACHE_SIZE];
+
+    Visibility_Stats stats;
+} Visibility_Service;
+
+void visibility_initialize(Visibility_Service* vs);
+
+void visibility_begin(Visibility_Service* vs, Solid_Map* tiles, uint32_t tiles_generation, Mob_Handler* handler);
+
+int visibility_add_query(Visibility_Service* vs, float from_x, float from_y, float to_x, float to_y, int ignore_a, int ignore_b);
+
+void visibility_resolve(Visibility_Service* vs);
+
+bool visibility_result(Visibility_Service* vs, int query);
+
+#endif
@@ -0,0 +1,232 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_image.h>         /* Allegro Image library */
+
+/* Local Includes */
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "global.h"
+#include "mem_track.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+static ALLEGRO_THREAD* workers[ASSET_LOADER_MAX_THREADS];
+static int worker_count = 0;
+static ALLEGRO_MUTEX* loader_mutex = NULL;
+static ALLEGRO_COND* loader_cond = NULL;
+static bool stopping = false;
+static int waiting = 0;     /* callers blocked in asset_future_wait */
+
+/* Future slots, and a circular queue of the ones waiting for a worker */
+static Asset_Future futures[ASSET_LOADER_MAX_JOBS];
+static Asset_Future* queue[ASSET_LOADER_MAX_JOBS];
+static int queue_head = 0;
+static int queue_count = 0;
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static void* loader_worker(ALLEGRO_THREAD* thread, void* arg) {
+    /* New bitmap flags are thread local, workers only ever produce memory bitmaps */
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    while(true) {
+        al_lock_mutex(loader_mutex);
+        while(!stopping && queue_count == 0) {
+            al_wait_cond(loader_cond, loader_mutex);
+        }
+        if(stopping) {
+            al_unlock_mutex(loader_mutex);
+            break;
+        }
+        Asset_Future* job = queue[queue_head];
+        queue_head = (queue_head + 1) % ASSET_LOADER_MAX_JOBS;
+        queue_count--;
+        al_unlock_mutex(loader_mutex);
+
+        double start = al_get_time();
+        ALLEGRO_BITMAP* bmp = load_asset_bitmap(job->name);
+
+        al_lock_mutex(loader_mutex);
+        job->bitmap    = bmp;
+        job->decode_ms = (al_get_time() - start) * 1000.0;
+        job->state     = bmp? ASSET_READY : ASSET_FAILED;
+        al_broadcast_cond(loader_cond);
+        al_unlock_mutex(loader_mutex);
+    }
+    return NULL;
+}
+
+static void destroy_loader_lock() {
+    if(loader_cond) {
+        al_destroy_cond(loader_cond);
+    }
+    if(loader_mutex) {
+        al_destroy_mutex(loader_mutex);
+    }
+    loader_cond  = NULL;
+    loader_mutex = NULL;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Spin up the decode pool. A thread_count <= 0 uses one thread per core.
+*/
+int asset_loader_start(int thread_count) {
+    if(worker_count > 0) {
+        return OK;
+    }
+    if(thread_count <= 0) {
+        thread_count = al_get_cpu_count();
+    }
+    thread_count = constrain(1, ASSET_LOADER_MAX_THREADS, thread_count);
+
+    loader_mutex = al_create_mutex();
+    loader_cond  = al_create_cond();
+    if(!loader_mutex || !loader_cond) {
+        printf("(asset_loader_start): couldn't create loader lock.\n");
+        destroy_loader_lock();
+        return ERROR;
+    }
+    stopping = false;
+    for(int i = 0; i < thread_count; i++) {
+        workers[i] = al_create_thread(loader_worker, NULL);
+        if(!workers[i]) {
+            printf("(asset_loader_start): couldn't create worker %d.\n", i);
+            break;
+        }
+        al_start_thread(workers[i]);
+        worker_count++;
+    }
+    if(worker_count == 0) {
+        destroy_loader_lock();
+        return ERROR;
+    }
+    return OK;
+}
+
+/*
+* Stop the pool. Jobs that have not started yet are failed, and anyone waiting
+* on one is woken with NULL. Decoded bitmaps that were never collected are
+* destroyed. No future may be used once this returns.
+*/
+void asset_loader_stop() {
+    if(worker_count == 0) {
+        return;
+    }
+    al_lock_mutex(loader_mutex);
+    stopping = true;
+    while(queue_count > 0) {
+        queue[queue_head]->state = ASSET_FAILED;
+        queue_head = (queue_head + 1) % ASSET_LOADER_MAX_JOBS;
+        queue_count--;
+    }
+    al_broadcast_cond(loader_cond);
+    al_unlock_mutex(loader_mutex);
+
+    for(int i = 0; i < worker_count; i++) {
+        al_join_thread(workers[i], NULL);
+        al_destroy_thread(workers[i]);
+        workers[i] = NULL;
+    }
+    worker_count = 0;
+
+    /* Every future is done now, let anyone still waiting on one get out */
+    al_lock_mutex(loader_mutex);
+    while(waiting > 0) {
+        al_wait_cond(loader_cond, loader_mutex);
+    }
+    al_unlock_mutex(loader_mutex);
+
+    for(int i = 0; i < ASSET_LOADER_MAX_JOBS; i++) {
+        if(futures[i].bitmap) {
+            mem_destroy_bitmap(futures[i].bitmap);
+        }
+        futures[i].bitmap = NULL;
+        futures[i].state  = ASSET_FREE;
+    }
+    queue_head  = 0;
+    queue_count = 0;
+    destroy_loader_lock();
+}
+
+int asset_loader_thread_count() {
+    return worker_count;
+}
+
+/*
+* Queue an asset for decoding. Returns NULL if the pool is not running or every
+* future slot is in use.
+*/
+Asset_Future* asset_loader_request(const char* name) {
+    if(worker_count == 0) {
+        return NULL;
+    }
+    Asset_Future* future = NULL;
+    al_lock_mutex(loader_mutex);
+    for(int i = 0; i < ASSET_LOADER_MAX_JOBS; i++) {
+        if(futures[i].state == ASSET_FREE) {
+            future = &futures[i];
+            break;
+        }
+    }
+    if(future) {
+        future->name      = name;
+        future->bitmap    = NULL;
+        future->state     = ASSET_PENDING;
+        future->decode_ms = 0;
+        queue[(queue_head + queue_count) % ASSET_LOADER_MAX_JOBS] = future;
+        queue_count++;
+        al_broadcast_cond(loader_cond);
+    }
+    al_unlock_mutex(loader_mutex);
+    return future;
+}
+
+bool asset_future_is_done(Asset_Future* future) {
+    al_lock_mutex(loader_mutex);
+    bool done = future->state == ASSET_READY || future->state == ASSET_FAILED;
+    al_unlock_mutex(loader_mutex);
+    return done;
+}
+
+/*
+* Block until the asset is decoded. Returns the memory bitmap, or NULL if it
+* failed to load.
+*/
+ALLEGRO_BITMAP* asset_future_wait(Asset_Future* future) {
+    al_lock_mutex(loader_mutex);
+    waiting++;
+    while(future->state == ASSET_PENDING) {
+        al_wait_cond(loader_cond, loader_mutex);
+    }
+    ALLEGRO_BITMAP* bmp = future->bitmap;
+    waiting--;
+    /* asset_loader_stop may be waiting for us to leave before tearing down */
+    al_broadcast_cond(loader_cond);
+    al_unlock_mutex(loader_mutex);
+    return bmp;
+}
+
+/*
+* Give the future slot back to the loader. The bitmap, if any, now belongs to
+* the caller.
+*/
+void asset_future_release(Asset_Future* future) {
+    al_lock_mutex(loader_mutex);
+    future->bitmap = NULL;
+    future->state  = ASSET_FREE;
+    al_unlock_mutex(loader_mutex);
+}
@@ -0,0 +1,216 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+/* No mmap on windows, the pack is read into a heap buffer instead */
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_image.h>         /* Allegro Image library */
+
+/* Local Includes */
+#include "asset_pack.h"
+#include "global.h"
+#include "mem_track.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+static const unsigned char* pack_data = NULL;
+static size_t pack_size = 0;
+static const Asset_Pack_Entry* pack_entries = NULL;
+static uint32_t pack_entry_count = 0;
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static const Asset_Pack_Entry* find_entry(const char* name) {
+    for(uint32_t i = 0; i < pack_entry_count; i++) {
+        if(strncmp(pack_entries[i].name, name, ASSET_NAME_SIZE) == 0) {
+            return &pack_entries[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Map a whole file read only (read into a heap buffer where there is no mmap).
+* Returns NULL if it can't be opened or is empty. Release with unmap_file.
+*/
+const unsigned char* map_file(const char* path, size_t* size) {
+#ifdef _WIN32
+    FILE* fp = fopen(path, "rb");
+    if(!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char* buffer = (length > 0)? MEM_ALLOC(MEM_ASSETS, length) : NULL;
+    if(!buffer || fread(buffer, 1, length, fp) != (size_t)length) {
+        mem_free(buffer);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *size = length;
+    return buffer;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping keeps the file alive, the descriptor is no longer needed */
+    close(fd);
+    if(mapped == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return mapped;
+#endif
+}
+
+void unmap_file(const unsigned char* data, size_t size) {
+#ifdef _WIN32
+    mem_free((void*)data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+/*
+* Resolve an asset file name relative to the executable rather than the working
+* directory, so the game can be launched from anywhere.
+*/
+int asset_path(const char* file_name, char* out, size_t out_size) {
+    ALLEGRO_PATH* exe_dir = al_get_standard_path(ALLEGRO_RESOURCES_PATH);
+    int written;
+    if(exe_dir) {
+        written = snprintf(out, out_size, "%s..%cassets%c%s",
+                           al_path_cstr(exe_dir, ALLEGRO_NATIVE_PATH_SEP),
+                           ALLEGRO_NATIVE_PATH_SEP, ALLEGRO_NATIVE_PATH_SEP, file_name);
+        al_destroy_path(exe_dir);
+    } else {
+        written = snprintf(out, out_size, "../assets/%s", file_name);
+    }
+    return (written > 0 && (size_t)written < out_size)? OK : ERROR;
+}
+
+/*
+* Map a pack file produced by asset_packer and validate its index. Bitmaps are
+* created straight from the mapped pixels, nothing is decoded at runtime.
+*/
+int asset_pack_open(const char* path) {
+    if(pack_data) {
+        asset_pack_close();
+    }
+    size_t size = 0;
+    const unsigned char* data = map_file(path, &size);
+    if(!data) {
+        return ERROR;
+    }
+
+    const Asset_Pack_Header* header = (const Asset_Pack_Header*)data;
+    if(size < sizeof(Asset_Pack_Header) ||
+       header->magic != ASSET_PACK_MAGIC ||
+       header->version != ASSET_PACK_VERSION ||
+       size < sizeof(Asset_Pack_Header) + (size_t)header->entry_count * sizeof(Asset_Pack_Entry)) {
+        printf("(asset_pack_open): %s is not a valid version %d asset pack.\n", path, ASSET_PACK_VERSION);
+        unmap_file(data, size);
+        return ERROR;
+    }
+
+    const Asset_Pack_Entry* entries = (const Asset_Pack_Entry*)(data + sizeof(Asset_Pack_Header));
+    for(uint32_t i = 0; i < header->entry_count; i++) {
+        /* In 64 bits so a corrupt width * height can't wrap to a small size */
+        const Asset_Pack_Entry* e = &entries[i];
+        if(e->width == 0 || e->height == 0 ||
+           e->width > ASSET_PACK_MAX_SIDE || e->height > ASSET_PACK_MAX_SIDE ||
+           (uint64_t)e->size != (uint64_t)e->width * e->height * 4 ||
+           (uint64_t)e->offset + e->size > size) {
+            printf("(asset_pack_open): %s has a corrupt entry %u.\n", path, i);
+            unmap_file(data, size);
+            return ERROR;
+        }
+    }
+
+    pack_data        = data;
+    pack_size        = size;
+    pack_entries     = entries;
+    pack_entry_count = header->entry_count;
+    return OK;
+}
+
+void asset_pack_close() {
+    if(pack_data) {
+        unmap_file(pack_data, pack_size);
+    }
+    pack_data        = NULL;
+    pack_size        = 0;
+    pack_entries     = NULL;
+    pack_entry_count = 0;
+}
+
+bool asset_pack_is_open() {
+    return pack_data != NULL;
+}
+
+/*
+* Create a bitmap (using the current new bitmap flags) from a packed entry.
+* Returns NULL if the pack is not open or does not contain the asset.
+*/
+ALLEGRO_BITMAP* asset_pack_load_bitmap(const char* name) {
+    const Asset_Pack_Entry* entry = pack_data? find_entry(name) : NULL;
+    if(!entry) {
+        return NULL;
+    }
+    ALLEGRO_BITMAP* bmp = MEM_TRACK_BITMAP(MEM_ASSETS, al_create_bitmap(entry->width, entry->height));
+    if(!bmp) {
+        return NULL;
+    }
+    ALLEGRO_LOCKED_REGION* lr = al_lock_bitmap(bmp, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+    if(!lr) {
+        mem_destroy_bitmap(bmp);
+        return NULL;
+    }
+    const unsigned char* src = pack_data + entry->offset;
+    size_t row_bytes = entry->width * 4;
+    for(uint32_t row = 0; row < entry->height; row++) {
+        memcpy((unsigned char*)lr->data + row * lr->pitch, src + row * row_bytes, row_bytes);
+    }
+    al_unlock_bitmap(bmp);
+    return bmp;
+}
+
+/*
+* Load an asset from the pack if it is open, otherwise decode the source image
+* from the assets directory.
+*/
+ALLEGRO_BITMAP* load_asset_bitmap(const char* name) {
+    ALLEGRO_BITMAP* bmp = asset_pack_load_bitmap(name);
+    if(!bmp) {
+        char path[512];
+        if(asset_path(name, path, sizeof(path)) == OK) {
+            bmp = MEM_TRACK_BITMAP(MEM_ASSETS, al_load_bitmap(path));
+        }
+    }
+    return bmp;
+}
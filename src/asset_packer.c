@@ -0,0 +1,118 @@
+/*
+* Asset Packer
+* ============
+* Offline tool that decodes images once and writes them into a single pack of
+* raw RGBA pixel blobs plus an index, see asset_pack.h for the layout.
+*
+* usage: asset_packer <output.pak> <image> [image ...]
+*/
+/* Standard Libraries */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Allegro Libraries */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_image.h>         /* Allegro Image library */
+
+/* local Libraries */
+#include "asset_pack.h"
+#include "global.h"
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    const char* backslash = strrchr(path, '\\');
+    if(backslash > slash) slash = backslash;
+    return slash? slash + 1 : path;
+}
+
+static uint32_t align_up(uint32_t value) {
+    return (value + ASSET_PACK_ALIGNMENT - 1) & ~(uint32_t)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printf("usage: %s <output.pak> <image> [image ...]\n", argv[0]);
+        return ERROR;
+    }
+    if(!al_init() || !al_init_image_addon()) {
+        printf("couldn't initialize allegro\n");
+        return ERROR;
+    }
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+
+    uint32_t count = argc - 2;
+    Asset_Pack_Entry* entries = calloc(count, sizeof(Asset_Pack_Entry));
+    unsigned char** blobs = calloc(count, sizeof(unsigned char*));
+    if(!entries || !blobs) {
+        printf("out of memory\n");
+        return ERROR;
+    }
+
+    uint32_t offset = align_up(sizeof(Asset_Pack_Header) + count * sizeof(Asset_Pack_Entry));
+    for(uint32_t i = 0; i < count; i++) {
+        const char* path = argv[i + 2];
+        const char* name = base_name(path);
+        if(strlen(name) >= ASSET_NAME_SIZE) {
+            printf("asset name too long: %s\n", name);
+            return ERROR;
+        }
+        ALLEGRO_BITMAP* bmp = al_load_bitmap(path);
+        if(!bmp) {
+            printf("couldn't load %s\n", path);
+            return ERROR;
+        }
+        uint32_t width  = al_get_bitmap_width(bmp);
+        uint32_t height = al_get_bitmap_height(bmp);
+        if(width > ASSET_PACK_MAX_SIDE || height > ASSET_PACK_MAX_SIDE) {
+            printf("%s is larger than %dx%d\n", path, ASSET_PACK_MAX_SIDE, ASSET_PACK_MAX_SIDE);
+            return ERROR;
+        }
+        ALLEGRO_LOCKED_REGION* lr = al_lock_bitmap(bmp, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+        blobs[i] = malloc(width * height * 4);
+        if(!lr || !blobs[i]) {
+            printf("couldn't read pixels of %s\n", path);
+            return ERROR;
+        }
+        for(uint32_t row = 0; row < height; row++) {
+            memcpy(blobs[i] + row * width * 4, (unsigned char*)lr->data + row * lr->pitch, width * 4);
+        }
+        al_unlock_bitmap(bmp);
+        al_destroy_bitmap(bmp);
+
+        strncpy(entries[i].name, name, ASSET_NAME_SIZE - 1);
+        entries[i].width  = width;
+        entries[i].height = height;
+        entries[i].offset = offset;
+        entries[i].size   = width * height * 4;
+        offset = align_up(offset + entries[i].size);
+        printf("packed %-24s %4ux%-4u\n", name, width, height);
+    }
+
+    FILE* fp = fopen(argv[1], "wb");
+    if(!fp) {
+        printf("couldn't open %s for writing\n", argv[1]);
+        return ERROR;
+    }
+    Asset_Pack_Header header = {
+        .magic       = ASSET_PACK_MAGIC,
+        .version     = ASSET_PACK_VERSION,
+        .entry_count = count,
+        .reserved    = 0
+    };
+    static const unsigned char padding[ASSET_PACK_ALIGNMENT] = {0};
+    long written = 0;
+    written += fwrite(&header, 1, sizeof(header), fp);
+    written += fwrite(entries, 1, count * sizeof(Asset_Pack_Entry), fp);
+    for(uint32_t i = 0; i < count; i++) {
+        written += fwrite(padding, 1, entries[i].offset - written, fp);
+        written += fwrite(blobs[i], 1, entries[i].size, fp);
+        free(blobs[i]);
+    }
+    fclose(fp);
+    printf("wrote %u assets (%ld bytes) to %s\n", count, written, argv[1]);
+
+    free(blobs);
+    free(entries);
+    return OK;
+}
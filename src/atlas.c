@@ -0,0 +1,351 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_image.h>         /* Allegro Image library */
+
+/* Local Includes */
+#include "atlas.h"
+#include "asset_pack.h"
+#include "asset_loader.h"
+#include "global.h"
+#include "mem_track.h"
+#include "render.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+typedef struct sprite_source {
+    const char* name;
+    int frame_width;
+    int frame_height;
+} Sprite_Source;
+
+/* Source images and the size of a single frame/tile within each of them */
+static const Sprite_Source sources[SPR_COUNT] = {
+    [SPR_WIZARD]       = {"wizard.png",         64,  64},
+    [SPR_SLIME]        = {"slime.png",          32,  32},
+    [SPR_DOOR]         = {"door.png",           32, 128},
+    [SPR_FIREBOLT]     = {"firebolt.png",       16,  16},
+    [SPR_CROSSHAIR]    = {"crosshair.png",      16,  16},
+    [SPR_FOREST_TILES] = {"forest_texture.png", 64,  64}
+};
+
+static ALLEGRO_BITMAP* atlas = NULL;
+static bool headless = false;   /* frame tables only, see atlas_build_headless */
+static Atlas_Load_Stats load_stats;
+static double load_start_time = 0;
+
+/* Decodes in flight on the asset loader, one per sprite */
+static Asset_Future* pending[SPR_COUNT] = {NULL};
+static bool requested = false;
+
+/* Lookup table of packed sprites, and of every frame within each sprite */
+static Atlas_Region sprite_regions[SPR_COUNT];
+static Atlas_Region frame_regions[ATLAS_MAX_FRAMES];
+static int first_frame[SPR_COUNT];
+static int frame_count[SPR_COUNT];
+static int frame_columns[SPR_COUNT];
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Shelf packer: place sprites tallest first, left to right, opening a new shelf
+* when the current one runs out of width. Returns the total atlas height.
+*/
+static int pack_shelves(int widths[SPR_COUNT], int heights[SPR_COUNT], Atlas_Region out[SPR_COUNT]) {
+    int order[SPR_COUNT];
+    for(int i = 0; i < SPR_COUNT; i++) {
+        order[i] = i;
+    }
+    /* Insertion sort on height, there are only a handful of sprites */
+    for(int i = 1; i < SPR_COUNT; i++) {
+        int current = order[i];
+        int j = i - 1;
+        while(j >= 0 && heights[order[j]] < heights[current]) {
+            order[j+1] = order[j];
+            j--;
+        }
+        order[j+1] = current;
+    }
+
+    int shelf_x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+    for(int i = 0; i < SPR_COUNT; i++) {
+        int s = order[i];
+        if(shelf_x + widths[s] > ATLAS_MAX_WIDTH) {
+            shelf_y += shelf_height + ATLAS_PADDING;
+            shelf_x = 0;
+            shelf_height = 0;
+        }
+        out[s].x      = shelf_x;
+        out[s].y      = shelf_y;
+        out[s].width  = widths[s];
+        out[s].height = heights[s];
+        shelf_x += widths[s] + ATLAS_PADDING;
+        if(heights[s] > shelf_height) shelf_height = heights[s];
+    }
+    return shelf_y + shelf_height;
+}
+
+/*
+* Slice every packed sprite into frames, row major, and record the sub-rects.
+*/
+static int build_frame_table() {
+    int next_frame = 0;
+    for(int s = 0; s < SPR_COUNT; s++) {
+        int columns = sprite_regions[s].width / sources[s].frame_width;
+        int rows    = sprite_regions[s].height / sources[s].frame_height;
+        if(next_frame + columns * rows > ATLAS_MAX_FRAMES) {
+            printf("(atlas_build): frame table full at %s.\n", sources[s].name);
+            return ERROR;
+        }
+        first_frame[s]   = next_frame;
+        frame_count[s]   = columns * rows;
+        frame_columns[s] = columns;
+        for(int row = 0; row < rows; row++) {
+            for(int col = 0; col < columns; col++) {
+                Atlas_Region r = {
+                    .x      = sprite_regions[s].x + col * sources[s].frame_width,
+                    .y      = sprite_regions[s].y + row * sources[s].frame_height,
+                    .width  = sources[s].frame_width,
+                    .height = sources[s].frame_height
+                };
+                frame_regions[next_frame++] = r;
+            }
+        }
+    }
+    return OK;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Queue every source image on the asset loader pool. Images that cannot be
+* queued (loader not running) are decoded serially by atlas_build.
+*/
+int atlas_request_assets() {
+    if(atlas || requested) {
+        return OK;
+    }
+    load_start_time = al_get_time();
+    load_stats.from_pack = asset_pack_is_open();
+    for(int s = 0; s < SPR_COUNT; s++) {
+        pending[s] = asset_loader_request(sources[s].name);
+    }
+    requested = true;
+    return OK;
+}
+
+/*
+* Non-blocking check for whether atlas_build can run without waiting on decodes.
+*/
+bool atlas_assets_ready() {
+    if(atlas) return true;
+    if(!requested) return false;
+    for(int s = 0; s < SPR_COUNT; s++) {
+        if(pending[s] && !asset_future_is_done(pending[s])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+* Collect the decoded memory bitmaps, pack them into a single video bitmap in
+* one upload pass, and generate the sprite/frame lookup table. Must be called
+* from the display thread.
+*/
+int atlas_build() {
+    ALLEGRO_BITMAP* images[SPR_COUNT] = {NULL};
+    int widths[SPR_COUNT];
+    int heights[SPR_COUNT];
+    int status = OK;
+
+    if(atlas) {
+        return OK;
+    }
+    atlas_request_assets();
+
+    /* Anything not decoded by the pool is decoded here, as a memory bitmap */
+    int old_flags = al_get_new_bitmap_flags();
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    for(int s = 0; s < SPR_COUNT; s++) {
+        if(pending[s]) {
+            images[s] = asset_future_wait(pending[s]);
+            load_stats.asset_ms[s] = pending[s]->decode_ms;
+            asset_future_release(pending[s]);
+            pending[s] = NULL;
+        } else {
+            double asset_start = al_get_time();
+            images[s] = load_asset_bitmap(sources[s].name);
+            load_stats.asset_ms[s] = (al_get_time() - asset_start) * 1000.0;
+        }
+        if(!images[s]) {
+            printf("(atlas_build): couldn't load %s.\n", sources[s].name);
+            status = ERROR;
+            continue;
+        }
+        widths[s]  = al_get_bitmap_width(images[s]);
+        heights[s] = al_get_bitmap_height(images[s]);
+    }
+    al_set_new_bitmap_flags(old_flags);
+    requested = false;
+
+    if(status == OK) {
+        int atlas_height = pack_shelves(widths, heights, sprite_regions);
+        atlas = MEM_TRACK_BITMAP(MEM_ASSETS, al_create_bitmap(ATLAS_MAX_WIDTH, atlas_height));
+        if(!atlas) {
+            printf("(atlas_build): couldn't create %dx%d atlas.\n", ATLAS_MAX_WIDTH, atlas_height);
+            status = ERROR;
+        }
+    }
+
+    if(status == OK) {
+        ALLEGRO_BITMAP* old_target = al_get_target_bitmap();
+        al_set_target_bitmap(atlas);
+        al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+        for(int s = 0; s < SPR_COUNT; s++) {
+            al_draw_bitmap(images[s], sprite_regions[s].x, sprite_regions[s].y, 0);
+        }
+        al_set_target_bitmap(old_target);
+        status = build_frame_table();
+    }
+
+    for(int s = 0; s < SPR_COUNT; s++) {
+        if(images[s]) mem_destroy_bitmap(images[s]);
+    }
+    load_stats.total_ms = (al_get_time() - load_start_time) * 1000.0;
+    if(status != OK) {
+        atlas_destroy();
+    }
+    return status;
+}
+
+/*
+* Frame tables without any images or bitmap, every sprite one frame of its
+* source size, so the frame path can run where nothing can be decoded or
+* uploaded. Drawing from it only works through a backend that ignores the
+* texture.
+*/
+int atlas_build_headless() {
+    if(atlas) {
+        return OK;
+    }
+    int widths[SPR_COUNT];
+    int heights[SPR_COUNT];
+    for(int s = 0; s < SPR_COUNT; s++) {
+        widths[s]  = sources[s].frame_width;
+        heights[s] = sources[s].frame_height;
+    }
+    pack_shelves(widths, heights, sprite_regions);
+    if(build_frame_table() != OK) {
+        return ERROR;
+    }
+    headless = true;
+    return OK;
+}
+
+/*
+* Synchronous request + build, for callers that do not need to stay responsive.
+*/
+int atlas_initialize() {
+    atlas_request_assets();
+    return atlas_build();
+}
+
+void atlas_destroy() {
+    if(atlas) {
+        mem_destroy_bitmap(atlas);
+        atlas = NULL;
+    }
+    headless = false;
+}
+
+/*
+* Per-asset decode latency and total request-to-upload latency of the last build.
+*/
+Atlas_Load_Stats atlas_load_stats() {
+    return load_stats;
+}
+
+const char* atlas_sprite_name(Atlas_Sprite sprite) {
+    if(sprite <= SPR_NONE || sprite >= SPR_COUNT) return "none";
+    return sources[sprite].name;
+}
+
+bool atlas_is_initialized() {
+    return atlas != NULL || headless;
+}
+
+ALLEGRO_BITMAP* atlas_bitmap() {
+    return atlas;
+}
+
+/*
+* Create a sub-bitmap sharing the atlas texture. The caller owns the returned
+* bitmap and must destroy it before the atlas is destroyed.
+*/
+ALLEGRO_BITMAP* atlas_sub_bitmap(Atlas_Sprite sprite) {
+    if(!atlas || sprite <= SPR_NONE || sprite >= SPR_COUNT) {
+        return NULL;
+    }
+    Atlas_Region r = sprite_regions[sprite];
+    return al_create_sub_bitmap(atlas, r.x, r.y, r.width, r.height);
+}
+
+int atlas_frame_count(Atlas_Sprite sprite) {
+    if(sprite <= SPR_NONE || sprite >= SPR_COUNT) return 0;
+    return frame_count[sprite];
+}
+
+int atlas_frame_columns(Atlas_Sprite sprite) {
+    if(sprite <= SPR_NONE || sprite >= SPR_COUNT) return 0;
+    return frame_columns[sprite];
+}
+
+Atlas_Region atlas_sprite_region(Atlas_Sprite sprite) {
+    Atlas_Region none = {0, 0, 0, 0};
+    if(sprite <= SPR_NONE || sprite >= SPR_COUNT) return none;
+    return sprite_regions[sprite];
+}
+
+/*
+* Look up the atlas sub-rect of a single frame. Out of range frames wrap, so
+* animation code can simply keep counting.
+*/
+Atlas_Region atlas_frame(Atlas_Sprite sprite, int frame) {
+    Atlas_Region none = {0, 0, 0, 0};
+    if(sprite <= SPR_NONE || sprite >= SPR_COUNT || frame_count[sprite] == 0) {
+        return none;
+    }
+    if(frame < 0) frame = 0;
+    return frame_regions[first_frame[sprite] + frame % frame_count[sprite]];
+}
+
+/*
+* Both go through the render backend. Without an atlas bitmap (a headless
+* layout) the backend still sees the draw, Allegro just skips it.
+*/
+void atlas_draw_frame(Atlas_Sprite sprite, int frame, float dx, float dy, int flags) {
+    if(atlas_frame_count(sprite) == 0) return;
+    Atlas_Region r = atlas_frame(sprite, frame);
+    render_draw_region(atlas, r.x, r.y, r.width, r.height, 0, 0, dx, dy, 0, flags);
+}
+
+void atlas_draw_rotated_frame(Atlas_Sprite sprite, int frame, float cx, float cy, float dx, float dy, float angle, int flags) {
+    if(atlas_frame_count(sprite) == 0) return;
+    Atlas_Region r = atlas_frame(sprite, frame);
+    render_draw_region(atlas, r.x, r.y, r.width, r.height, cx, cy, dx, dy, angle, flags);
+}
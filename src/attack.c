@@ -9,12 +9,17 @@
 
 #include "attack.h"
 #include "global.h"
+#include "render.h"
+
+#define PROJECTILE_SEGMENTS 12
 
 
 Projectile initialize_projectile(int r, int damage) {
     Projectile bullet = {
         .x = 0,
         .y = 0,
+        .prev_x = 0,
+        .prev_y = 0,
         .r = r,
         .id = 0,
         .damage = damage,
@@ -31,36 +36,128 @@ Projectile initialize_projectile(int r, int damage) {
 */
 void fire_projectile(Projectile* bullet, int startx, int starty, int endx, int endy, int speed) {
     double theta = atan2(endy - starty, endx - startx);
+    launch_projectile(bullet, startx, starty, speed * cos(theta), speed * sin(theta));
+}
 
+/*
+*  Launch a projectile from a point with a velocity in pixels per tick.
+*/
+void launch_projectile(Projectile* bullet, int startx, int starty, double xspeed, double yspeed) {
     bullet->x = startx;
     bullet->y = starty;
-    // /bullet->r = 5;
-    //bullet->damage = 10;
+    bullet->prev_x = startx;
+    bullet->prev_y = starty;
     create_hitbox(&bullet->hb, bullet->x, bullet->y, bullet->r * 2, bullet->r * 2);
-    bullet->xspeed = speed * cos(theta);
-    bullet->yspeed = speed * sin(theta);
+    bullet->xspeed = xspeed;
+    bullet->yspeed = yspeed;
     bullet->live = true;
 }
 
+void initialize_projectile_pool(Projectile_Pool* pool) {
+    for(int i = 0; i < MAX_PROJECTILES; i++) {
+        pool->projectiles[i] = initialize_projectile(0, 0);
+    }
+    pool->next_free = 0;
+}
+
 /*
-*  Update projectile position.
+*  Take a free slot from the pool and launch it. Returns NULL if every
+*  projectile is already in flight.
 */
-void update_projectile(Projectile* bullet) {
-    if(bullet->live) {
-        bullet->x += bullet->xspeed;
-        bullet->y += bullet->yspeed;
-        update_hitbox_position(&bullet->hb, bullet->x, bullet->y);
+Projectile* spawn_projectile(Projectile_Pool* pool, int startx, int starty, double xspeed, double yspeed, int r, int damage) {
+    for(int n = 0; n < MAX_PROJECTILES; n++) {
+        int i = (pool->next_free + n) % MAX_PROJECTILES;
+        Projectile* bullet = &pool->projectiles[i];
+        if(bullet->live) continue;
+        *bullet = initialize_projectile(r, damage);
+        bullet->id = i;
+        pool->next_free = (i + 1) % MAX_PROJECTILES;
+        launch_projectile(bullet, startx, starty, xspeed, yspeed);
+        return bullet;
     }
+    return NULL;
 }
 
 /*
-*  Draw projectile on the screen. Temporarily draw a simple circle.
+*  Update projectile position. The whole tick of movement is swept against every
+*  active mob and wall, and the projectile stops at the earliest time of impact,
+*  so hits are found at any speed without sub-stepping. Solid tiles are checked
+*  with a raycast from the projectile's center, unless it was fired from inside
+*  one.
 */
-void draw_projectile(Projectile* bullet) {
+Projectile_Hit update_projectile(Projectile* bullet, Mob_Handler* handler, Solid_Map* tiles, Hitbox walls[], int wall_count) {
+    Projectile_Hit hit = {
+        .type      = HIT_NONE,
+        .mob_index = -1,
+        .toi       = 1.0
+    };
+    if(!bullet->live) {
+        return hit;
+    }
+    bullet->prev_x = bullet->x;
+    bullet->prev_y = bullet->y;
+
+    double toi;
+    if(handler && handler->is_initialized) {
+        for(int i = 0; i < handler->local_max_mobs; i++) {
+            if(handler->mobs[i].type == DEFAULT) continue;
+            if(swept_collision(&bullet->hb, bullet->xspeed, bullet->yspeed, &handler->mobs[i].hb, &toi) && toi < hit.toi) {
+                hit.type      = HIT_MOB;
+                hit.mob_index = i;
+                hit.toi       = toi;
+            }
+        }
+    }
+    for(int i = 0; i < wall_count; i++) {
+        if(swept_collision(&bullet->hb, bullet->xspeed, bullet->yspeed, &walls[i], &toi) && toi < hit.toi) {
+            hit.type      = HIT_WALL;
+            hit.mob_index = -1;
+            hit.toi       = toi;
+        }
+    }
+    float cx = bullet->x + bullet->r;
+    float cy = bullet->y + bullet->r;
+    Tile_Hit tile_hit;
+    if(tiles && !solid_map_point(tiles, cx, cy)
+       && solid_map_raycast(tiles, cx, cy, cx + bullet->xspeed, cy + bullet->yspeed, &tile_hit) && tile_hit.t < hit.toi) {
+        hit.type      = HIT_WALL;
+        hit.mob_index = -1;
+        hit.toi       = tile_hit.t;
+    }
+
+    bullet->x += bullet->xspeed * hit.toi;
+    bullet->y += bullet->yspeed * hit.toi;
+    update_hitbox_position(&bullet->hb, bullet->x, bullet->y);
+    if(hit.type != HIT_NONE) {
+        bullet->live = false;
+    }
+    return hit;
+}
+
+/*
+*  Draw projectile on the screen, interpolated between the last two ticks.
+*  Temporarily draw a simple circle.
+*/
+void draw_projectile(Projectile* bullet, double alpha) {
     if(bullet->live) {
-        al_draw_filled_circle(bullet->x + bullet-> r, bullet->y + bullet->r, bullet->r, al_map_rgb(255, 255, 255));
-        if(show_hitboxes) {
-            draw_hitbox(&bullet->hb, al_map_rgb(0, 0, 255));
+        float x = bullet->prev_x + (bullet->x - bullet->prev_x) * alpha;
+        float y = bullet->prev_y + (bullet->y - bullet->prev_y) * alpha;
+        /* A fan around the center, what al_draw_filled_circle would build */
+        ALLEGRO_VERTEX fan[PROJECTILE_SEGMENTS + 2];
+        ALLEGRO_COLOR white = al_map_rgb(255, 255, 255);
+        float cx = x + bullet->r;
+        float cy = y + bullet->r;
+        fan[0] = (ALLEGRO_VERTEX){cx, cy, 0, 0, 0, white};
+        for(int s = 0; s <= PROJECTILE_SEGMENTS; s++) {
+            float angle = s * 2 * ALLEGRO_PI / PROJECTILE_SEGMENTS;
+            fan[s + 1] = (ALLEGRO_VERTEX){cx + bullet->r * cosf(angle), cy + bullet->r * sinf(angle), 0, 0, 0, white};
         }
+        render_draw_prim(fan, NULL, PROJECTILE_SEGMENTS + 2, NULL, ALLEGRO_PRIM_TRIANGLE_FAN);
+    }
+}
+
+void draw_projectile_overlay(Overlay* ov, Projectile* bullet, bool hitboxes) {
+    if(bullet->live && hitboxes) {
+        draw_hitbox(ov, &bullet->hb, al_map_rgb(0, 0, 255));
     }
 }
\ No newline at end of file
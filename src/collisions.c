@@ -58,6 +58,43 @@ bool is_collision(Hitbox* hb1, Hitbox* hb2) {
   return output;
 }
 
-void draw_hitbox(Hitbox* hb, ALLEGRO_COLOR color) {
-  al_draw_rectangle(hb->x, hb->y, hb->x + hb->width, hb->y + hb->height, color, 1);
+/*
+* Clip the [t_enter, t_exit] interval against one axis of a swept test. Returns
+* false as soon as the interval becomes empty.
+*/
+static bool sweep_axis(double origin, double delta, double min, double max, double* t_enter, double* t_exit) {
+  if(delta == 0) {
+    return origin >= min && origin <= max;
+  }
+  double t1 = (min - origin) / delta;
+  double t2 = (max - origin) / delta;
+  if(t1 > t2) {
+    double temp = t1;
+    t1 = t2;
+    t2 = temp;
+  }
+  if(t1 > *t_enter) *t_enter = t1;
+  if(t2 < *t_exit)  *t_exit  = t2;
+  return *t_enter <= *t_exit;
+}
+
+/*
+* Swept AABB test: does hitbox 'moving' touch 'target' anywhere along the move
+* (dx, dy)? On a hit, toi is the fraction of the move [0, 1] at first contact,
+* so fast movers cannot tunnel through thin targets between ticks.
+*/
+bool swept_collision(Hitbox* moving, double dx, double dy, Hitbox* target, double* toi) {
+  /* Grow the target by the moving box, then cast the moving box's corner as a ray */
+  double min_x = target->x - moving->width;
+  double max_x = target->x + target->width;
+  double min_y = target->y - moving->height;
+  double max_y = target->y + target->height;
+  double t_enter = 0.0;
+  double t_exit  = 1.0;
+
+  if(!sweep_axis(moving->x, dx, min_x, max_x, &t_enter, &t_exit)) return false;
+  if(!sweep_axis(moving->y, dy, min_y, max_y, &t_enter, &t_exit)) return false;
+
+  *toi = t_enter;
+  return true;
 }
@@ -0,0 +1,94 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local Includes */
+#include "combat.h"
+#include "global.h"
+#include "log.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Type first, then target so every hit on one mob is applied together, then
+* source, then emit order. Never equal for two events, so the result doesn't
+* depend on the sort.
+*/
+static int compare_events(const void* a, const void* b) {
+    const Combat_Event* ea = a;
+    const Combat_Event* eb = b;
+    if(ea->type != eb->type)         return (ea->type < eb->type)? -1 : 1;
+    if(ea->target != eb->target)     return (ea->target < eb->target)? -1 : 1;
+    if(ea->source != eb->source)     return (ea->source < eb->source)? -1 : 1;
+    if(ea->sequence != eb->sequence) return (ea->sequence < eb->sequence)? -1 : 1;
+    return 0;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void combat_bus_initialize(Combat_Bus* bus) {
+    memset(bus, 0, sizeof(Combat_Bus));
+}
+
+/*
+* Queue an event from producer. Only the thread running that producer may
+* call this. Returns false, counting the event as dropped, if its queue is
+* full this tick.
+*/
+bool combat_emit(Combat_Bus* bus, Combat_Producer producer, Combat_Event event) {
+    Combat_Queue* q = &bus->queues[producer];
+    if(q->count >= COMBAT_QUEUE_SIZE) {
+        q->dropped++;
+        return false;
+    }
+    event.sequence = (uint32_t)producer * COMBAT_QUEUE_SIZE + q->count;
+    q->events[q->count++] = event;
+    return true;
+}
+
+/*
+* Merge the queues of producers first..last into one array from scratch, in
+* resolution order, and empty them. Returns NULL with a count of 0 if there
+* was nothing to merge or it didn't fit.
+*/
+Combat_Event* combat_collect(Combat_Bus* bus, Combat_Producer first, Combat_Producer last, Frame_Arena* scratch, int* count) {
+    int total = 0;
+    for(int p = first; p <= last; p++) {
+        total += bus->queues[p].count;
+    }
+    *count = 0;
+    Combat_Event* merged = (total > 0)? FRAME_ARENA_ARRAY(scratch, Combat_Event, total) : NULL;
+    if(total > 0 && !merged) {
+        LOG_WARN("not enough scratch to resolve %d combat events.", total);
+    }
+    for(int p = first; p <= last; p++) {
+        Combat_Queue* q = &bus->queues[p];
+        if(merged) {
+            memcpy(merged + *count, q->events, sizeof(Combat_Event) * q->count);
+            *count += q->count;
+        }
+        bus->dropped += q->dropped;
+        q->count   = 0;
+        q->dropped = 0;
+    }
+    if(*count > 1) {
+        qsort(merged, *count, sizeof(Combat_Event), compare_events);
+    }
+    return merged;
+}
+
+/*
+* Throw away everything queued, when the room or floor it refers to is gone.
+*/
+void combat_bus_clear(Combat_Bus* bus) {
+    for(int p = 0; p < CP_COUNT; p++) {
+        bus->queues[p].count = 0;
+    }
+}
@@ -0,0 +1,300 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "crowd.h"
+#include "global.h"
+#include "log.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static int cell_of(Crowd_Solver* cs, int i) {
+    int col = constrain(0, cs->grid_cols - 1, (int)(cs->x[i] / CROWD_CELL_SIZE));
+    int row = constrain(0, cs->grid_rows - 1, (int)(cs->y[i] / CROWD_CELL_SIZE));
+    return row * cs->grid_cols + col;
+}
+
+/*
+* Counting sort of the active mobs by cell. Counts become cell ends, then
+* placing the mobs back to front walks every end down to its cell's start.
+*/
+static void build_grid(Crowd_Solver* cs, int count) {
+    int cells = cs->grid_cols * cs->grid_rows;
+    memset(cs->cell_start, 0, sizeof(int) * (cells + 1));
+    for(int i = 0; i < count; i++) {
+        if(cs->radius[i] > 0) cs->cell_start[cell_of(cs, i)]++;
+    }
+    int end = 0;
+    for(int c = 0; c < cells; c++) {
+        end += cs->cell_start[c];
+        cs->cell_start[c] = end;
+    }
+    cs->cell_start[cells] = end;
+    for(int i = count - 1; i >= 0; i--) {
+        if(cs->radius[i] > 0) cs->order[--cs->cell_start[cell_of(cs, i)]] = i;
+    }
+    /* Neighbors are then read in order, not chased through the mob array */
+    for(int k = 0; k < end; k++) {
+        int i = cs->order[k];
+        cs->sorted_x[k]      = cs->x[i];
+        cs->sorted_y[k]      = cs->y[i];
+        cs->sorted_radius[k] = cs->radius[i];
+    }
+}
+
+/*
+* One pass over a band of grid rows: every mob in it gets its next center,
+* pushed out of each neighbor it overlaps. Overlapping mobs are never more
+* than a cell apart, so the 3x3 cells around a mob hold all of them, and since
+* cells are sorted row by row each row of three is one run of the order.
+*/
+static void solve_band(Crowd_Solver* cs, int band) {
+    int row_begin = band * cs->grid_rows / cs->threads;
+    int row_end   = (band + 1) * cs->grid_rows / cs->threads;
+    const float* sx = cs->sorted_x;
+    const float* sy = cs->sorted_y;
+    const float* sr = cs->sorted_radius;
+    int pairs = 0;
+    float worst = 0;
+    for(int row = row_begin; row < row_end; row++) {
+        for(int col = 0; col < cs->grid_cols; col++) {
+            int cell = row * cs->grid_cols + col;
+            int first_col = (col > 0)? col - 1 : 0;
+            int last_col  = (col + 1 < cs->grid_cols)? col + 1 : col;
+            for(int k = cs->cell_start[cell]; k < cs->cell_start[cell + 1]; k++) {
+                float xi = sx[k], yi = sy[k], ri = sr[k];
+                float push_x = 0, push_y = 0;
+                for(int nr = (row > 0)? row - 1 : 0; nr <= row + 1 && nr < cs->grid_rows; nr++) {
+                    int run_end = cs->cell_start[nr * cs->grid_cols + last_col + 1];
+                    for(int m = cs->cell_start[nr * cs->grid_cols + first_col]; m < run_end; m++) {
+                        float dx = xi - sx[m];
+                        float dy = yi - sy[m];
+                        float reach = ri + sr[m];
+                        float d2 = dx*dx + dy*dy;
+                        if(d2 >= reach*reach) continue;
+                        if(m == k) continue;
+                        float d = sqrtf(d2);
+                        float overlap = reach - d;
+                        if(d < 1e-3f) {
+                            /* Stacked exactly, split them along x by order */
+                            dx = (k < m)? -1 : 1;
+                            dy = 0;
+                            d  = 1;
+                        }
+                        push_x += dx / d * overlap * CROWD_STIFFNESS;
+                        push_y += dy / d * overlap * CROWD_STIFFNESS;
+                        if(overlap > worst) worst = overlap;
+                        if(k < m) pairs++;
+                    }
+                }
+                int i = cs->order[k];
+                cs->next_x[i] = constrain_f(ri, cs->max_px - ri, xi + push_x);
+                cs->next_y[i] = constrain_f(ri, cs->max_py - ri, yi + push_y);
+            }
+        }
+    }
+    cs->band_pairs[band] = pairs;
+    cs->band_worst[band] = worst;
+}
+
+static void* crowd_worker(ALLEGRO_THREAD* thread, void* arg) {
+    Crowd_Band* band = arg;
+    Crowd_Solver* cs = band->solver;
+    int seen = 0;
+    while(true) {
+        al_lock_mutex(cs->mutex);
+        while(!cs->stopping && cs->generation == seen) {
+            al_wait_cond(cs->work_cond, cs->mutex);
+        }
+        if(cs->stopping) {
+            al_unlock_mutex(cs->mutex);
+            break;
+        }
+        seen = cs->generation;
+        al_unlock_mutex(cs->mutex);
+
+        solve_band(cs, band->band);
+
+        al_lock_mutex(cs->mutex);
+        if(--cs->pending == 0) {
+            al_signal_cond(cs->done_cond);
+        }
+        al_unlock_mutex(cs->mutex);
+    }
+    return NULL;
+}
+
+/*
+* Run one pass on every band. The calling thread takes band 0 and waits for
+* the workers to finish the rest.
+*/
+static void run_pass(Crowd_Solver* cs) {
+    if(cs->threads == 1) {
+        solve_band(cs, 0);
+        return;
+    }
+    al_lock_mutex(cs->mutex);
+    cs->generation++;
+    cs->pending = cs->threads - 1;
+    al_broadcast_cond(cs->work_cond);
+    al_unlock_mutex(cs->mutex);
+
+    solve_band(cs, 0);
+
+    al_lock_mutex(cs->mutex);
+    while(cs->pending > 0) {
+        al_wait_cond(cs->done_cond, cs->mutex);
+    }
+    al_unlock_mutex(cs->mutex);
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Set up a solver that splits each pass over threads threads, counting the
+* caller. The solver must not move once created, its workers point into it.
+*/
+int crowd_create(Crowd_Solver* cs, int threads) {
+    memset(cs, 0, sizeof(Crowd_Solver));
+    cs->threads = 1;
+    threads = constrain(1, CROWD_MAX_THREADS, threads);
+    if(threads == 1) {
+        return OK;
+    }
+    cs->mutex     = al_create_mutex();
+    cs->work_cond = al_create_cond();
+    cs->done_cond = al_create_cond();
+    if(!cs->mutex || !cs->work_cond || !cs->done_cond) {
+        LOG_WARN("couldn't create crowd lock, solving on one thread.");
+        crowd_destroy(cs);
+        return OK;
+    }
+    for(int b = 1; b < threads; b++) {
+        cs->bands[b] = (Crowd_Band){cs, b};
+        cs->workers[b] = al_create_thread(crowd_worker, &cs->bands[b]);
+        if(!cs->workers[b]) {
+            LOG_WARN("couldn't create crowd worker %d.", b);
+            break;
+        }
+        al_start_thread(cs->workers[b]);
+        cs->threads++;
+    }
+    return OK;
+}
+
+void crowd_destroy(Crowd_Solver* cs) {
+    if(cs->mutex) {
+        al_lock_mutex(cs->mutex);
+        cs->stopping = true;
+        al_broadcast_cond(cs->work_cond);
+        al_unlock_mutex(cs->mutex);
+    }
+    for(int b = 1; b < CROWD_MAX_THREADS; b++) {
+        if(cs->workers[b]) {
+            al_join_thread(cs->workers[b], NULL);
+            al_destroy_thread(cs->workers[b]);
+            cs->workers[b] = NULL;
+        }
+    }
+    if(cs->work_cond) al_destroy_cond(cs->work_cond);
+    if(cs->done_cond) al_destroy_cond(cs->done_cond);
+    if(cs->mutex)     al_destroy_mutex(cs->mutex);
+    cs->work_cond = cs->done_cond = NULL;
+    cs->mutex   = NULL;
+    cs->threads = 1;
+}
+
+/*
+* Push apart the overlapping mobs of mobs[0..count), inside a max_px x max_py
+* room. DEFAULT and dead mobs are ignored. Runs passes until nothing overlaps
+* by more than CROWD_SETTLED or CROWD_MAX_ITERATIONS is reached. Everything
+* per solve comes from scratch, returns ERROR if it didn't fit.
+*/
+int crowd_separate(Crowd_Solver* cs, Mob* mobs, int count, int max_px, int max_py, Frame_Arena* scratch) {
+    double start = al_get_time();
+    memset(&cs->stats, 0, sizeof(Crowd_Stats));
+    cs->mobs      = mobs;
+    cs->max_px    = max_px;
+    cs->max_py    = max_py;
+    cs->grid_cols = (max_px + CROWD_CELL_SIZE - 1) / CROWD_CELL_SIZE;
+    cs->grid_rows = (max_py + CROWD_CELL_SIZE - 1) / CROWD_CELL_SIZE;
+    if(count < 2 || cs->grid_cols <= 0 || cs->grid_rows <= 0) {
+        return OK;
+    }
+    cs->cell_start = FRAME_ARENA_ARRAY(scratch, int, cs->grid_cols * cs->grid_rows + 1);
+    cs->order      = FRAME_ARENA_ARRAY(scratch, int, count);
+    cs->x          = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->y          = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->next_x     = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->next_y     = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->radius     = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->sorted_x   = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->sorted_y   = FRAME_ARENA_ARRAY(scratch, float, count);
+    cs->sorted_radius = FRAME_ARENA_ARRAY(scratch, float, count);
+    if(!cs->cell_start || !cs->order || !cs->x || !cs->y || !cs->next_x || !cs->next_y || !cs->radius ||
+       !cs->sorted_x || !cs->sorted_y || !cs->sorted_radius) {
+        LOG_WARN("not enough scratch for %d mobs.", count);
+        return ERROR;
+    }
+
+    cs->active = 0;
+    for(int i = 0; i < count; i++) {
+        Mob* m = &mobs[i];
+        if(m->type == DEFAULT || m->current_state == DEAD || m->width <= 0 || m->height <= 0) {
+            cs->radius[i] = 0;
+            continue;
+        }
+        cs->radius[i] = constrain_f(1, CROWD_CELL_SIZE / 2, ((m->width < m->height)? m->width : m->height) / 2.0f);
+        cs->x[i] = m->position[0] + m->width / 2.0f;
+        cs->y[i] = m->position[1] + m->height / 2.0f;
+        cs->next_x[i] = cs->x[i];
+        cs->next_y[i] = cs->y[i];
+        cs->active++;
+    }
+    cs->stats.mobs = cs->active;
+    if(cs->active < 2) {
+        return OK;
+    }
+
+    for(int iteration = 0; iteration < CROWD_MAX_ITERATIONS; iteration++) {
+        build_grid(cs, count);
+        run_pass(cs);
+        float worst = 0;
+        int pairs = 0;
+        for(int b = 0; b < cs->threads; b++) {
+            pairs += cs->band_pairs[b];
+            if(cs->band_worst[b] > worst) worst = cs->band_worst[b];
+        }
+        if(iteration == 0) cs->stats.pairs = pairs;
+        cs->stats.worst_overlap = worst;
+        cs->stats.iterations++;
+        float* swap = cs->x; cs->x = cs->next_x; cs->next_x = swap;
+        swap = cs->y; cs->y = cs->next_y; cs->next_y = swap;
+        if(worst < CROWD_SETTLED) break;
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(cs->radius[i] == 0) continue;
+        Mob* m = &mobs[i];
+        int px = constrain(0, max_px - m->width, (int)lroundf(cs->x[i] - m->width / 2.0f));
+        int py = constrain(0, max_py - m->height, (int)lroundf(cs->y[i] - m->height / 2.0f));
+        if(px != m->position[0] || py != m->position[1]) {
+            m->position[0] = px;
+            m->position[1] = py;
+            update_hitbox_position(&m->hb, px, py);
+        }
+    }
+    cs->stats.solve_ms = (al_get_time() - start) * 1000.0;
+    return OK;
+}
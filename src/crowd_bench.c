@@ -0,0 +1,88 @@
+/*
+* Crowd separation benchmark. Scatters slimes over a room sized so they cover
+* about half of it, walks them around like update_slime does and times the
+* separation pass each tick.
+*
+* usage: crowd_bench [mobs] [ticks] [threads]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "crowd.h"
+#include "random.h"
+#include "global.h"
+#include "mem_track.h"
+
+#define SLIME_SIZE 32
+
+int main(int argc, char** argv) {
+    int count   = (argc > 1)? atoi(argv[1]) : 5000;
+    int ticks   = (argc > 2)? atoi(argv[2]) : 600;
+    int threads = (argc > 3)? atoi(argv[3]) : 1;
+    count = constrain(2, 1000000, count);
+    ticks = constrain(1, 100000, ticks);
+
+    if(!al_init()) {
+        printf("couldn't initialize allegro\n");
+        return ERROR;
+    }
+    Rng rng;
+    rng_initialize(&rng);
+    int width  = (int)sqrtf(count * SLIME_SIZE * SLIME_SIZE * 2 * 4 / 3.0f);
+    int height = width * 3 / 4;
+
+    Mob* mobs = MEM_CALLOC(MEM_MOBS, count, sizeof(Mob));
+    Frame_Arena scratch;
+    if(!mobs || frame_arena_create(&scratch, (size_t)count * 64 + (size_t)(width / 8) * (height / 8) + 4096, MEM_SIM) != OK) {
+        printf("out of memory\n");
+        return ERROR;
+    }
+    for(int i = 0; i < count; i++) {
+        Mob* m = &mobs[i];
+        m->type          = SLIME;
+        m->current_state = IDLE;
+        m->width         = SLIME_SIZE;
+        m->height        = SLIME_SIZE;
+        m->speed         = rng_random_int(&rng, 6, 10);
+        m->dir           = rng_random_int(&rng, 0, 1);
+        m->position[0]   = rng_random_int(&rng, 0, width - SLIME_SIZE);
+        m->position[1]   = rng_random_int(&rng, 0, height - SLIME_SIZE);
+        create_hitbox(&m->hb, m->position[0], m->position[1], SLIME_SIZE, SLIME_SIZE);
+    }
+
+    Crowd_Solver crowd;
+    crowd_create(&crowd, threads);
+    double total = 0, worst = 0;
+    long long pairs = 0, iterations = 0;
+    for(int t = 0; t < ticks; t++) {
+        /* Same walk as update_slime, back and forth across the room */
+        for(int i = 0; i < count; i++) {
+            Mob* m = &mobs[i];
+            if(m->position[0] <= 0) m->dir = 0;
+            if(m->position[0] + m->width >= width) m->dir = 1;
+            m->position[0] = constrain(0, width - m->width, m->position[0] + ((m->dir == 0)? m->speed : -m->speed));
+            update_hitbox_position(&m->hb, m->position[0], m->position[1]);
+        }
+        crowd_separate(&crowd, mobs, count, width, height, &scratch);
+        frame_arena_reset(&scratch);
+        total += crowd.stats.solve_ms;
+        if(crowd.stats.solve_ms > worst) worst = crowd.stats.solve_ms;
+        pairs += crowd.stats.pairs;
+        iterations += crowd.stats.iterations;
+    }
+
+    printf("%d mobs in a %dx%d room, %d ticks on %d threads\n", count, width, height, ticks, crowd.threads);
+    printf("  solve:      %.3f ms per tick on average, %.3f ms worst\n", total / ticks, worst);
+    printf("  pairs:      %.1f overlapping per tick, %.2f passes per tick\n", (double)pairs / ticks, (double)iterations / ticks);
+    printf("  scratch:    %zu B peak\n", scratch.high_water);
+    crowd_destroy(&crowd);
+    frame_arena_destroy(&scratch);
+    mem_free(mobs);
+    return OK;
+}
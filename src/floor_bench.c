@@ -0,0 +1,59 @@
+/*
+* Floor generation benchmark. Generates square floors of growing size and
+* reports generation time against floor area, along with how much of the
+* chunked map ended up allocated.
+*
+* usage: floor_bench [max side] [runs per size]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Local Includes */
+#include "terrain.h"
+#include "game_context.h"
+#include "global.h"
+#include "log.h"
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    int max_side = (argc > 1)? atoi(argv[1]) : 1024;
+    int runs     = (argc > 2)? atoi(argv[2]) : 3;
+    runs = constrain(1, 1000, runs);
+
+    static Game_Context game;
+    game_context_initialize(&game, (uint64_t)time(NULL));
+    /* Keep the per floor summaries out of the table */
+    log_set_level(LOG_LEVEL_WARN);
+    printf("%8s %10s %10s %10s %10s %8s %10s\n", "side", "area", "gen ms", "ns/cell", "rooms", "chunks", "map MB");
+    for(int side = 64; side <= max_side; side *= 2) {
+        double total = 0;
+        int rooms = 0, chunks = 0;
+        for(int r = 0; r < runs; r++) {
+            Floor f;
+            double start = now_seconds();
+            if(generate_floor(&f, &game, 1, side, side, side/2, side/2) != OK) {
+                printf("(main): couldn't generate a %dx%d floor.\n", side, side);
+                return ERROR;
+            }
+            total += now_seconds() - start;
+            rooms  = f.room_count;
+            chunks = f.chunk_count;
+            destroy_floor(&f);
+        }
+        double area = (double)side * side;
+        double ms   = total * 1000.0 / runs;
+        printf("%8d %10.0f %10.2f %10.1f %10d %8d %10.1f\n",
+               side, area, ms, ms * 1e6 / area, rooms, chunks,
+               (chunks * sizeof(Floor_Chunk) + sizeof(Floor_Chunk*) * ((side + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT) * ((side + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT)) / (1024.0 * 1024.0));
+        /* Always include the requested size, even off the power of two ladder */
+        if(side < max_side && side * 2 > max_side) side = max_side / 2;
+    }
+    return OK;
+}
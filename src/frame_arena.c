@@ -0,0 +1,54 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Local Includes */
+#include "frame_arena.h"
+#include "global.h"
+#include "log.h"
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Allocate both buffers up front, this is the only time the arena touches the
+* heap.
+*/
+int frame_arena_create(Frame_Arena* arena, size_t capacity, Mem_Tag tag) {
+    memset(arena, 0, sizeof(Frame_Arena));
+    arena->capacity = capacity;
+    arena->tag      = tag;
+    for(int b = 0; b < 2; b++) {
+        arena->buffers[b] = MEM_ALLOC(tag, capacity);
+        if(!arena->buffers[b]) {
+            LOG_ERROR("couldn't allocate %zu byte %s arena.", capacity, mem_tag_name(tag));
+            frame_arena_destroy(arena);
+            return ERROR;
+        }
+    }
+    return OK;
+}
+
+void frame_arena_destroy(Frame_Arena* arena) {
+    for(int b = 0; b < 2; b++) {
+        mem_free(arena->buffers[b]);
+        arena->buffers[b] = NULL;
+    }
+    arena->capacity = 0;
+    arena->used     = 0;
+}
+
+/*
+* End of frame: record how much was used and start the next frame on the other
+* buffer. Whatever the other buffer held (two frames ago) is gone.
+*/
+void frame_arena_reset(Frame_Arena* arena) {
+    arena->last_used = arena->used;
+    if(arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    arena->current ^= 1;
+    arena->used = 0;
+}
@@ -0,0 +1,20 @@
+/* Standard Includes */
+#include <string.h>
+
+/* Local Includes */
+#include "game_context.h"
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Start a game's context from seed. Games seeded alike generate the same
+* floors and spawns, whichever thread runs them.
+*/
+void game_context_initialize(Game_Context* game, uint64_t seed) {
+    memset(game, 0, sizeof(Game_Context));
+    rng_seed(&game->rng, seed);
+    game->mobs = default_mob_handler();
+}
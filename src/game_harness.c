@@ -0,0 +1,253 @@
+/*
+* Many games in one process. Plays games headless on worker threads, each game
+* its own simulation ticked straight through by a simple bot: it wanders in a
+* new direction every so often, fires at the nearest slime and tries the
+* interact key once a room is clear. Games share nothing mutable, and game n
+* is always seeded with n, so the checksum over all games comes out the same
+* however many threads play them. Reports what each thread got through and
+* the ticks per second overall.
+*
+* usage: game_harness [games] [threads] [ticks per game]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "simulation.h"
+#include "atlas.h"
+#include "random.h"
+#include "global.h"
+#include "log.h"
+#include "mem_track.h"
+
+#define HARNESS_MAX_THREADS 64
+#define BOT_TURN_TICKS      45      /* ticks between changes of direction */
+#define BOT_FIRE_INTERVAL   8       /* ticks between shots */
+
+struct harness;
+
+/* Per thread counters, each on its own cache line */
+typedef struct harness_worker {
+    ALLEGRO_THREAD* thread;
+    struct harness* harness;
+    int games;
+    int deaths;
+    int deepest_floor;
+    int64_t ticks;
+    double tick_seconds;
+    double worst_tick_ms;
+    uint64_t checksum;      /* sum over the games this thread played */
+} __attribute__((aligned(64))) Harness_Worker;
+
+typedef struct harness {
+    int games;
+    int ticks_per_game;
+    int next_game;          /* the only thing workers share, taken atomically */
+    Harness_Worker workers[HARNESS_MAX_THREADS];
+} Harness;
+
+static const int move_keys[] = {ALLEGRO_KEY_W, ALLEGRO_KEY_A, ALLEGRO_KEY_S, ALLEGRO_KEY_D};
+
+static void push_event(Simulation* sim, int type, int keycode, int button, float x, float y) {
+    ALLEGRO_EVENT event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.any.timestamp = al_get_time();
+    if(keycode) {
+        event.keyboard.keycode = keycode;
+    } else {
+        event.mouse.button = button;
+        event.mouse.x = (int)x;
+        event.mouse.y = (int)y;
+    }
+    simulation_push_input(sim, &event);
+}
+
+static void press_key(Simulation* sim, int keycode, bool down) {
+    push_event(sim, down? ALLEGRO_EVENT_KEY_DOWN : ALLEGRO_EVENT_KEY_UP, keycode, 0, 0, 0);
+}
+
+/*
+* Closest live mob in the room, NULL if the room is clear.
+*/
+static Mob* nearest_mob(Simulation* sim) {
+    Mob_Handler* mh = sim->current_room->m_handler_p;
+    Mob* p = &sim->player;
+    Mob* best = NULL;
+    float best_distance = 0;
+    for(int i = 0; i < mh->local_max_mobs; i++) {
+        Mob* m = &mh->mobs[i];
+        if(m->type == DEFAULT || m->current_state == DEAD) continue;
+        float dx = m->position[0] - p->position[0];
+        float dy = m->position[1] - p->position[1];
+        float distance = dx*dx + dy*dy;
+        if(!best || distance < best_distance) {
+            best = m;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+/*
+* Queue this tick's input. The bot rolls from its own generator, so it never
+* disturbs the game's.
+*/
+static void bot_input(Simulation* sim, Rng* bot, int tick, int* move_key) {
+    if(tick % BOT_TURN_TICKS == 0) {
+        if(*move_key) press_key(sim, *move_key, false);
+        *move_key = move_keys[rng_random_int(bot, 0, 3)];
+        press_key(sim, *move_key, true);
+    }
+    Mob* target = nearest_mob(sim);
+    if(target && tick % BOT_FIRE_INTERVAL == 0) {
+        push_event(sim, ALLEGRO_EVENT_MOUSE_BUTTON_DOWN, 0, 1,
+                   target->position[0] + target->width/2, target->position[1] + target->height/2);
+    } else if(target && tick % BOT_FIRE_INTERVAL == 1) {
+        push_event(sim, ALLEGRO_EVENT_MOUSE_BUTTON_UP, 0, 1, 0, 0);
+    } else if(!target && tick % BOT_TURN_TICKS == 1) {
+        press_key(sim, ALLEGRO_KEY_E, true);
+    } else if(!target && tick % BOT_TURN_TICKS == 2) {
+        press_key(sim, ALLEGRO_KEY_E, false);
+    }
+}
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+/*
+* Play game number n to the end or to the tick limit.
+*/
+static int play_game(Harness* h, Harness_Worker* w, int n) {
+    Simulation* sim = create_simulation((uint64_t)n);
+    if(!sim) {
+        return ERROR;
+    }
+    Rng bot;
+    rng_seed(&bot, ~(uint64_t)n);
+    int move_key = 0;
+
+    simulation_set_assets_ready(sim);
+    press_key(sim, ALLEGRO_KEY_ENTER, true);
+    simulation_tick(sim);
+    press_key(sim, ALLEGRO_KEY_ENTER, false);
+    if(sim->game_state != GS_RUNNING) {
+        destroy_simulation(sim);
+        return ERROR;
+    }
+
+    int tick;
+    for(tick = 0; tick < h->ticks_per_game && sim->game_state == GS_RUNNING; tick++) {
+        bot_input(sim, &bot, tick, &move_key);
+        double start = al_get_time();
+        simulation_tick(sim);
+        double seconds = al_get_time() - start;
+        w->tick_seconds += seconds;
+        if(seconds * 1000.0 > w->worst_tick_ms) w->worst_tick_ms = seconds * 1000.0;
+    }
+
+    bool died = sim->game_state != GS_RUNNING;
+    uint64_t sum = mix(0, (uint64_t)n);
+    sum = mix(sum, (uint64_t)tick);
+    sum = mix(sum, (uint64_t)sim->floor.number);
+    sum = mix(sum, (uint64_t)died);
+    sum = mix(sum, (uint64_t)sim->player.position[0]);
+    sum = mix(sum, (uint64_t)sim->player.position[1]);
+    sum = mix(sum, (uint64_t)(int64_t)sim->player.current_health);
+    sum = mix(sum, rng_get_state(&sim->game.rng));
+
+    w->games++;
+    w->ticks    += tick;
+    w->deaths   += died;
+    w->checksum += sum;
+    if(sim->floor.number > w->deepest_floor) w->deepest_floor = sim->floor.number;
+    destroy_simulation(sim);
+    return OK;
+}
+
+static void* harness_thread(ALLEGRO_THREAD* thread, void* arg) {
+    Harness_Worker* w = arg;
+    Harness* h = w->harness;
+    int n;
+    while((n = __atomic_fetch_add(&h->next_game, 1, __ATOMIC_RELAXED)) < h->games) {
+        if(play_game(h, w, n) != OK) {
+            LOG_ERROR("game %d couldn't start.", n);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int games   = (argc > 1)? atoi(argv[1]) : 200;
+    int threads = (argc > 2)? atoi(argv[2]) : 4;
+    int ticks   = (argc > 3)? atoi(argv[3]) : 3600;
+    games   = constrain(1, 1000000, games);
+    threads = constrain(1, HARNESS_MAX_THREADS, threads);
+    ticks   = constrain(1, 10000000, ticks);
+
+    if(!al_init()) {
+        printf("couldn't initialize allegro\n");
+        return ERROR;
+    }
+    /* Keep the per floor summaries out of the table */
+    log_set_level(LOG_LEVEL_WARN);
+    /* Rooms only need the frame tables, and those are read only from here on */
+    if(atlas_build_headless() != OK) {
+        printf("couldn't set up the atlas\n");
+        return ERROR;
+    }
+
+    static Harness h;
+    h.games          = games;
+    h.ticks_per_game = ticks;
+    h.next_game      = 0;
+
+    double start = al_get_time();
+    for(int t = 0; t < threads; t++) {
+        h.workers[t].harness = &h;
+        h.workers[t].thread  = al_create_thread(harness_thread, &h.workers[t]);
+        if(!h.workers[t].thread) {
+            printf("couldn't create thread %d\n", t);
+            return ERROR;
+        }
+        al_start_thread(h.workers[t].thread);
+    }
+    for(int t = 0; t < threads; t++) {
+        al_join_thread(h.workers[t].thread, NULL);
+        al_destroy_thread(h.workers[t].thread);
+    }
+    double wall = al_get_time() - start;
+
+    Harness_Worker total;
+    memset(&total, 0, sizeof(total));
+    printf("%d games of up to %d ticks on %d threads\n", games, ticks, threads);
+    printf("%8s %8s %8s %10s %10s %10s %12s\n", "thread", "games", "deaths", "ticks", "us/tick", "worst ms", "ticks/s");
+    for(int t = 0; t < threads; t++) {
+        Harness_Worker* w = &h.workers[t];
+        printf("%8d %8d %8d %10lld %10.2f %10.3f %12.0f\n", t, w->games, w->deaths, (long long)w->ticks,
+               w->ticks? w->tick_seconds * 1e6 / w->ticks : 0.0, w->worst_tick_ms,
+               w->tick_seconds > 0? w->ticks / w->tick_seconds : 0.0);
+        total.games    += w->games;
+        total.deaths   += w->deaths;
+        total.ticks    += w->ticks;
+        total.checksum += w->checksum;
+        if(w->deepest_floor > total.deepest_floor) total.deepest_floor = w->deepest_floor;
+        if(w->worst_tick_ms > total.worst_tick_ms) total.worst_tick_ms = w->worst_tick_ms;
+    }
+    printf("  %d games, %d deaths, deepest floor %d\n", total.games, total.deaths, total.deepest_floor);
+    printf("  %lld ticks in %.2f s, %.0f ticks/s overall, %.3f ms worst tick\n",
+           (long long)total.ticks, wall, wall > 0? total.ticks / wall : 0.0, total.worst_tick_ms);
+    printf("  checksum %016llx\n", (unsigned long long)total.checksum);
+    Mem_Tag_Stats sim_memory = mem_tag_stats(MEM_SIM);
+    printf("  simulation memory peaked at %.1f MB, %lld B still live\n",
+           sim_memory.peak_bytes / (1024.0 * 1024.0), (long long)sim_memory.live_bytes);
+    return (total.games == games)? OK : ERROR;
+}
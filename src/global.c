@@ -2,8 +2,6 @@
 
 #include "global.h"
 
-bool show_hitboxes = false;
-
 int constrain(int min, int max, int val) {
     if(val <= min) {
         return min;
@@ -23,7 +21,3 @@ float constrain_f(float min, float max, float val) {
         return val;
     }
 }
-
-void toggle_hitboxes() {
-    show_hitboxes = !show_hitboxes;
-}
\ No newline at end of file
@@ -0,0 +1,166 @@
+/* Standard Includes */
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "input.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static Input_Action key_to_action(int keycode) {
+    switch(keycode) {
+        case ALLEGRO_KEY_W:      return ACT_MOVE_UP;
+        case ALLEGRO_KEY_S:      return ACT_MOVE_DOWN;
+        case ALLEGRO_KEY_A:      return ACT_MOVE_LEFT;
+        case ALLEGRO_KEY_D:      return ACT_MOVE_RIGHT;
+        case ALLEGRO_KEY_E:      return ACT_INTERACT;
+        case ALLEGRO_KEY_ENTER:  return ACT_CONFIRM;
+        case ALLEGRO_KEY_ESCAPE: return ACT_QUIT;
+        case ALLEGRO_KEY_T:      return ACT_DEV_TOOLS;
+        case ALLEGRO_KEY_H:      return ACT_TOGGLE_HITBOXES;
+        case ALLEGRO_KEY_K:      return ACT_KILL_ROOM;
+        case ALLEGRO_KEY_F5:     return ACT_QUICKSAVE;
+        case ALLEGRO_KEY_F9:     return ACT_QUICKLOAD;
+        case ALLEGRO_KEY_P:      return ACT_REWIND_PAUSE;
+        case ALLEGRO_KEY_LEFT:   return ACT_STEP_BACK;
+        case ALLEGRO_KEY_RIGHT:  return ACT_STEP_FORWARD;
+        default:                 return ACT_NONE;
+    }
+}
+
+static Input_Action mouse_to_action(unsigned int button) {
+    switch(button) {
+        case 1:  return ACT_FIRE_PRIMARY;
+        case 2:  return ACT_FIRE_SECONDARY;
+        default: return ACT_NONE;
+    }
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void input_ring_initialize(Input_Ring* ring) {
+    memset(ring, 0, sizeof(Input_Ring));
+}
+
+/*
+* Map an allegro device event onto an action event. Returns false for events
+* that do not affect gameplay input.
+*/
+bool input_translate_event(ALLEGRO_EVENT* event, Input_Event* out) {
+    out->timestamp = event->any.timestamp;
+    out->action       = ACT_NONE;
+    out->has_position = false;
+    out->x            = 0;
+    out->y            = 0;
+    switch(event->type) {
+        case ALLEGRO_EVENT_KEY_DOWN:
+        case ALLEGRO_EVENT_KEY_UP:
+            out->type   = (event->type == ALLEGRO_EVENT_KEY_DOWN)? INPUT_ACTION_DOWN : INPUT_ACTION_UP;
+            out->action = key_to_action(event->keyboard.keycode);
+            return out->action != ACT_NONE;
+        case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+        case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+            out->type   = (event->type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN)? INPUT_ACTION_DOWN : INPUT_ACTION_UP;
+            out->action       = mouse_to_action(event->mouse.button);
+            out->has_position = true;
+            out->x            = event->mouse.x;
+            out->y            = event->mouse.y;
+            return out->action != ACT_NONE;
+        case ALLEGRO_EVENT_MOUSE_AXES:
+            out->type         = INPUT_MOUSE_MOVE;
+            out->has_position = true;
+            out->x            = event->mouse.x;
+            out->y            = event->mouse.y;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+* Producer side. Never blocks, if the simulation has fallen a full ring behind
+* the event is dropped and counted.
+*/
+bool input_push(Input_Ring* ring, Input_Event* event) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if(head - tail >= INPUT_RING_SIZE) {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    ring->events[head & (INPUT_RING_SIZE - 1)] = *event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*
+* Consumer side. Returns false once the ring is empty.
+*/
+bool input_pop(Input_Ring* ring, Input_Event* event) {
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if(tail == head) {
+        return false;
+    }
+    *event = ring->events[tail & (INPUT_RING_SIZE - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+Input_State default_input_state() {
+    Input_State state;
+    memset(&state, 0, sizeof(Input_State));
+    return state;
+}
+
+/*
+* Fold every queued event into the action bitsets for the coming tick. Presses
+* and releases within the same tick both register, so quick taps are not lost.
+*/
+void input_begin_tick(Input_State* state, Input_Ring* ring) {
+    Input_Event event;
+    state->pressed           = 0;
+    state->released          = 0;
+    state->oldest_event_time = 0;
+    state->events_this_tick  = 0;
+
+    while(input_pop(ring, &event)) {
+        if(state->events_this_tick++ == 0) {
+            state->oldest_event_time = event.timestamp;
+        }
+        if(event.has_position) {
+            state->mouse_x = event.x;
+            state->mouse_y = event.y;
+        }
+        if(event.type == INPUT_MOUSE_MOVE) continue;
+
+        uint32_t bit = 1u << event.action;
+        if(event.type == INPUT_ACTION_DOWN) {
+            if(!(state->held & bit)) {
+                state->pressed |= bit;
+                state->press_time[event.action] = event.timestamp;
+            }
+            state->held |= bit;
+        } else {
+            state->held &= ~bit;
+            state->released |= bit;
+        }
+    }
+}
+
+/*
+* Forget every held action, used when switching game states.
+*/
+void input_clear(Input_State* state) {
+    state->held     = 0;
+    state->pressed  = 0;
+    state->released = 0;
+}
@@ -0,0 +1,134 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Local Includes */
+#include "latency.h"
+#include "global.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static void histogram_add(Latency_Histogram* h, double ms) {
+    int bucket = constrain(0, LATENCY_BUCKETS - 1, (int)(ms / LATENCY_BUCKET_MS));
+    h->buckets[bucket]++;
+    if(h->count == 0 || ms < h->min_ms) h->min_ms = ms;
+    if(h->count == 0 || ms > h->max_ms) h->max_ms = ms;
+    h->count++;
+    h->total_ms += ms;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void latency_queue_initialize(Latency_Queue* q) {
+    memset(q, 0, sizeof(Latency_Queue));
+    q->next_id = 1;
+}
+
+/*
+* Simulation thread: remember an input the current tick acted on. Older
+* samples are overwritten once LATENCY_PENDING newer ones exist.
+*/
+void latency_queue_push(Latency_Queue* q, Latency_Kind kind, int64_t tick, double input_time, double tick_time) {
+    Latency_Sample* s = &q->samples[q->next_id % LATENCY_PENDING];
+    s->id         = q->next_id++;
+    s->kind       = kind;
+    s->tick       = tick;
+    s->input_time = input_time;
+    s->tick_time  = tick_time;
+}
+
+/*
+* A NULL log_path only keeps the in memory histograms.
+*/
+int latency_recorder_initialize(Latency_Recorder* r, const char* log_path) {
+    memset(r, 0, sizeof(Latency_Recorder));
+    if(!log_path) {
+        return OK;
+    }
+    r->log = fopen(log_path, "w");
+    if(!r->log) {
+        printf("(latency_recorder_initialize): couldn't open %s.\n", log_path);
+        return ERROR;
+    }
+    fprintf(r->log, "kind,tick,input_to_tick_ms,tick_to_present_ms,input_to_present_ms\n");
+    return OK;
+}
+
+void latency_recorder_close(Latency_Recorder* r) {
+    if(r->log) {
+        fclose(r->log);
+        r->log = NULL;
+    }
+}
+
+/*
+* Render thread: called right after al_flip_display with the samples of the
+* snapshot that was just presented. Only samples not seen on an earlier frame
+* are counted, so each input is measured to the first frame that showed it.
+* Returns the number of new samples.
+*/
+int latency_record_presented(Latency_Recorder* r, const Latency_Sample samples[LATENCY_PENDING], double present_time) {
+    uint32_t newest = r->last_id;
+    int recorded = 0;
+    for(int i = 0; i < LATENCY_PENDING; i++) {
+        const Latency_Sample* s = &samples[i];
+        if(s->id == 0 || s->id <= r->last_id) continue;
+
+        double to_present = (present_time - s->input_time) * 1000.0;
+        histogram_add(&r->histograms[s->kind], to_present);
+        if(r->log) {
+            fprintf(r->log, "%s,%lld,%.3f,%.3f,%.3f\n", latency_kind_name(s->kind), (long long)s->tick,
+                    (s->tick_time - s->input_time) * 1000.0, (present_time - s->tick_time) * 1000.0, to_present);
+        }
+        if(s->id > newest) newest = s->id;
+        recorded++;
+    }
+    r->last_id = newest;
+    return recorded;
+}
+
+double latency_mean(Latency_Histogram* h) {
+    return (h->count > 0)? h->total_ms / h->count : 0;
+}
+
+/*
+* Upper edge of the bucket holding the p-th percentile, p in [0, 1].
+*/
+double latency_percentile(Latency_Histogram* h, double p) {
+    if(h->count == 0) {
+        return 0;
+    }
+    int target = (int)(p * (h->count - 1)) + 1;
+    int seen = 0;
+    for(int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if(seen >= target) {
+            return (b + 1) * LATENCY_BUCKET_MS;
+        }
+    }
+    return h->max_ms;
+}
+
+const char* latency_kind_name(Latency_Kind kind) {
+    switch(kind) {
+        case LAT_FIRE: return "fire";
+        case LAT_MOVE: return "move";
+        default:       return "unknown";
+    }
+}
+
+void latency_print_report(Latency_Recorder* r) {
+    printf("Input to present latency:\n");
+    for(int k = 0; k < LAT_KIND_COUNT; k++) {
+        Latency_Histogram* h = &r->histograms[k];
+        if(h->count == 0) continue;
+        printf("  %-5s n=%-5d mean %.1f ms, p50 %.0f ms, p95 %.0f ms, max %.1f ms\n", latency_kind_name(k), h->count,
+               latency_mean(h), latency_percentile(h, 0.5), latency_percentile(h, 0.95), h->max_ms);
+    }
+}
@@ -0,0 +1,265 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "log.h"
+#include "global.h"
+
+#define LOG_IDLE_SLEEP 0.01     /* seconds the log thread naps when the ring is empty */
+
+/*
+* One slot of the ring. sequence says who owns it: equal to the enqueue
+* position it is free for that producer, one past it the record is ready for
+* the log thread.
+*/
+typedef struct log_record {
+    uint32_t sequence;
+    int level;
+    int suppressed;
+    double time;
+    const char* func;
+    char message[LOG_MESSAGE_SIZE];
+} Log_Record;
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+static Log_Record ring[LOG_RING_SIZE];
+static uint32_t ring_head = 0;      /* next enqueue position, shared by producers */
+static uint32_t ring_tail = 0;      /* next dequeue position, log thread only */
+
+static ALLEGRO_THREAD* log_thread = NULL;
+static FILE* log_file = NULL;
+static bool running = false;
+static int runtime_level = LOG_LEVEL_DEBUG;
+static int echo_level = LOG_LEVEL_WARN;
+static struct timespec start_time;
+static Log_Stats stats;
+
+static const char* level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static double seconds_since_start() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec - start_time.tv_sec) + (ts.tv_nsec - start_time.tv_nsec) * 1e-9;
+}
+
+/*
+* Count a message against its call site. Returns false once the site has used
+* up its window, otherwise hands back how many messages it suppressed since
+* the last one that got through.
+*/
+static bool log_allow(Log_Limiter* limiter, double now, int* suppressed) {
+    int64_t now_ms = (int64_t)(now * 1000.0);
+    int64_t window = __atomic_load_n(&limiter->window_start, __ATOMIC_RELAXED);
+    if(now_ms - window >= LOG_RATE_WINDOW || window == 0) {
+        if(__atomic_compare_exchange_n(&limiter->window_start, &window, now_ms > 0 ? now_ms : 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&limiter->count, 0, __ATOMIC_RELAXED);
+        }
+    }
+    if(__atomic_fetch_add(&limiter->count, 1, __ATOMIC_RELAXED) >= LOG_RATE_LIMIT) {
+        __atomic_fetch_add(&limiter->suppressed, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats.suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *suppressed = __atomic_exchange_n(&limiter->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void print_record(FILE* out, Log_Record* record) {
+    fprintf(out, "%10.3f %-5s (%s): %s", record->time, level_names[record->level], record->func, record->message);
+    if(record->suppressed > 0) {
+        fprintf(out, " [%d similar suppressed]", record->suppressed);
+    }
+    fputc('\n', out);
+}
+
+/*
+* Write out every ready record. Only the log thread calls this while the
+* logger is running, so the tail needs no synchronization of its own.
+*/
+static int log_drain() {
+    int drained = 0;
+    while(true) {
+        Log_Record* record = &ring[ring_tail & (LOG_RING_SIZE - 1)];
+        if(__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) != ring_tail + 1) {
+            break;
+        }
+        if(log_file) print_record(log_file, record);
+        if(record->level >= echo_level) print_record(stderr, record);
+        /* Hand the slot back to producers one lap ahead */
+        __atomic_store_n(&record->sequence, ring_tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        ring_tail++;
+        drained++;
+    }
+    if(drained > 0) {
+        __atomic_fetch_add(&stats.written, drained, __ATOMIC_RELAXED);
+        if(log_file) fflush(log_file);
+    }
+    return drained;
+}
+
+static void* log_thread_main(ALLEGRO_THREAD* thread, void* arg) {
+    while(!al_get_thread_should_stop(thread)) {
+        if(log_drain() == 0) {
+            al_rest(LOG_IDLE_SLEEP);
+        }
+    }
+    log_drain();
+    return NULL;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Start the log thread, appending to path (or only echoing if path is NULL).
+* Records at echo_level and above are also written to stderr. Until the
+* logger is started, and after it is stopped, messages are printed straight
+* to stdout instead, which is what the command line tools rely on.
+*/
+int log_start(const char* path, int level_to_echo) {
+    if(running) {
+        return OK;
+    }
+    for(uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].sequence = i;
+    }
+    ring_head  = 0;
+    ring_tail  = 0;
+    echo_level = level_to_echo;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if(path) {
+        log_file = fopen(path, "a");
+        if(!log_file) {
+            printf("(log_start): couldn't open %s.\n", path);
+        }
+    }
+    log_thread = al_create_thread(log_thread_main, NULL);
+    if(!log_thread) {
+        printf("(log_start): couldn't create log thread.\n");
+        if(log_file) fclose(log_file);
+        log_file = NULL;
+        return ERROR;
+    }
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    al_start_thread(log_thread);
+    /* Whatever is queued when something calls exit() still gets written */
+    static bool registered = false;
+    if(!registered) {
+        atexit(log_stop);
+        registered = true;
+    }
+    return OK;
+}
+
+/*
+* Stop the log thread once it has written out everything queued so far.
+*/
+void log_stop() {
+    if(!running) {
+        return;
+    }
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    al_join_thread(log_thread, NULL);
+    al_destroy_thread(log_thread);
+    log_thread = NULL;
+    if(log_file) {
+        Log_Stats s = log_stats();
+        fprintf(log_file, "log closed: %llu written, %llu dropped, %llu suppressed\n",
+                (unsigned long long)s.written, (unsigned long long)s.dropped, (unsigned long long)s.suppressed);
+        fclose(log_file);
+        log_file = NULL;
+    }
+}
+
+/*
+* Drop messages below level at run time. Levels below LOG_COMPILE_LEVEL are
+* already gone.
+*/
+void log_set_level(int level) {
+    __atomic_store_n(&runtime_level, level, __ATOMIC_RELAXED);
+}
+
+/*
+* Format a message into the ring. Never blocks or touches a file: a producer
+* only claims a slot with a compare and swap, and if the ring is full the
+* message is counted as dropped instead.
+*/
+void log_write(int level, const char* func, Log_Limiter* limiter, const char* format, ...) {
+    if(level < __atomic_load_n(&runtime_level, __ATOMIC_RELAXED) || level >= LOG_LEVEL_NONE) {
+        return;
+    }
+    double now = seconds_since_start();
+    int suppressed = 0;
+    if(limiter && !log_allow(limiter, now, &suppressed)) {
+        return;
+    }
+
+    va_list args;
+    if(!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        Log_Record direct = {.level = level, .suppressed = suppressed, .time = now, .func = func};
+        va_start(args, format);
+        vsnprintf(direct.message, LOG_MESSAGE_SIZE, format, args);
+        va_end(args);
+        print_record(stdout, &direct);
+        return;
+    }
+
+    uint32_t pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    Log_Record* record;
+    while(true) {
+        record = &ring[pos & (LOG_RING_SIZE - 1)];
+        uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(sequence - pos);
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&ring_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if(diff < 0) {
+            /* Full, the log thread is a whole lap behind */
+            __atomic_fetch_add(&stats.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        else {
+            pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    record->level      = level;
+    record->suppressed = suppressed;
+    record->time       = now;
+    record->func       = func;
+    va_start(args, format);
+    vsnprintf(record->message, LOG_MESSAGE_SIZE, format, args);
+    va_end(args);
+    __atomic_store_n(&record->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+Log_Stats log_stats() {
+    Log_Stats s = {
+        .written    = __atomic_load_n(&stats.written, __ATOMIC_RELAXED),
+        .dropped    = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED),
+        .suppressed = __atomic_load_n(&stats.suppressed, __ATOMIC_RELAXED)
+    };
+    return s;
+}
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 /* Allegro Libraries */
 #include <allegro5/allegro5.h>              /* Base Allegro library */
@@ -16,44 +17,50 @@
 #include "mob.h"
 #include "global.h"
 #include "terrain.h"
-#include "random.h"
 #include "mob_handler.h"
 #include "attack.h"
+#include "atlas.h"
+#include "asset_pack.h"
+#include "asset_loader.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "simulation.h"
+#include "latency.h"
+#include "particles.h"
+#include "log.h"
+#include "mem_track.h"
+#include "overlay.h"
+#include "render.h"
+#include "scene.h"
+
+
+#define FPS          60.0   /* Render rate when the display does not report one */
+
+/*
+* Called from the display thread once every queued asset has been decoded.
+* Uploads the atlas in one pass, releases the loaders, and sets up the cursor.
+*/
+int finish_asset_loading(ALLEGRO_DISPLAY* disp, ALLEGRO_MOUSE_CURSOR** cursor) {
+    int status = atlas_build();
+    asset_loader_stop();
+    asset_pack_close();
+    if(status != OK) {
+        return ERROR;
+    }
 
-#define KEY_SEEN     1
-#define KEY_RELEASED 2
-
-#define FPS          60.0
-
-bool show_dev_tools = false;
-int dev_tool_pos    = 16;
-
-typedef enum game_state {
-    GS_RUNNING,
-    GS_MENU
-} Game_State;
-
-void camera_update(float* cameraPosition, float x, float y, float width, float height, float x_max, float y_max) {
-    cameraPosition[0] = -(SCREEN_WIDTH / 2) + (x + width/2);
-    cameraPosition[1] = -(SCREEN_HEIGHT / 2) + (y + height/2);
+    Atlas_Load_Stats load_stats = atlas_load_stats();
+    printf("Loaded assets in %.2f ms (%s)\n", load_stats.total_ms, load_stats.from_pack ? "pack" : "images");
+    for(int s = 0; s < SPR_COUNT; s++) {
+        printf("  %-20s %.2f ms\n", atlas_sprite_name(s), load_stats.asset_ms[s]);
+    }
 
-    cameraPosition[0] = constrain_f(0, abs(x_max - SCREEN_WIDTH), cameraPosition[0]);
-    cameraPosition[1] = constrain_f(0, abs(y_max - SCREEN_HEIGHT), cameraPosition[1]);
+    ALLEGRO_BITMAP* cursor_bitmap = MEM_TRACK_BITMAP(MEM_UI, atlas_sub_bitmap(SPR_CROSSHAIR));
+    *cursor = al_create_mouse_cursor(cursor_bitmap, 0, 0);
+    mem_destroy_bitmap(cursor_bitmap);
+    al_set_mouse_cursor(disp, *cursor);
+    return OK;
 }
 
-void initialize_game_state(Mob* p_p, Floor* f_p) {
-    Mob p;
-    Room r;
-
-    generate_floor(f_p, 1, MAX_ROWS/2, MAX_COLS/2);
-
-    r = f_p->map[MAX_ROWS/2][MAX_COLS/2];
-
-    int start_player_pos_x = r.width/2 - PLAYER_WIDTH/2;
-    int start_player_pos_y = r.height/2 - PLAYER_HEIGHT/2;
-    p = initialize_mob(PLAYER, 0, start_player_pos_x, start_player_pos_y);
-    memcpy(p_p, &p, sizeof(Mob));
-}
 
 int main(int argc, char** argv) {
 //    al_set_config_value(al_get_system_config(), "trace", "level", "debug");
@@ -64,11 +71,33 @@ int main(int argc, char** argv) {
     assert(al_install_mouse());         /* Install Mouse */
     assert(al_init_primitives_addon()); /* Initialize Primatives */
     assert(al_init_image_addon());      /* Initialize Image Library */
-
-    ALLEGRO_TIMER* timer = al_create_timer(1.0 / FPS);
-    if(!timer) {
-        printf("couldn't initialize timer\n");
-        return ERROR;
+    double launch_time = al_get_time();
+    bool first_frame_presented = false;
+
+    /* --latency-log <file> exports every input to present measurement as csv */
+    const char* latency_log_path = NULL;
+    /* --log <file> picks where the game log goes */
+    const char* log_path = "wizard.log";
+    /* --load <file> starts from a save instead of the menu */
+    const char* load_path = NULL;
+    for(int i = 1; i < argc - 1; i++) {
+        if(strcmp(argv[i], "--latency-log") == 0) {
+            latency_log_path = argv[i + 1];
+        }
+        else if(strcmp(argv[i], "--log") == 0) {
+            log_path = argv[i + 1];
+        }
+        else if(strcmp(argv[i], "--load") == 0) {
+            load_path = argv[i + 1];
+        }
+    }
+    /* Warnings and errors are echoed to the console as well */
+    if(log_start(log_path, LOG_LEVEL_WARN) != OK) {
+        printf("couldn't start logger, logging synchronously\n");
+    }
+    Latency_Recorder latency;
+    if(latency_recorder_initialize(&latency, latency_log_path) != OK) {
+        printf("couldn't open latency log, keeping histograms only\n");
     }
 
     ALLEGRO_EVENT_QUEUE* queue = al_create_event_queue();
@@ -83,54 +112,79 @@ int main(int argc, char** argv) {
         return ERROR;
     }
 
+    /* Rendering is paced to the monitor, simulation runs at TICK_RATE regardless */
+    int refresh_rate = al_get_display_refresh_rate(disp);
+    ALLEGRO_TIMER* timer = al_create_timer(1.0 / (refresh_rate > 0 ? refresh_rate : FPS));
+    if(!timer) {
+        printf("couldn't initialize timer\n");
+        return ERROR;
+    }
+
     ALLEGRO_FONT* font = al_create_builtin_font();
     if(!font) {
         printf("couldn't initialize font\n");
         return ERROR;
     }
 
-    /* Set up keyboard for fluid keyboard events */
-    unsigned char key[ALLEGRO_KEY_MAX];
-    memset(key, 0, sizeof(key));
+    /*
+    * Decode every sprite and tile set on the loader pool, preferring the
+    * pre-decoded asset pack. The menu keeps running while they load, and the
+    * atlas is uploaded once they are all ready.
+    */
+    char pack_path[512];
+    if(asset_path(ASSET_PACK_FILE, pack_path, sizeof(pack_path)) != OK || asset_pack_open(pack_path) != OK) {
+        printf("no asset pack found, decoding source images\n");
+    }
+    if(asset_loader_start(0) != OK) {
+        printf("couldn't start asset loader, decoding on the main thread\n");
+    }
+    atlas_request_assets();
 
-    /* Mouse Stuff */
-    int mouseX = 0;
-    int mouseY = 0;
-    ALLEGRO_MOUSE_CURSOR* cursor  = al_create_mouse_cursor(al_load_bitmap("../assets/crosshair.png"), 0, 0);
-    al_set_mouse_cursor(disp, cursor);
+    /* Glyph atlas and vertex batch for the health bars, hitboxes and dev tools */
+    Overlay overlay;
+    if(overlay_create(&overlay, font) != OK) {
+        printf("couldn't initialize overlay\n");
+        return ERROR;
+    }
 
+    /* Draw through Allegro, counting what each frame costs for the dev tools */
+    Render_Backend allegro_backend, recording_backend;
+    render_allegro_backend(&allegro_backend);
+    render_recording_backend(&recording_backend, &allegro_backend);
+    render_set_backend(&recording_backend);
 
+    /* Mouse Stuff */
+    ALLEGRO_MOUSE_CURSOR* cursor = NULL;
+
+    /* Device input is forwarded to the simulation through its input ring */
     al_register_event_source(queue, al_get_keyboard_event_source());
     al_register_event_source(queue, al_get_mouse_event_source());
     al_register_event_source(queue, al_get_display_event_source(disp));
     al_register_event_source(queue, al_get_timer_event_source(timer));
 
-    /* Initialize random number generator */
-    rng_initialize();
-
-    /* Initialize global game state variables */
-    Mob p = default_mob();
-    Floor f;
-    Room* current_room = 0;
-    Game_State current_game_state = GS_MENU;
-
-    /* Projectile Testing */
-    Projectile bullet1 = initialize_projectile(5, 10);
-
-    Projectile bullet2 = initialize_projectile(10, 20);
-    //Projectile live_bullets[10] = {initialize_projectile(0,0)};
-
+    /* Particles are visual only, they live on the render thread */
+    Particle_System particles;
+    if(create_particle_system(&particles, PARTICLES_PER_BLEND) != OK) {
+        printf("couldn't initialize particles\n");
+        return ERROR;
+    }
 
-    /* Camera Setup */
-    float cameraPosition[2] = {0, 0};
-    ALLEGRO_TRANSFORM camera;
+    /* Start the simulation on its own thread, it publishes snapshots we render from */
+    Simulation* sim = create_simulation((uint64_t)time(NULL));
+    if(sim) {
+        sim->load_path = load_path;
+    }
+    if(!sim || simulation_start(sim) != OK) {
+        printf("couldn't start simulation\n");
+        return ERROR;
+    }
 
-    /* Game Loop */
+    /* Render Loop */
     bool done = false;
     bool redraw = true;
     ALLEGRO_EVENT event;
 
-    /* Variables to handle timer events */
+    /* Variables to handle render timing */
     double delta_time   = 0;
     double fps          = 0;
     double new_time     = 0;
@@ -138,246 +192,81 @@ int main(int argc, char** argv) {
 
     al_start_timer(timer);
 
-    while(1) {
+    while(!done) {
         al_wait_for_event(queue, &event);
-
-        if(current_game_state == GS_RUNNING) {
+        do {
             switch(event.type) {
                 case ALLEGRO_EVENT_TIMER:
-                    /* Update fps */
-                    new_time = al_get_time();
-                    delta_time = new_time - old_time;
-                    fps = 1.0 / delta_time;
-                    old_time = new_time;
-
-                    /* Update Player */
-                    p.update(key, &p, current_room->width, current_room->height);
-
-                    /* Hitbox collisions -- Needs to be updated, very temporary */
-                    for(int i = 0; i < current_room->m_handler_p->local_max_mobs; i++) {
-                        if(is_collision(&p.hb, &current_room->m_handler_p->mobs[i].hb)){
-                            p.current_health -= 10;
-                        }
-                    }
-
-                    if(p.current_state == DEAD) {
-                        // STRETCH: End Run screen with stats.
-                        // clear all keyboard inputs, change game state to menu
-                        // TODO: Free memory of everything --> dungeon, mobs, etc.
-                        current_game_state = GS_MENU;
-                        memset(key, 0, sizeof(key));
-                        destroy_floor(&f);
-                        printf("dead.\n");
-                        break;
-                    }
-
-                    /* Update Projectile */
-                    update_projectile(&bullet1);
-                    update_projectile(&bullet2);
-
-                    /* Check for bullet collisions */
-                    for(int i = 0; i < current_room->m_handler_p->local_max_mobs; i++) {
-                        if(is_collision(&bullet1.hb, &current_room->m_handler_p->mobs[i].hb)) {
-                            current_room->m_handler_p->mobs[i].current_health -= bullet1.damage;
-                            bullet1.live = false;
-                            break;
-                        }
-                        if(is_collision(&bullet2.hb, &current_room->m_handler_p->mobs[i].hb)) {
-                            current_room->m_handler_p->mobs[i].current_health -= bullet2.damage;
-                            bullet2.live = false;
-                            break;
-                        }
-                    }
-
-                    /* Update camera position and transform everything on the screen */
-                    camera_update(cameraPosition, p.position[0], p.position[1], p.width, p.height, current_room->width, current_room->height);
-                    al_identity_transform(&camera);
-                    al_translate_transform(&camera, -cameraPosition[0], -cameraPosition[1]);
-                    al_use_transform(&camera);
-
-                    /* Update all elements of the dungeon */
-                    current_room = update_dungeon_state(&f, current_room, &p);
-
-                    /* ESC key to exit game */
-                    if(key[ALLEGRO_KEY_ESCAPE]) {
-                        done = true;
-                        break;
-                    }
-
-                    /* T key to show dev tools */
-                    if(key[ALLEGRO_KEY_T]) {
-                        show_dev_tools = true;
-                    }
-
-                    /* Update all keys in array to keep movement smooth */
-                    for(int i = 0; i < ALLEGRO_KEY_MAX; i++) {
-                        key[i] &= KEY_SEEN;
-                    }
-
                     redraw = true;
                     break;
-                case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
-                    /* Fire Bullet */
-                    if(event.mouse.button == 1) {
-                        fire_projectile(&bullet1, p.position[0] + p.width/2, p.position[1] + p.height/2, mouseX, mouseY, 50);
-                    }
-                    if(event.mouse.button == 2) {
-                        fire_projectile(&bullet2, p.position[0] + p.width/2, p.position[1] + p.height/2, mouseX, mouseY, 10);
-                    }
-                    break;
-                case ALLEGRO_EVENT_MOUSE_AXES:
-                    /* Update Mouse Position */
-                    mouseX = event.mouse.x;
-                    mouseY = event.mouse.y;
-                    break;
-                case ALLEGRO_EVENT_KEY_DOWN:
-                    /* Update key array with button press */
-                    key[event.keyboard.keycode] = KEY_SEEN | KEY_RELEASED;
-
-                    /* K kill all mobs in the room */
-                    if(key[ALLEGRO_KEY_K]) {
-                        reset_handler(current_room->m_handler_p);
-                        p.current_health -= 10;
-                    }
-                    /* Turn on Hitboxes*/
-                    if(key[ALLEGRO_KEY_H]) {
-                        toggle_hitboxes();
-                    }
-                    /* Temp -- Move to next floor */
-                    if(key[ALLEGRO_KEY_E]) {
-                        if(current_room->type == R_EXIT && f.key_found) {
-                            Floor new_floor;
-                            Room new_room;
-                            generate_floor(&new_floor, f.number+1, current_room->row_pos, current_room->col_pos);
-                            /* Insert Loading Screen or spawning animation here */
-                            new_room = new_floor.map[current_room->row_pos][current_room->col_pos];
-                            load_room(&new_room);
-                            unload_room(current_room);
-                            current_room = &new_room;
-                            destroy_floor(&f);
-                            f = new_floor;
-                        }
-                        else if(current_room->type == R_KEY && !f.key_found) {
-                            f.key_found = true;
-                        }
-                    }
-                    break;
-                case ALLEGRO_EVENT_KEY_UP:
-                    /* Update key array when key is released */
-                    key[event.keyboard.keycode] &= KEY_RELEASED;
-                    break;
                 case ALLEGRO_EVENT_DISPLAY_CLOSE:
                     /* Use the 'X' button to close the game */
                     done = true;
                     break;
-            }
-        } else {
-            /* 'MENU' game state processing */
-            switch(event.type) {
-                case ALLEGRO_EVENT_TIMER:
-                     /* ESC key to exit game */
-                    if(key[ALLEGRO_KEY_ESCAPE]) {
-                        done = true;
-                        break;
-                    }
-                    /* ENTER key*/
-                    if(key[ALLEGRO_KEY_ENTER]) {
-                        current_game_state = GS_RUNNING;
-                        /* clears keyboard inputs */
-                        memset(key, 0, sizeof(key));
-                        /* Initialize Dungeon and Load Room */
-                        initialize_game_state(&p, &f);
-                        current_room = &f.map[MAX_ROWS/2][MAX_COLS/2];
-                        load_room(current_room);
-                        break;
-                    }
-                    for(int i = 0; i < ALLEGRO_KEY_MAX; i++) {
-                        key[i] &= KEY_SEEN;
-                    }
-                    redraw = true;
-                    break;
-                case ALLEGRO_EVENT_DISPLAY_CLOSE:
-                    done = true;
-                    break;
-                case ALLEGRO_EVENT_KEY_DOWN:
-                    key[event.keyboard.keycode] = KEY_SEEN | KEY_RELEASED;
-                    break;
                 default:
+                    simulation_push_input(sim, &event);
                     break;
             }
+        } while(al_get_next_event(queue, &event));
+
+        if(simulation_quit_requested(sim)) {
+            done = true;
+        }
+        /* Upload the atlas once the loader pool has decoded everything */
+        if(!atlas_is_initialized() && atlas_assets_ready()) {
+            if(finish_asset_loading(disp, &cursor) != OK) {
+                printf("couldn't initialize texture atlas\n");
+                done = true;
+            }
+            simulation_set_assets_ready(sim);
         }
 
         if(done) break;
-        if(redraw && al_is_event_queue_empty(queue)) {
-            al_clear_to_color(al_map_rgb(0, 0, 0));
-            if(current_game_state == GS_RUNNING) {
-                draw_room(current_room, f.texture_p, delta_time);
-                p.draw(&p, delta_time);
-                draw_projectile(&bullet1);
-                draw_projectile(&bullet2);
-                al_draw_textf(font, al_map_rgb(0, 0, 0), 0, dev_tool_pos * 0, 0, "key found: %d", f.key_found);
-                if(show_dev_tools) {
-                    al_draw_textf(font, al_map_rgb(0, 0, 0), 0, dev_tool_pos * 1, 0, "Player position. x: %d, y: %d", p.position[0], p.position[1]);
-                    al_draw_textf(font, al_map_rgb(0, 0, 0), 0, dev_tool_pos * 2, 0, "Current Room: %d - %s", f.number, current_room->id);
-                    al_draw_textf(font, al_map_rgb(0, 0, 0), 0, dev_tool_pos * 3, 0, "FPS: %f", fps);
-                    al_draw_textf(font, al_map_rgb(0, 0, 0), 0, dev_tool_pos * 4, 0, "Mouse Position: %d, %d", mouseX, mouseY);
-                }
-                /* Draw Minimap */
-                float box_len = 10;
-                float scl = 1.1;
-                float startx = SCREEN_WIDTH - ((scl * box_len) * MAX_ROWS);
-                float starty = 0;
-                ALLEGRO_COLOR c;
-                for(int i = 0; i < MAX_ROWS; i++) {
-                    for(int j = 0; j < MAX_COLS; j++) {
-                        if(f.map[i][j].is_initialized) {
-                            if(f.map[i][j].is_loaded) {
-                                c = al_map_rgb(240, 201, 31);
-                            } else {
-                                switch(f.map[i][j].type) {
-                                    case R_CHALLENGE:
-                                        c = al_map_rgb(128, 10, 100);
-                                        break;
-                                    case R_EXIT:
-                                        c = al_map_rgb(255, 50, 50);
-                                        break;
-                                    case R_KEY:
-                                        c = al_map_rgb(50, 255, 50);
-                                        break;
-                                    case R_SHOP:
-                                        c = al_map_rgb(25, 2, 104);
-                                        break;
-                                    default:
-                                        c = al_map_rgb(128, 128, 128);
-                                        break;
-                                }
-                            }
-                            int x1 = startx + (j * scl * box_len);
-                            int y1 = starty + (i * scl * box_len);
-                            al_draw_filled_rectangle( x1,
-                                                      y1,
-                                                      x1 + box_len,
-                                                      y1 + box_len,
-                                                      c);
-                        }
-                    }
-                }
-            }
-            else if(current_game_state == GS_MENU) {
-                al_draw_textf(font, al_map_rgb(255, 255, 255), SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2, 0, "Press [ENTER] to Begin");
+        if(redraw) {
+            /* Update fps */
+            new_time = al_get_time();
+            delta_time = new_time - old_time;
+            fps = 1.0 / delta_time;
+            old_time = new_time;
+
+            /* Take the newest snapshot, blending between its last two ticks */
+            triple_buffer_consume(&sim->snapshots);
+            Snapshot* snap = triple_buffer_front(&sim->snapshots);
+            double alpha = (snap->tick_dt > 0) ? constrain_f(0, 1, (new_time - snap->publish_time) / snap->tick_dt) : 1;
+
+            /* Spawn effects the simulation recorded since the last frame, then age every particle */
+            particles_consume_effects(&particles, snap->effects);
+            double particle_start = al_get_time();
+            particles_update(&particles, constrain_f(0, 0.1, delta_time));
+            double particle_ms = (al_get_time() - particle_start) * 1000.0;
+
+            render_begin_frame(al_map_rgb(0, 0, 0));
+            draw_snapshot(snap, alpha, font, &overlay, fps, &latency, &particles, particle_ms);
+            render_end_frame();
+            latency_record_presented(&latency, snap->latency, al_get_time());
+            if(!first_frame_presented && atlas_is_initialized()) {
+                first_frame_presented = true;
+                printf("Cold start to first frame: %.2f ms\n", (al_get_time() - launch_time) * 1000.0);
             }
-
-            al_flip_display();
             redraw = false;
         }
     }
 
-    unload_room(current_room);
-    al_destroy_bitmap(p.sprite);
+    destroy_simulation(sim);
+    latency_print_report(&latency);
+    latency_recorder_close(&latency);
+    destroy_particle_system(&particles);
+    overlay_destroy(&overlay);
+    if(cursor) al_destroy_mouse_cursor(cursor);
+    asset_loader_stop();
+    asset_pack_close();
+    atlas_destroy();
     al_destroy_font(font);
     al_destroy_display(disp);
     al_destroy_timer(timer);
     al_destroy_event_queue(queue);
+    mem_report_leaks(stdout);
+    log_stop();
 
     return OK;
 }
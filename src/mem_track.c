@@ -0,0 +1,219 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "mem_track.h"
+#include "global.h"
+#include "log.h"
+
+#define MEM_MAGIC 0x4d454d54u   /* "MEMT", marks a block that came from mem_alloc */
+
+/*
+* Every tracked block is prefixed with one of these, linking it into the list
+* of live allocations for the leak report. The union keeps the user pointer
+* aligned for any type.
+*/
+typedef union mem_header {
+    struct {
+        union mem_header* prev;
+        union mem_header* next;
+        size_t size;
+        const char* file;
+        int line;
+        Mem_Tag tag;
+        uint32_t magic;
+    } info;
+    long double align_float;
+    void* align_pointer;
+} Mem_Header;
+
+typedef struct mem_bitmap {
+    ALLEGRO_BITMAP* bmp;
+    Mem_Tag tag;
+    int64_t bytes;
+    const char* file;
+    int line;
+} Mem_Bitmap;
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+static Mem_Header* live_list = NULL;
+static Mem_Bitmap bitmaps[MEM_MAX_BITMAPS];
+static Mem_Tag_Stats tag_stats[MEM_TAG_COUNT];
+/* Allocations come from the simulation, render and loader threads alike */
+static bool lock_flag = false;
+
+static const char* tag_names[MEM_TAG_COUNT] = {
+    "terrain", "mobs", "attack", "spells", "particles", "sim", "assets", "ui"
+};
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static void mem_lock() {
+    while(__atomic_test_and_set(&lock_flag, __ATOMIC_ACQUIRE)) {
+        /* Critical sections are a few pointer writes, just spin */
+    }
+}
+
+static void mem_unlock() {
+    __atomic_clear(&lock_flag, __ATOMIC_RELEASE);
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* malloc, charged to tag. Use the MEM_ALLOC macro so the report knows where
+* the block came from.
+*/
+void* mem_alloc(Mem_Tag tag, size_t size, const char* file, int line) {
+    Mem_Header* h = malloc(sizeof(Mem_Header) + size);
+    if(!h) {
+        return NULL;
+    }
+    h->info.size  = size;
+    h->info.file  = file;
+    h->info.line  = line;
+    h->info.tag   = tag;
+    h->info.magic = MEM_MAGIC;
+    h->info.prev  = NULL;
+
+    mem_lock();
+    h->info.next = live_list;
+    if(live_list) live_list->info.prev = h;
+    live_list = h;
+    Mem_Tag_Stats* s = &tag_stats[tag];
+    s->live_bytes += size;
+    s->live_allocations++;
+    s->total_allocations++;
+    if(s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+    mem_unlock();
+    return h + 1;
+}
+
+void* mem_calloc(Mem_Tag tag, size_t count, size_t size, const char* file, int line) {
+    if(size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = mem_alloc(tag, count * size, file, line);
+    if(ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+/*
+* Free a block from mem_alloc or mem_calloc. Anything else is reported and
+* left alone rather than corrupting the heap.
+*/
+void mem_free(void* ptr) {
+    if(!ptr) {
+        return;
+    }
+    Mem_Header* h = (Mem_Header*)ptr - 1;
+    if(h->info.magic != MEM_MAGIC) {
+        LOG_ERROR("%p was not allocated by mem_alloc.", ptr);
+        return;
+    }
+    mem_lock();
+    if(h->info.prev) h->info.prev->info.next = h->info.next;
+    else             live_list = h->info.next;
+    if(h->info.next) h->info.next->info.prev = h->info.prev;
+    tag_stats[h->info.tag].live_bytes -= h->info.size;
+    tag_stats[h->info.tag].live_allocations--;
+    mem_unlock();
+    h->info.magic = 0;
+    free(h);
+}
+
+/*
+* Charge a freshly created bitmap to tag, returning it so creation calls can be
+* wrapped in place. Tracked bitmaps must be destroyed with mem_destroy_bitmap.
+*/
+ALLEGRO_BITMAP* mem_track_bitmap(Mem_Tag tag, ALLEGRO_BITMAP* bmp, const char* file, int line) {
+    if(!bmp) {
+        return NULL;
+    }
+    int64_t bytes = al_is_sub_bitmap(bmp)? 0 : (int64_t)al_get_bitmap_width(bmp) * al_get_bitmap_height(bmp) * 4;
+    mem_lock();
+    for(int i = 0; i < MEM_MAX_BITMAPS; i++) {
+        if(!bitmaps[i].bmp) {
+            bitmaps[i] = (Mem_Bitmap){bmp, tag, bytes, file, line};
+            tag_stats[tag].bitmap_bytes += bytes;
+            tag_stats[tag].bitmaps++;
+            mem_unlock();
+            return bmp;
+        }
+    }
+    mem_unlock();
+    LOG_WARN("bitmap table full, %s:%d is untracked.", file, line);
+    return bmp;
+}
+
+void mem_destroy_bitmap(ALLEGRO_BITMAP* bmp) {
+    if(!bmp) {
+        return;
+    }
+    mem_lock();
+    for(int i = 0; i < MEM_MAX_BITMAPS; i++) {
+        if(bitmaps[i].bmp == bmp) {
+            tag_stats[bitmaps[i].tag].bitmap_bytes -= bitmaps[i].bytes;
+            tag_stats[bitmaps[i].tag].bitmaps--;
+            bitmaps[i].bmp = NULL;
+            break;
+        }
+    }
+    mem_unlock();
+    al_destroy_bitmap(bmp);
+}
+
+Mem_Tag_Stats mem_tag_stats(Mem_Tag tag) {
+    mem_lock();
+    Mem_Tag_Stats s = tag_stats[tag];
+    mem_unlock();
+    return s;
+}
+
+const char* mem_tag_name(Mem_Tag tag) {
+    return (tag >= 0 && tag < MEM_TAG_COUNT)? tag_names[tag] : "unknown";
+}
+
+/*
+* Print every allocation and bitmap that is still live, with where it was
+* made, followed by per tag totals. Returns how many were outstanding.
+*/
+int mem_report_leaks(FILE* out) {
+    int outstanding = 0;
+    mem_lock();
+    for(Mem_Header* h = live_list; h; h = h->info.next) {
+        fprintf(out, "  leak: %8zu bytes  %-10s %s:%d\n", h->info.size, tag_names[h->info.tag], h->info.file, h->info.line);
+        outstanding++;
+    }
+    for(int i = 0; i < MEM_MAX_BITMAPS; i++) {
+        if(bitmaps[i].bmp) {
+            fprintf(out, "  leak: %8lld bytes  %-10s %s:%d (bitmap)\n", (long long)bitmaps[i].bytes, tag_names[bitmaps[i].tag], bitmaps[i].file, bitmaps[i].line);
+            outstanding++;
+        }
+    }
+    fprintf(out, "Memory at exit: %d outstanding\n", outstanding);
+    for(int t = 0; t < MEM_TAG_COUNT; t++) {
+        Mem_Tag_Stats* s = &tag_stats[t];
+        fprintf(out, "  %-10s live %lld B in %lld blocks, peak %lld B, %lld allocations, %d bitmaps (%lld B)\n",
+                tag_names[t], (long long)s->live_bytes, (long long)s->live_allocations, (long long)s->peak_bytes,
+                (long long)s->total_allocations, s->bitmaps, (long long)s->bitmap_bytes);
+    }
+    mem_unlock();
+    return outstanding;
+}
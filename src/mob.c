@@ -9,14 +9,16 @@
 
 /* Local Includes */
 #include "mob.h"
-#include "random.h"
 #include "global.h"
+#include "scheduler.h"
+#include "log.h"
 
 #define PLAYER_ANIMATION_FPS 24
 
 Mob default_mob() {
     Mob mob = {
         .position               = {-1},
+        .prev_position          = {-1},
         .id                     = -1,
         .width                  = -1,
         .height                 = -1,
@@ -31,28 +33,30 @@ Mob default_mob() {
         .current_state          = IDLE,
         .last_animation_frame   = -1,
         .animation_tracker      = -1,
-        .sprite                 = NULL
+        .sprite                 = SPR_NONE
     };
     return mob;
 }
 
-void update_player(unsigned char key[], Mob* p, int max_px, int max_py) {
+void update_player(Input_State* input, Mob* p, int max_px, int max_py) {
+    p->prev_position[0] = p->position[0];
+    p->prev_position[1] = p->position[1];
     if(p->current_health <= 0) {
         p->current_state = DEAD;
     }
     else {
-        /* Update speed based on Button press */
-        if(key[ALLEGRO_KEY_W]) {
+        /* Update speed based on the held movement actions */
+        if(input_down(input, ACT_MOVE_UP)) {
             p->vel_y = -p->speed;
         }
-        if(key[ALLEGRO_KEY_S]) {
+        if(input_down(input, ACT_MOVE_DOWN)) {
             p->vel_y = p->speed;
         }
-        if(key[ALLEGRO_KEY_A]) {
+        if(input_down(input, ACT_MOVE_LEFT)) {
             p->vel_x = -p->speed;
             p->dir = 0;
         }
-        if(key[ALLEGRO_KEY_D]) {
+        if(input_down(input, ACT_MOVE_RIGHT)) {
             p->vel_x = p->speed;
             p->dir = 1;
         }
@@ -73,9 +77,12 @@ void update_player(unsigned char key[], Mob* p, int max_px, int max_py) {
         p->vel_x = 0;
         p->vel_y = 0;
     }
+    animate_mob(p, 1.0 / TICK_RATE);
 }
 
-void update_slime(unsigned char key[], Mob* slime, int max_px, int max_py) {
+void update_slime(Input_State* input, Mob* slime, int max_px, int max_py) {
+    slime->prev_position[0] = slime->position[0];
+    slime->prev_position[1] = slime->position[1];
     if (slime->current_health <= 0) {
         slime->current_state = DEAD;
     }
@@ -88,14 +95,29 @@ void update_slime(unsigned char key[], Mob* slime, int max_px, int max_py) {
         slime->position[0] = constrain(0, max_px - slime->width, (slime->position[0] + slime->vel_x));
     }
     update_hitbox_position(&slime->hb, slime->position[0], slime->position[1]);
+    animate_mob(slime, 1.0 / TICK_RATE);
 }
 
-void draw_mob(Mob* m, double delta_time) {
-    /* Draw player */
-    int sourceX = 0;
-    int sourceY = 0;
+/*
+*  Advance the sprite animation. Runs on the simulation tick so the drawn frame
+*  is part of the mob's state and can be copied into render snapshots.
+*/
+void animate_mob(Mob* m, double delta_time) {
     float animation_update_time = (1.0 / m->speed);
     m->animation_tracker += delta_time;
+    if(m->animation_tracker >= animation_update_time) {
+        m->last_animation_frame += m->width;
+        m->last_animation_frame = (m->last_animation_frame >= m->width*4) ? 0 : m->last_animation_frame;
+        m->animation_tracker = 0.0;
+    }
+}
+
+void draw_mob(Mob* m, double alpha) {
+    /* Draw player */
+    float pos[2];
+    interpolate_mob_position(m, alpha, pos);
+    int sourceX = m->last_animation_frame;
+    int sourceY = 0;
     switch(m->current_state) {
         case IDLE:
             sourceY = 0;
@@ -108,39 +130,57 @@ void draw_mob(Mob* m, double delta_time) {
             sourceY = 0;
             break;
     }
-    if(m->animation_tracker >= animation_update_time) {
-        sourceX = (m->last_animation_frame + m->width);
-        sourceX = (sourceX >= m->width*4) ? 0 : sourceX;
-        m->animation_tracker = 0.0;
-    } else {
-        sourceX = m->last_animation_frame;
-    }
     int flip_flag = m->dir == 0 ? 0 : ALLEGRO_FLIP_HORIZONTAL;
-    al_draw_bitmap_region(m->sprite, sourceX, sourceY, m->width, m->height, m->position[0], m->position[1], flip_flag);
-    /*
-    *  Im gonna try to implement a health bar because im too lazy to import a
-    *  font. This actually works pretty well.
-    *  TODO: make this a "health bar" function or something, maybe I can
-    *  generalize it to represent other values as well?
-    */
+    int frame = (sourceY / m->height) * atlas_frame_columns(m->sprite) + (sourceX / m->width);
+    atlas_draw_frame(m->sprite, frame, pos[0], pos[1], flip_flag);
+}
+
+/*
+*  Health bar and hitbox, batched into the overlay drawn after the world. The
+*  bar is green with the missing health in red from the left.
+*/
+void draw_mob_overlay(Overlay* ov, Mob* m, double alpha, bool hitboxes) {
+    float pos[2];
+    interpolate_mob_position(m, alpha, pos);
     if(m->current_health != m->max_health) {
-        al_draw_rectangle(m->position[0], m->position[1] - 10, m->position[0] + m->width, m->position[1] - 5, al_map_rgb(0, 100, 0), 5);
-        al_draw_rectangle(m->position[0], m->position[1] - 10, m->position[0] + (m->width - (m->width * constrain_f(0, 1, m->current_health/m->max_health))), m->position[1] - 5, al_map_rgb(100, 0, 0), 5);
+        float missing = m->width * (1 - constrain_f(0, 1, m->current_health/m->max_health));
+        overlay_rect(ov, pos[0] - 2.5f, pos[1] - 12.5f, pos[0] + m->width + 2.5f, pos[1] - 2.5f, al_map_rgb(0, 100, 0));
+        overlay_rect(ov, pos[0] - 2.5f, pos[1] - 12.5f, pos[0] + missing + 2.5f, pos[1] - 2.5f, al_map_rgb(100, 0, 0));
     }
-    m->last_animation_frame = sourceX;
-    if(show_hitboxes) {
-        draw_hitbox(&m->hb, al_map_rgb(255, 0, 0));
+    if(hitboxes) {
+        draw_hitbox(ov, &m->hb, al_map_rgb(255, 0, 0));
     }
 }
 
-void draw_static_mob(Mob* m, double delta_time) {
-    al_draw_bitmap(m->sprite, m->position[0], m->position[1], 0);
+void draw_static_mob(Mob* m, double alpha) {
+    float pos[2];
+    interpolate_mob_position(m, alpha, pos);
+    atlas_draw_frame(m->sprite, 0, pos[0], pos[1], 0);
+}
+
+/*
+*  Point update and draw at the functions for the mob's type. Function
+*  pointers don't survive a save file, so loaded mobs are re-bound here too.
+*/
+void bind_mob_functions(Mob* m) {
+    switch(m->type) {
+        case PLAYER:
+            m->update = update_player;
+            m->draw   = draw_mob;
+            break;
+        default:
+            m->update = update_slime;
+            m->draw   = draw_mob;
+            break;
+    }
 }
 
 Mob initialize_mob(MOB_TYPE type, int id, int start_x, int start_y) {
     Mob m;
     m.position[0]          = start_x;
     m.position[1]          = start_y;
+    m.prev_position[0]     = start_x;
+    m.prev_position[1]     = start_y;
     m.id                   = id;
     m.vel_x                = 0;
     m.vel_y                = 0;
@@ -156,42 +196,51 @@ Mob initialize_mob(MOB_TYPE type, int id, int start_x, int start_y) {
             m.height = PLAYER_HEIGHT;
             m.speed  = PLAYER_SPEED;
             m.max_health = 100;
-            m.sprite = al_load_bitmap("../assets/wizard.png");
-            m.update = update_player;
-            m.draw   = draw_mob;
+            m.sprite = SPR_WIZARD;
             break;
         case SLIME:
             m.width  = 32;
             m.height = 32;
-            m.speed  = rng_random_int(6, 10);
+            m.speed  = SLIME_SPEED;
             m.max_health = 30;
-            m.sprite = al_load_bitmap("../assets/slime.png");
-            m.update = update_slime;
-            m.draw   = draw_mob;
+            m.sprite = SPR_SLIME;
             break;
         default:
             m.width  = 0;
             m.height = 0;
             m.speed  = 0;
             m.max_health = 0;
-            m.sprite = NULL;
-            m.update = update_slime;
-            m.draw   = draw_mob;
+            m.sprite = SPR_NONE;
             break;
     }
     m.current_health = m.max_health;
+    bind_mob_functions(&m);
 
-    if(!m.sprite && type != DEFAULT) {
-        printf("Error loading sprite!\n");
+    if(!atlas_is_initialized() && type != DEFAULT) {
+        LOG_ERROR("sprites aren't loaded for mob type %d.", type);
     }
     create_hitbox(&m.hb, m.position[0], m.position[1], m.width, m.height);
     return m;
 }
 
+/*
+*  Teleport a mob. The previous position is reset as well so the move is not
+*  interpolated across the screen.
+*/
 void move_mob(Mob* mob, int new_xpos, int new_ypos) {
     mob->position[0] = new_xpos;
     mob->position[1] = new_ypos;
+    mob->prev_position[0] = new_xpos;
+    mob->prev_position[1] = new_ypos;
     update_hitbox_position(&mob->hb,  mob->position[0],  mob->position[1]);
 }
 
+/*
+*  Render position, blended between the last two simulated ticks.
+*/
+void interpolate_mob_position(Mob* mob, double alpha, float out[2]) {
+    out[0] = mob->prev_position[0] + (mob->position[0] - mob->prev_position[0]) * alpha;
+    out[1] = mob->prev_position[1] + (mob->position[1] - mob->prev_position[1]) * alpha;
+}
+
 
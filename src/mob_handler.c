@@ -95,28 +95,29 @@ void update_all_active_mobs(Mob_Handler* handler, int max_px, int max_py) {
 /*
 *  Draw all active mobs in the mob array.
 */
-void draw_all_active_mobs(Mob_Handler* handler, double delta_time) {
+void draw_all_active_mobs(Mob_Handler* handler, double alpha) {
     for(int index = 0; index < handler->local_max_mobs; index++) {
         if(handler->mobs[index].type != DEFAULT) {
-            handler->mobs[index].draw(&handler->mobs[index], delta_time);
+            handler->mobs[index].draw(&handler->mobs[index], alpha);
         }
     }
 }
 
-void spawn_mobs(Mob_Handler* handler, int max_px, int max_py, int floor_number) {
+void spawn_mobs(Mob_Handler* handler, Rng* rng, int max_px, int max_py, int floor_number) {
     /*
     * TODO: Create some sort of smart algorithm based on the floor number, and
     * (when eventually implemented) a difficulty scalar using a point system to
     * create a very "dynamic" variety of mobs on a per-floor basis. For now tho,
     * Dumb and Quick!
     */
-    int num_mobs = rng_random_int(1, 2*floor_number);
+    int num_mobs = rng_random_int(rng, 1, 2*floor_number);
     int xpos, ypos;
     int offset = 32;
     for(int i = 0; i < num_mobs; i++) {
-        xpos = rng_random_int(offset, (max_px - offset));
-        ypos = rng_random_int(offset, (max_py - offset));
+        xpos = rng_random_int(rng, offset, (max_px - offset));
+        ypos = rng_random_int(rng, offset, (max_py - offset));
         Mob temp = initialize_mob(SLIME, i+1, xpos, ypos);
+        temp.speed = rng_random_int(rng, 6, 10);
         add_mob(handler, temp);
     }
 }
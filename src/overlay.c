@@ -0,0 +1,197 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_font.h>          /* Allegro Font library */
+#include <allegro5/allegro_primitives.h>    /* Allegro Primatives library */
+
+/* Local Includes */
+#include "overlay.h"
+#include "global.h"
+#include "log.h"
+#include "mem_track.h"
+#include "render.h"
+
+#define ATLAS_COLUMNS 16
+#define CELL_PADDING  2     /* px between cells, so filtering never bleeds */
+#define SOLID_GLYPH   (OVERLAY_GLYPHS - 1)
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static void cell_origin(Overlay* ov, int glyph, float* u, float* v) {
+    *u = CELL_PADDING + (glyph % ATLAS_COLUMNS) * (ov->cell_width + CELL_PADDING);
+    *v = CELL_PADDING + (glyph / ATLAS_COLUMNS) * (ov->cell_height + CELL_PADDING);
+}
+
+/*
+* Draw every printable glyph of font into its own cell, and fill the last
+* cell white for solid quads.
+*/
+static int build_atlas(Overlay* ov, ALLEGRO_FONT* font) {
+    ov->cell_height = al_get_font_line_height(font);
+    ov->cell_width = 1;
+    for(int g = 0; g < SOLID_GLYPH; g++) {
+        ov->glyph_advance[g] = al_get_glyph_advance(font, ' ' + g, ALLEGRO_NO_KERNING);
+        if(ov->glyph_advance[g] > ov->cell_width) ov->cell_width = ov->glyph_advance[g];
+    }
+    int rows = (OVERLAY_GLYPHS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    ov->atlas = MEM_TRACK_BITMAP(MEM_UI, al_create_bitmap(CELL_PADDING + ATLAS_COLUMNS * (ov->cell_width + CELL_PADDING),
+                                                          CELL_PADDING + rows * (ov->cell_height + CELL_PADDING)));
+    if(!ov->atlas) {
+        return ERROR;
+    }
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    al_set_target_bitmap(ov->atlas);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    for(int g = 0; g < SOLID_GLYPH; g++) {
+        float u, v;
+        cell_origin(ov, g, &u, &v);
+        al_draw_glyph(font, al_map_rgb(255, 255, 255), u, v, ' ' + g);
+    }
+    float u, v;
+    cell_origin(ov, SOLID_GLYPH, &u, &v);
+    al_draw_filled_rectangle(u, v, u + ov->cell_width, v + ov->cell_height, al_map_rgb(255, 255, 255));
+    al_set_target_bitmap(target);
+    return OK;
+}
+
+static void push_quad(Overlay* ov, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, ALLEGRO_COLOR c) {
+    if(ov->quad_count >= OVERLAY_MAX_QUADS) {
+        ov->stats.dropped++;
+        return;
+    }
+    ALLEGRO_VERTEX* q = &ov->vertices[ov->quad_count++ * 4];
+    q[0] = (ALLEGRO_VERTEX){x0, y0, 0, u0, v0, c};
+    q[1] = (ALLEGRO_VERTEX){x1, y0, 0, u1, v0, c};
+    q[2] = (ALLEGRO_VERTEX){x1, y1, 0, u1, v1, c};
+    q[3] = (ALLEGRO_VERTEX){x0, y1, 0, u0, v1, c};
+}
+
+static bool same_key(const Overlay_Text* t, const double* key, int key_count) {
+    return t->valid && t->key_count == key_count && memcmp(t->key, key, sizeof(double) * key_count) == 0;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* The atlas is a video bitmap with a display, a memory bitmap without one.
+*/
+int overlay_create(Overlay* ov, ALLEGRO_FONT* font) {
+    memset(ov, 0, sizeof(Overlay));
+    ov->vertices = MEM_ALLOC(MEM_UI, sizeof(ALLEGRO_VERTEX) * 4 * OVERLAY_MAX_QUADS);
+    ov->indices  = MEM_ALLOC(MEM_UI, sizeof(int) * 6 * OVERLAY_MAX_QUADS);
+    if(!ov->vertices || !ov->indices || build_atlas(ov, font) != OK) {
+        overlay_destroy(ov);
+        return ERROR;
+    }
+    for(int q = 0; q < OVERLAY_MAX_QUADS; q++) {
+        int* i = &ov->indices[q * 6];
+        i[0] = q * 4;     i[1] = q * 4 + 1; i[2] = q * 4 + 2;
+        i[3] = q * 4;     i[4] = q * 4 + 2; i[5] = q * 4 + 3;
+    }
+    return OK;
+}
+
+void overlay_destroy(Overlay* ov) {
+    if(ov->atlas) mem_destroy_bitmap(ov->atlas);
+    mem_free(ov->vertices);
+    mem_free(ov->indices);
+    ov->atlas    = NULL;
+    ov->vertices = NULL;
+    ov->indices  = NULL;
+}
+
+/*
+* Start a frame's batch. Cached text survives, only the quads are dropped.
+*/
+void overlay_begin(Overlay* ov) {
+    ov->quad_count = 0;
+    memset(&ov->stats, 0, sizeof(Overlay_Stats));
+}
+
+void overlay_rect(Overlay* ov, float x0, float y0, float x1, float y1, ALLEGRO_COLOR color) {
+    float u, v;
+    cell_origin(ov, SOLID_GLYPH, &u, &v);
+    u += ov->cell_width / 2.0f;
+    v += ov->cell_height / 2.0f;
+    push_quad(ov, x0, y0, x1, y1, u, v, u, v, color);
+}
+
+/*
+* Four quads straddling the edges, like al_draw_rectangle.
+*/
+void overlay_outline(Overlay* ov, float x0, float y0, float x1, float y1, float thickness, ALLEGRO_COLOR color) {
+    float h = thickness / 2;
+    overlay_rect(ov, x0 - h, y0 - h, x1 + h, y0 + h, color);
+    overlay_rect(ov, x0 - h, y1 - h, x1 + h, y1 + h, color);
+    overlay_rect(ov, x0 - h, y0 + h, x0 + h, y1 - h, color);
+    overlay_rect(ov, x1 - h, y0 + h, x1 + h, y1 - h, color);
+}
+
+/*
+* One pixel outline of a hitbox, for the debug view.
+*/
+void draw_hitbox(Overlay* ov, Hitbox* hb, ALLEGRO_COLOR color) {
+    overlay_outline(ov, hb->x, hb->y, hb->x + hb->width, hb->y + hb->height, 1, color);
+}
+
+void overlay_text(Overlay* ov, float x, float y, ALLEGRO_COLOR color, const char* text, int length) {
+    for(int c = 0; c < length; c++) {
+        int g = (unsigned char)text[c] - ' ';
+        if(g < 0 || g >= SOLID_GLYPH) g = '?' - ' ';
+        if(text[c] != ' ') {
+            float u, v;
+            cell_origin(ov, g, &u, &v);
+            push_quad(ov, x, y, x + ov->cell_width, y + ov->cell_height, u, v, u + ov->cell_width, v + ov->cell_height, color);
+        }
+        x += ov->glyph_advance[g];
+    }
+    ov->stats.texts++;
+}
+
+/*
+* Draw the line cached in slot, formatting it again first only if key, the
+* inputs it shows, differ from last time. Keys are best rounded to the
+* precision the format prints.
+*/
+int overlay_textf(Overlay* ov, int slot, float x, float y, ALLEGRO_COLOR color, const double* key, int key_count, const char* format, ...) {
+    if(slot < 0 || slot >= OVERLAY_TEXT_SLOTS || key_count > OVERLAY_KEY_MAX) {
+        LOG_ERROR("bad overlay text slot %d (%d keys).", slot, key_count);
+        return ERROR;
+    }
+    Overlay_Text* t = &ov->texts[slot];
+    if(!same_key(t, key, key_count)) {
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(t->text, sizeof(t->text), format, args);
+        va_end(args);
+        t->length    = constrain(0, OVERLAY_TEXT_MAX - 1, length);
+        t->key_count = key_count;
+        memcpy(t->key, key, sizeof(double) * key_count);
+        t->valid     = true;
+        ov->stats.formatted++;
+    }
+    overlay_text(ov, x, y, color, t->text, t->length);
+    return OK;
+}
+
+/*
+* Draw the frame's batch in one call, in the current transform.
+*/
+void overlay_flush(Overlay* ov) {
+    if(ov->quad_count > 0) {
+        render_draw_prim(ov->vertices, ov->indices, ov->quad_count * 6, ov->atlas, ALLEGRO_PRIM_TRIANGLE_LIST);
+    }
+    ov->stats.quads = ov->quad_count;
+    ov->last_stats  = ov->stats;
+    ov->quad_count  = 0;
+}
@@ -0,0 +1,59 @@
+/*
+* Particle engine benchmark. Keeps the pools topped up with slime death and
+* spell hit bursts and times the update and vertex building per frame, the
+* CPU side of drawing the particles.
+*
+* usage: particle_bench [particles] [frames]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Local Includes */
+#include "particles.h"
+#include "global.h"
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    int target = (argc > 1)? atoi(argv[1]) : 100000;
+    int frames = (argc > 2)? atoi(argv[2]) : 600;
+    float dt = 1.0f / 60.0f;
+
+    static Particle_System ps;
+    if(create_particle_system(&ps, target) != OK) {
+        return ERROR;
+    }
+
+    double update_time = 0;
+    double build_time = 0;
+    long long particle_frames = 0;
+    for(int f = 0; f < frames; f++) {
+        int burst = 0;
+        while(particles_live(&ps) < target && burst++ < 10000) {
+            particles_emit(&ps, (burst % 2)? FX_SLIME_DEATH : FX_SPELL_HIT, 640, 480, 1, 0);
+        }
+        particle_frames += particles_live(&ps);
+
+        double start = now_seconds();
+        particles_update(&ps, dt);
+        double mid = now_seconds();
+        for(int b = 0; b < BLEND_COUNT; b++) {
+            particles_build_vertices(&ps, b);
+        }
+        update_time += mid - start;
+        build_time  += now_seconds() - mid;
+    }
+
+    printf("%d frames, %.0f particles per frame on average\n", frames, (double)particle_frames / frames);
+    printf("  update:   %.3f ms per frame (%.2f ns per particle)\n", update_time * 1e3 / frames, update_time * 1e9 / particle_frames);
+    printf("  vertices: %.3f ms per frame (%.2f ns per particle)\n", build_time * 1e3 / frames, build_time * 1e9 / particle_frames);
+    printf("  budget:   %.1f%% of a 60 FPS frame\n", (update_time + build_time) / frames * 60.0 * 100.0);
+    destroy_particle_system(&ps);
+    return OK;
+}
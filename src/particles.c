@@ -0,0 +1,289 @@
+/*
+* The update kernels below are written to be auto-vectorized, which gcc only
+* does from -O3 (or -O2 on newer releases). The game builds without
+* optimization, so ask for it in this file only.
+*/
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("O3")
+#endif
+
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_primitives.h>    /* Allegro Primatives library */
+
+/* Local Includes */
+#include "particles.h"
+#include "global.h"
+#include "mem_track.h"
+#include "render.h"
+
+#define PARTICLE_FIELDS 12
+#define TWO_PI          6.283185307f
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+typedef struct effect_preset {
+    Particle_Blend blend;
+    int count;
+    float spread;               /* radians around the event direction */
+    float speed_min, speed_max; /* pixels per second */
+    float life_min, life_max;   /* seconds */
+    float size_min, size_max;
+    float gravity, drag;
+    float r, g, b;
+} Effect_Preset;
+
+static const Effect_Preset presets[FX_KIND_COUNT] = {
+    [FX_CAST]        = {BLEND_ADDITIVE,  16, 0.6f,    30, 120, 0.15f, 0.35f, 2, 3,   0, 4.0f, 0.6f, 0.7f, 1.0f},
+    [FX_SPELL_HIT]   = {BLEND_ADDITIVE,  48, TWO_PI,  60, 240, 0.25f, 0.60f, 2, 4,   0, 3.0f, 1.0f, 0.6f, 0.2f},
+    [FX_WALL_HIT]    = {BLEND_ALPHA,     24, TWO_PI,  40, 160, 0.30f, 0.70f, 2, 3, 300, 2.0f, 0.5f, 0.45f, 0.4f},
+    [FX_SLIME_DEATH] = {BLEND_ALPHA,    160, TWO_PI,  80, 320, 0.50f, 1.20f, 2, 5, 500, 1.5f, 0.3f, 0.9f, 0.3f}
+};
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/* xorshift32, the render thread must not touch the simulation's rng state */
+static float random_float(Particle_System* ps, float min, float max) {
+    uint32_t x = ps->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ps->rng = x;
+    return min + (max - min) * (x >> 8) * (1.0f / 16777216.0f);
+}
+
+static int create_pool(Particle_Pool* pool, int capacity) {
+    memset(pool, 0, sizeof(Particle_Pool));
+    float* block = MEM_ALLOC(MEM_PARTICLES, sizeof(float) * PARTICLE_FIELDS * capacity);
+    if(!block) {
+        return ERROR;
+    }
+    float** fields[PARTICLE_FIELDS] = {
+        &pool->x, &pool->y, &pool->vx, &pool->vy, &pool->life, &pool->inv_life,
+        &pool->size, &pool->gravity, &pool->drag, &pool->r, &pool->g, &pool->b
+    };
+    for(int f = 0; f < PARTICLE_FIELDS; f++) {
+        *fields[f] = block + f * capacity;
+    }
+    pool->capacity = capacity;
+    return OK;
+}
+
+/* Semi-implicit Euler with linear drag, plus aging */
+static void integrate(int n, float dt, float* restrict x, float* restrict y, float* restrict vx, float* restrict vy,
+                      const float* restrict gravity, const float* restrict drag, float* restrict life) {
+    for(int i = 0; i < n; i++) {
+        float damping = 1.0f - drag[i] * dt;
+        damping = (damping > 0.0f)? damping : 0.0f;
+        vx[i] = vx[i] * damping;
+        vy[i] = vy[i] * damping + gravity[i] * dt;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+}
+
+/*
+* Squeeze out dead particles in one stable pass. Nothing moves until the first
+* dead particle, so a pool with no deaths this frame costs a single scan.
+*/
+static void compact(Particle_Pool* p) {
+    int n = p->count;
+    int w = 0;
+    while(w < n && p->life[w] > 0) w++;
+    for(int i = w + 1; i < n; i++) {
+        if(p->life[i] <= 0) continue;
+        p->x[w]        = p->x[i];
+        p->y[w]        = p->y[i];
+        p->vx[w]       = p->vx[i];
+        p->vy[w]       = p->vy[i];
+        p->life[w]     = p->life[i];
+        p->inv_life[w] = p->inv_life[i];
+        p->size[w]     = p->size[i];
+        p->gravity[w]  = p->gravity[i];
+        p->drag[w]     = p->drag[i];
+        p->r[w]        = p->r[i];
+        p->g[w]        = p->g[i];
+        p->b[w]        = p->b[i];
+        w++;
+    }
+    p->count = w;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void effect_queue_initialize(Effect_Queue* q) {
+    memset(q, 0, sizeof(Effect_Queue));
+    q->next_id = 1;
+}
+
+/*
+* Simulation thread: record an effect. Once EFFECT_QUEUE_SIZE newer events
+* exist the oldest is overwritten, a busy frame loses some sparkle, not state.
+*/
+void effect_queue_push(Effect_Queue* q, Effect_Kind kind, float x, float y, float dir_x, float dir_y) {
+    Effect_Event* e = &q->events[q->next_id % EFFECT_QUEUE_SIZE];
+    e->id    = q->next_id++;
+    e->kind  = kind;
+    e->x     = x;
+    e->y     = y;
+    e->dir_x = dir_x;
+    e->dir_y = dir_y;
+}
+
+/*
+* Allocate every particle and vertex up front, nothing is allocated per frame.
+*/
+int create_particle_system(Particle_System* ps, int capacity_per_blend) {
+    memset(ps, 0, sizeof(Particle_System));
+    for(int b = 0; b < BLEND_COUNT; b++) {
+        if(create_pool(&ps->pools[b], capacity_per_blend) != OK) {
+            printf("(create_particle_system): out of memory.\n");
+            destroy_particle_system(ps);
+            return ERROR;
+        }
+    }
+    ps->vertices = MEM_ALLOC(MEM_PARTICLES, sizeof(ALLEGRO_VERTEX) * 6 * capacity_per_blend);
+    if(!ps->vertices) {
+        printf("(create_particle_system): out of memory.\n");
+        destroy_particle_system(ps);
+        return ERROR;
+    }
+    ps->rng = 0x9E3779B9u;
+    return OK;
+}
+
+void destroy_particle_system(Particle_System* ps) {
+    for(int b = 0; b < BLEND_COUNT; b++) {
+        mem_free(ps->pools[b].x);
+        ps->pools[b].x = NULL;
+        ps->pools[b].count = 0;
+    }
+    mem_free(ps->vertices);
+    ps->vertices = NULL;
+}
+
+/*
+* Render thread: spawn the effects of a snapshot that have not been seen yet.
+* Returns the number of new effects.
+*/
+int particles_consume_effects(Particle_System* ps, const Effect_Event events[EFFECT_QUEUE_SIZE]) {
+    uint32_t newest = ps->last_event;
+    int spawned = 0;
+    for(int i = 0; i < EFFECT_QUEUE_SIZE; i++) {
+        const Effect_Event* e = &events[i];
+        if(e->id == 0 || e->id <= ps->last_event) continue;
+        particles_emit(ps, e->kind, e->x, e->y, e->dir_x, e->dir_y);
+        if(e->id > newest) newest = e->id;
+        spawned++;
+    }
+    ps->last_event = newest;
+    return spawned;
+}
+
+/*
+* Spawn one burst. Particles beyond the pool's capacity are dropped. Returns
+* the number spawned.
+*/
+int particles_emit(Particle_System* ps, Effect_Kind kind, float x, float y, float dir_x, float dir_y) {
+    const Effect_Preset* fx = &presets[kind];
+    Particle_Pool* p = &ps->pools[fx->blend];
+    float base = atan2f(dir_y, dir_x);
+    int spawned = 0;
+    for(int k = 0; k < fx->count && p->count < p->capacity; k++) {
+        int i = p->count++;
+        float angle = base + random_float(ps, -fx->spread / 2, fx->spread / 2);
+        float speed = random_float(ps, fx->speed_min, fx->speed_max);
+        float life  = random_float(ps, fx->life_min, fx->life_max);
+        p->x[i]        = x;
+        p->y[i]        = y;
+        p->vx[i]       = speed * cosf(angle);
+        p->vy[i]       = speed * sinf(angle);
+        p->life[i]     = life;
+        p->inv_life[i] = 1.0f / life;
+        p->size[i]     = random_float(ps, fx->size_min, fx->size_max);
+        p->gravity[i]  = fx->gravity;
+        p->drag[i]     = fx->drag;
+        p->r[i]        = fx->r;
+        p->g[i]        = fx->g;
+        p->b[i]        = fx->b;
+        spawned++;
+    }
+    return spawned;
+}
+
+/*
+* Advance every particle by dt seconds and drop the ones that expired.
+*/
+void particles_update(Particle_System* ps, float dt) {
+    for(int b = 0; b < BLEND_COUNT; b++) {
+        Particle_Pool* p = &ps->pools[b];
+        integrate(p->count, dt, p->x, p->y, p->vx, p->vy, p->gravity, p->drag, p->life);
+        compact(p);
+    }
+}
+
+/*
+* Fill the vertex buffer with two triangles per particle of one blend mode,
+* colours premultiplied by the remaining life. Returns the vertex count.
+*/
+int particles_build_vertices(Particle_System* ps, Particle_Blend blend) {
+    Particle_Pool* p = &ps->pools[blend];
+    ALLEGRO_VERTEX* v = ps->vertices;
+    for(int i = 0; i < p->count; i++) {
+        float a  = fminf(1.0f, p->life[i] * p->inv_life[i]);
+        float h  = p->size[i] * 0.5f;
+        float x0 = p->x[i] - h, x1 = p->x[i] + h;
+        float y0 = p->y[i] - h, y1 = p->y[i] + h;
+        ALLEGRO_COLOR c = {p->r[i] * a, p->g[i] * a, p->b[i] * a, (blend == BLEND_ADDITIVE)? 0 : a};
+        ALLEGRO_VERTEX* q = &v[i * 6];
+        q[0] = (ALLEGRO_VERTEX){x0, y0, 0, 0, 0, c};
+        q[1] = (ALLEGRO_VERTEX){x1, y0, 0, 0, 0, c};
+        q[2] = (ALLEGRO_VERTEX){x1, y1, 0, 0, 0, c};
+        q[3] = (ALLEGRO_VERTEX){x0, y0, 0, 0, 0, c};
+        q[4] = (ALLEGRO_VERTEX){x1, y1, 0, 0, 0, c};
+        q[5] = (ALLEGRO_VERTEX){x0, y1, 0, 0, 0, c};
+    }
+    return p->count * 6;
+}
+
+/*
+* One draw per blend mode, in the current transform.
+*/
+void particles_draw(Particle_System* ps) {
+    for(int b = 0; b < BLEND_COUNT; b++) {
+        int vertex_count = particles_build_vertices(ps, b);
+        if(vertex_count == 0) continue;
+        if(b == BLEND_ADDITIVE) {
+            render_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ONE);
+        } else {
+            render_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+        }
+        render_draw_prim(ps->vertices, NULL, vertex_count, NULL, ALLEGRO_PRIM_TRIANGLE_LIST);
+    }
+    /* Back to Allegro's default, premultiplied alpha */
+    render_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+}
+
+int particles_live(Particle_System* ps) {
+    int live = 0;
+    for(int b = 0; b < BLEND_COUNT; b++) {
+        live += ps->pools[b].count;
+    }
+    return live;
+}
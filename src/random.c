@@ -1,17 +1,49 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
 #include "random.h"
 
-void rng_initialize() {
-    srand(time(NULL));
+#define RNG_DEFAULT_STATE 0x9E3779B97F4A7C15ull
+
+/*
+* xorshift64* instead of rand(), so the whole generator is one word that
+* save files can store and restore.
+*/
+static uint64_t rng_next(Rng* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+void rng_initialize(Rng* rng) {
+    rng_seed(rng, (uint64_t)time(NULL));
+}
+
+/*
+* Spread the seed over the state, so small seeds like game numbers still
+* start far apart.
+*/
+void rng_seed(Rng* rng, uint64_t seed) {
+    rng_set_state(rng, (seed + 1) * RNG_DEFAULT_STATE);
+}
+
+bool rng_percent_chance(Rng* rng, double percent) {
+    /* top 53 bits, uniform in [0, 1] */
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740991.0) <= percent;
+}
+
+int rng_random_int(Rng* rng, int min, int max) {
+    return (int)(rng_next(rng) % (uint64_t)((int64_t)max - min + 1)) + min;
 }
 
-bool rng_percent_chance(double percent) {
-    return (double)rand()/(double)((unsigned)RAND_MAX) <= percent;
+uint64_t rng_get_state(const Rng* rng) {
+    return rng->state;
 }
 
-int rng_random_int(int min, int max) {
-    return (rand()%(max - min + 1)) + min;
+void rng_set_state(Rng* rng, uint64_t state) {
+    /* xorshift never leaves zero */
+    rng->state = state ? state : RNG_DEFAULT_STATE;
 }
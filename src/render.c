@@ -0,0 +1,256 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_font.h>          /* Allegro Font library */
+#include <allegro5/allegro_primitives.h>    /* Allegro Primatives library */
+
+/* Local Includes */
+#include "render.h"
+#include "global.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+/* Render thread only */
+static Render_Backend allegro_backend;
+static Render_Backend* current = NULL;
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/* Allegro: straight through */
+static void allegro_begin_frame(Render_Backend* rb, ALLEGRO_COLOR clear) {
+    al_clear_to_color(clear);
+}
+
+static void allegro_end_frame(Render_Backend* rb) {
+    al_flip_display();
+}
+
+static void allegro_use_transform(Render_Backend* rb, const ALLEGRO_TRANSFORM* transform) {
+    al_use_transform(transform);
+}
+
+static void allegro_hold_drawing(Render_Backend* rb, bool hold) {
+    al_hold_bitmap_drawing(hold);
+}
+
+static void allegro_set_blender(Render_Backend* rb, int op, int src, int dst) {
+    al_set_blender(op, src, dst);
+}
+
+static void allegro_draw_region(Render_Backend* rb, ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh,
+                                float cx, float cy, float dx, float dy, float angle, int flags) {
+    if(!texture) return;
+    if(angle == 0 && cx == 0 && cy == 0) {
+        al_draw_bitmap_region(texture, sx, sy, sw, sh, dx, dy, flags);
+    } else {
+        al_draw_tinted_scaled_rotated_bitmap_region(texture, sx, sy, sw, sh, al_map_rgb(255, 255, 255),
+                                                    cx, cy, dx, dy, 1, 1, angle, flags);
+    }
+}
+
+static void allegro_draw_prim(Render_Backend* rb, const ALLEGRO_VERTEX* vertices, const int* indices, int count,
+                              ALLEGRO_BITMAP* texture, int type) {
+    if(indices) {
+        al_draw_indexed_prim(vertices, NULL, texture, indices, count, type);
+    } else {
+        al_draw_prim(vertices, NULL, texture, 0, count, type);
+    }
+}
+
+static void allegro_draw_text(Render_Backend* rb, const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text) {
+    al_draw_text(font, color, x, y, 0, text);
+}
+
+/* Null: nothing */
+static void null_begin_frame(Render_Backend* rb, ALLEGRO_COLOR clear) {}
+static void null_end_frame(Render_Backend* rb) {}
+static void null_use_transform(Render_Backend* rb, const ALLEGRO_TRANSFORM* transform) {}
+static void null_hold_drawing(Render_Backend* rb, bool hold) {}
+static void null_set_blender(Render_Backend* rb, int op, int src, int dst) {}
+static void null_draw_region(Render_Backend* rb, ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh,
+                             float cx, float cy, float dx, float dy, float angle, int flags) {}
+static void null_draw_prim(Render_Backend* rb, const ALLEGRO_VERTEX* vertices, const int* indices, int count,
+                           ALLEGRO_BITMAP* texture, int type) {}
+static void null_draw_text(Render_Backend* rb, const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text) {}
+
+/*
+* Recording: count like Allegro batches. Held bitmap draws are deferred and go
+* out as one call until the texture changes or the hold ends, everything else
+* is a call of its own.
+*/
+static void record_texture(Render_Backend* rb, const void* texture) {
+    if(rb->drawn && texture != rb->texture) {
+        rb->stats.texture_switches++;
+    }
+    rb->texture = texture;
+    rb->drawn   = true;
+}
+
+static void record_begin_frame(Render_Backend* rb, ALLEGRO_COLOR clear) {
+    memset(&rb->stats, 0, sizeof(Render_Stats));
+    rb->drawn    = false;
+    rb->batching = false;
+    if(rb->inner) rb->inner->begin_frame(rb->inner, clear);
+}
+
+static void record_end_frame(Render_Backend* rb) {
+    rb->last_stats = rb->stats;
+    if(rb->inner) rb->inner->end_frame(rb->inner);
+}
+
+static void record_use_transform(Render_Backend* rb, const ALLEGRO_TRANSFORM* transform) {
+    if(rb->inner) rb->inner->use_transform(rb->inner, transform);
+}
+
+static void record_hold_drawing(Render_Backend* rb, bool hold) {
+    rb->held     = hold;
+    rb->batching = false;
+    if(rb->inner) rb->inner->hold_drawing(rb->inner, hold);
+}
+
+static void record_set_blender(Render_Backend* rb, int op, int src, int dst) {
+    if(rb->inner) rb->inner->set_blender(rb->inner, op, src, dst);
+}
+
+static void record_draw_region(Render_Backend* rb, ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh,
+                               float cx, float cy, float dx, float dy, float angle, int flags) {
+    if(!rb->batching || !rb->drawn || texture != rb->texture) {
+        rb->stats.draw_calls++;
+    }
+    record_texture(rb, texture);
+    rb->batching = rb->held;
+    rb->stats.vertices += 6;
+    rb->stats.bitmaps++;
+    if(rb->inner) rb->inner->draw_region(rb->inner, texture, sx, sy, sw, sh, cx, cy, dx, dy, angle, flags);
+}
+
+static void record_draw_prim(Render_Backend* rb, const ALLEGRO_VERTEX* vertices, const int* indices, int count,
+                             ALLEGRO_BITMAP* texture, int type) {
+    rb->stats.draw_calls++;
+    record_texture(rb, texture);
+    rb->batching = false;
+    rb->stats.vertices += count;
+    rb->stats.prims++;
+    if(rb->inner) rb->inner->draw_prim(rb->inner, vertices, indices, count, texture, type);
+}
+
+static void record_draw_text(Render_Backend* rb, const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text) {
+    rb->stats.draw_calls++;
+    record_texture(rb, font);
+    rb->batching = false;
+    rb->stats.vertices += 6 * strlen(text);
+    if(rb->inner) rb->inner->draw_text(rb->inner, font, color, x, y, text);
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void render_allegro_backend(Render_Backend* rb) {
+    memset(rb, 0, sizeof(Render_Backend));
+    rb->name          = "allegro";
+    rb->begin_frame   = allegro_begin_frame;
+    rb->end_frame     = allegro_end_frame;
+    rb->use_transform = allegro_use_transform;
+    rb->hold_drawing  = allegro_hold_drawing;
+    rb->set_blender   = allegro_set_blender;
+    rb->draw_region   = allegro_draw_region;
+    rb->draw_prim     = allegro_draw_prim;
+    rb->draw_text     = allegro_draw_text;
+}
+
+void render_null_backend(Render_Backend* rb) {
+    memset(rb, 0, sizeof(Render_Backend));
+    rb->name          = "null";
+    rb->begin_frame   = null_begin_frame;
+    rb->end_frame     = null_end_frame;
+    rb->use_transform = null_use_transform;
+    rb->hold_drawing  = null_hold_drawing;
+    rb->set_blender   = null_set_blender;
+    rb->draw_region   = null_draw_region;
+    rb->draw_prim     = null_draw_prim;
+    rb->draw_text     = null_draw_text;
+}
+
+/*
+* Count every frame drawn through rb, then hand it to inner. A NULL inner
+* records only, for headless runs.
+*/
+void render_recording_backend(Render_Backend* rb, Render_Backend* inner) {
+    memset(rb, 0, sizeof(Render_Backend));
+    rb->name          = "recording";
+    rb->inner         = inner;
+    rb->begin_frame   = record_begin_frame;
+    rb->end_frame     = record_end_frame;
+    rb->use_transform = record_use_transform;
+    rb->hold_drawing  = record_hold_drawing;
+    rb->set_blender   = record_set_blender;
+    rb->draw_region   = record_draw_region;
+    rb->draw_prim     = record_draw_prim;
+    rb->draw_text     = record_draw_text;
+}
+
+/*
+* Pick the backend the render thread draws with, NULL goes back to Allegro.
+*/
+void render_set_backend(Render_Backend* rb) {
+    current = rb;
+}
+
+Render_Backend* render_backend() {
+    if(!current) {
+        if(!allegro_backend.name) render_allegro_backend(&allegro_backend);
+        current = &allegro_backend;
+    }
+    return current;
+}
+
+void render_begin_frame(ALLEGRO_COLOR clear) {
+    Render_Backend* rb = render_backend();
+    rb->begin_frame(rb, clear);
+}
+
+void render_end_frame() {
+    Render_Backend* rb = render_backend();
+    rb->end_frame(rb);
+}
+
+void render_use_transform(const ALLEGRO_TRANSFORM* transform) {
+    Render_Backend* rb = render_backend();
+    rb->use_transform(rb, transform);
+}
+
+void render_hold_drawing(bool hold) {
+    Render_Backend* rb = render_backend();
+    rb->hold_drawing(rb, hold);
+}
+
+void render_set_blender(int op, int src, int dst) {
+    Render_Backend* rb = render_backend();
+    rb->set_blender(rb, op, src, dst);
+}
+
+void render_draw_region(ALLEGRO_BITMAP* texture, float sx, float sy, float sw, float sh, float cx, float cy, float dx, float dy, float angle, int flags) {
+    Render_Backend* rb = render_backend();
+    rb->draw_region(rb, texture, sx, sy, sw, sh, cx, cy, dx, dy, angle, flags);
+}
+
+void render_draw_prim(const ALLEGRO_VERTEX* vertices, const int* indices, int count, ALLEGRO_BITMAP* texture, int type) {
+    Render_Backend* rb = render_backend();
+    rb->draw_prim(rb, vertices, indices, count, texture, type);
+}
+
+void render_draw_text(const ALLEGRO_FONT* font, ALLEGRO_COLOR color, float x, float y, const char* text) {
+    Render_Backend* rb = render_backend();
+    rb->draw_text(rb, font, color, x, y, text);
+}
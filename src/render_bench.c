@@ -0,0 +1,136 @@
+/*
+* Headless frame benchmark. Runs the simulation without a display, starting a
+* game and firing every few ticks, and draws every published snapshot through
+* the recording backend with nothing behind it. Reports draw calls, texture
+* switches and vertices per frame and the CPU cost of building a frame, and
+* fails if any frame goes over the draw call budget.
+*
+* usage: render_bench [frames] [draw call budget] [hitboxes]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_font.h>          /* Allegro Font library */
+#include <allegro5/allegro_primitives.h>    /* Allegro Primatives library */
+
+/* Local Includes */
+#include "simulation.h"
+#include "scene.h"
+#include "render.h"
+#include "atlas.h"
+#include "global.h"
+#include "mem_track.h"
+
+#define FIRE_INTERVAL 10    /* ticks between shots */
+
+static void push_event(Simulation* sim, int type, int keycode, int button) {
+    ALLEGRO_EVENT event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.any.timestamp = al_get_time();
+    if(keycode) {
+        event.keyboard.keycode = keycode;
+    } else {
+        event.mouse.button = button;
+        event.mouse.x = SCREEN_WIDTH * 3 / 4;
+        event.mouse.y = SCREEN_HEIGHT / 2;
+    }
+    simulation_push_input(sim, &event);
+}
+
+int main(int argc, char** argv) {
+    int frames   = (argc > 1)? atoi(argv[1]) : 600;
+    int budget   = (argc > 2)? atoi(argv[2]) : 0;
+    int hitboxes = (argc > 3)? atoi(argv[3]) : 1;
+    frames = constrain(1, 1000000, frames);
+
+    if(!al_init() || !al_init_font_addon() || !al_init_primitives_addon()) {
+        printf("couldn't initialize allegro\n");
+        return ERROR;
+    }
+    ALLEGRO_FONT* font = al_create_builtin_font();
+    Overlay overlay;
+    Particle_System particles;
+    Latency_Recorder latency;
+    if(!font || atlas_build_headless() != OK || overlay_create(&overlay, font) != OK ||
+       create_particle_system(&particles, PARTICLES_PER_BLEND) != OK) {
+        printf("couldn't set up the frame path\n");
+        return ERROR;
+    }
+    latency_recorder_initialize(&latency, NULL);
+
+    Render_Backend recording;
+    render_recording_backend(&recording, NULL);
+    render_set_backend(&recording);
+
+    /* Start a game with the dev tools up, the worst case for the overlay */
+    Simulation* sim = create_simulation(1);
+    if(!sim) {
+        printf("couldn't create simulation\n");
+        return ERROR;
+    }
+    simulation_set_assets_ready(sim);
+    push_event(sim, ALLEGRO_EVENT_KEY_DOWN, ALLEGRO_KEY_ENTER, 0);
+    simulation_tick(sim);
+    push_event(sim, ALLEGRO_EVENT_KEY_UP, ALLEGRO_KEY_ENTER, 0);
+    sim->show_dev_tools = true;
+    sim->show_hitboxes = hitboxes;
+
+    Render_Stats total = {0}, worst = {0};
+    double frame_ms = 0, worst_ms = 0;
+    int over_budget = 0;
+    for(int f = 0; f < frames; f++) {
+        if(f % FIRE_INTERVAL == 0) {
+            push_event(sim, ALLEGRO_EVENT_MOUSE_BUTTON_DOWN, 0, 1);
+        } else if(f % FIRE_INTERVAL == 1) {
+            push_event(sim, ALLEGRO_EVENT_MOUSE_BUTTON_UP, 0, 1);
+        }
+        simulation_tick(sim);
+        simulation_publish(sim);
+        if(sim->game_state != GS_RUNNING) {
+            printf("game ended after %d frames\n", f);
+            frames = f;
+            break;
+        }
+
+        double start = al_get_time();
+        triple_buffer_consume(&sim->snapshots);
+        Snapshot* snap = triple_buffer_front(&sim->snapshots);
+        particles_consume_effects(&particles, snap->effects);
+        particles_update(&particles, 1.0f / 60.0f);
+        render_begin_frame(al_map_rgb(0, 0, 0));
+        draw_snapshot(snap, 1, font, &overlay, 60, &latency, &particles, 0);
+        render_end_frame();
+        double ms = (al_get_time() - start) * 1000.0;
+
+        Render_Stats* s = &recording.last_stats;
+        total.draw_calls       += s->draw_calls;
+        total.texture_switches += s->texture_switches;
+        total.vertices         += s->vertices;
+        if(s->draw_calls > worst.draw_calls) worst = *s;
+        frame_ms += ms;
+        if(ms > worst_ms) worst_ms = ms;
+        if(budget > 0 && s->draw_calls > budget) over_budget++;
+    }
+    frames = (frames > 0)? frames : 1;
+
+    printf("%d headless frames, hitboxes %s\n", frames, hitboxes? "on" : "off");
+    printf("  draw calls: %.1f per frame, %d worst\n", (double)total.draw_calls / frames, worst.draw_calls);
+    printf("  switches:   %.1f per frame, %d in the worst frame\n", (double)total.texture_switches / frames, worst.texture_switches);
+    printf("  vertices:   %.0f per frame, %d in the worst frame\n", (double)total.vertices / frames, worst.vertices);
+    printf("  cpu:        %.3f ms per frame on average, %.3f ms worst\n", frame_ms / frames, worst_ms);
+
+    destroy_simulation(sim);
+    destroy_particle_system(&particles);
+    overlay_destroy(&overlay);
+    al_destroy_font(font);
+    if(over_budget > 0) {
+        printf("%d frames over the budget of %d draw calls\n", over_budget, budget);
+        return ERROR;
+    }
+    return OK;
+}
@@ -0,0 +1,248 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "rewind.h"
+#include "global.h"
+#include "log.h"
+
+#define WORDS(type) (sizeof(type) / sizeof(uint64_t))
+#define MAX_RUN     0xFFFF
+
+/* Worst case for one frame: every word literal, plus a header per run */
+#define MAX_FRAME_SIZE (sizeof(Rewind_State) * 2)
+
+_Static_assert(sizeof(Mob) % sizeof(uint64_t) == 0, "Mob is encoded as whole words");
+_Static_assert(sizeof(Mob_Handler) % sizeof(uint64_t) == 0, "Mob_Handler is encoded as whole words");
+_Static_assert(sizeof(Projectile_Pool) % sizeof(uint64_t) == 0, "Projectile_Pool is encoded as whole words");
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static inline uint64_t load_word(const unsigned char* p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static Rewind_Frame* frame_at(Rewind_Buffer* rb, int index) {
+    return &rb->frames[(rb->first + index) % REWIND_MAX_FRAMES];
+}
+
+/*
+* Encode cur XOR base a word at a time as runs: a 16 bit count of unchanged
+* words, a 16 bit count of changed ones, then the changed words XORed. A
+* single unchanged word inside a changed stretch stays in the literal, a new
+* run costs as much as the word. A NULL base is all zeros.
+*/
+static unsigned char* delta_encode(unsigned char* out, const void* base_p, const void* cur_p, size_t words) {
+    const unsigned char* base = base_p;
+    const unsigned char* cur  = cur_p;
+    size_t i = 0;
+    while(i < words) {
+        size_t run_start = i;
+        while(i < words && i - run_start < MAX_RUN && load_word(cur + i*8) == (base ? load_word(base + i*8) : 0)) i++;
+        size_t literal_start = i;
+        while(i < words && i - literal_start < MAX_RUN) {
+            bool same = load_word(cur + i*8) == (base ? load_word(base + i*8) : 0);
+            bool next_same = i + 1 >= words || load_word(cur + (i+1)*8) == (base ? load_word(base + (i+1)*8) : 0);
+            if(same && next_same) break;
+            i++;
+        }
+        uint16_t counts[2] = {(uint16_t)(literal_start - run_start), (uint16_t)(i - literal_start)};
+        memcpy(out, counts, sizeof(counts));
+        out += sizeof(counts);
+        for(size_t w = literal_start; w < i; w++) {
+            uint64_t x = load_word(cur + w*8) ^ (base ? load_word(base + w*8) : 0);
+            memcpy(out, &x, sizeof(x));
+            out += sizeof(x);
+        }
+    }
+    return out;
+}
+
+/*
+* XOR an encoded delta into state, which must already hold what it was
+* encoded against. Returns the end of the delta.
+*/
+static const unsigned char* delta_decode(const unsigned char* in, void* state_p, size_t words) {
+    unsigned char* state = state_p;
+    size_t i = 0;
+    while(i < words) {
+        uint16_t counts[2];
+        memcpy(counts, in, sizeof(counts));
+        in += sizeof(counts);
+        i += counts[0];
+        for(int w = 0; w < counts[1] && i < words; w++, i++) {
+            uint64_t x = load_word(state + i*8) ^ load_word(in);
+            memcpy(state + i*8, &x, sizeof(x));
+            in += sizeof(x);
+        }
+    }
+    return in;
+}
+
+static const unsigned char* decode_state(const unsigned char* in, Rewind_State* s) {
+    in = delta_decode(in, &s->player, WORDS(Mob));
+    in = delta_decode(in, &s->mobs, WORDS(Mob_Handler));
+    return delta_decode(in, &s->projectiles, WORDS(Projectile_Pool));
+}
+
+/*
+* Rebuild the state of the frame at index into out, from its keyframe and
+* its own delta.
+*/
+static void decode_frame(Rewind_Buffer* rb, int index, Rewind_State* out) {
+    int key = index;
+    while(key > 0 && !frame_at(rb, key)->is_keyframe) key--;
+    memset(out, 0, sizeof(Rewind_State));
+    decode_state(rb->data + frame_at(rb, key)->offset, out);
+    if(key != index) {
+        decode_state(rb->data + frame_at(rb, index)->offset, out);
+    }
+}
+
+/* A delta is useless without its keyframe, so whole intervals go at once */
+static void drop_oldest(Rewind_Buffer* rb) {
+    do {
+        rb->bytes -= rb->frames[rb->first].size;
+        rb->first = (rb->first + 1) % REWIND_MAX_FRAMES;
+        rb->count--;
+    } while(rb->count > 0 && !rb->frames[rb->first].is_keyframe);
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+int rewind_create(Rewind_Buffer* rb, Mem_Tag tag) {
+    memset(rb, 0, sizeof(Rewind_Buffer));
+    rb->data = MEM_ALLOC(tag, REWIND_BUFFER_SIZE);
+    if(!rb->data) {
+        LOG_ERROR("couldn't allocate %d byte rewind buffer.", REWIND_BUFFER_SIZE);
+        return ERROR;
+    }
+    return OK;
+}
+
+void rewind_destroy(Rewind_Buffer* rb) {
+    mem_free(rb->data);
+    rb->data = NULL;
+    rewind_reset(rb);
+}
+
+/*
+* Forget all history, the next recorded tick starts over with a keyframe.
+*/
+void rewind_reset(Rewind_Buffer* rb) {
+    rb->write          = 0;
+    rb->first          = 0;
+    rb->count          = 0;
+    rb->since_keyframe = 0;
+    rb->bytes          = 0;
+    rb->cursor         = 0;
+    rb->paused         = false;
+    rb->room           = NULL;
+}
+
+/*
+* Record one tick. Moving to another room starts a new history, since the
+* mobs of the old room are gone. Does nothing while paused.
+*/
+void rewind_record(Rewind_Buffer* rb, int64_t tick, const Room* room, const Mob* player, const Mob_Handler* mobs, const Projectile_Pool* projectiles) {
+    if(rb->paused || !rb->data) {
+        return;
+    }
+    double start = al_get_time();
+    if(room != rb->room) {
+        rewind_reset(rb);
+        rb->room = room;
+    }
+
+    /* Make room: frames are never split across the end of the buffer */
+    if(rb->write + MAX_FRAME_SIZE > REWIND_BUFFER_SIZE) {
+        rb->write = 0;
+    }
+    while(rb->count > 0) {
+        Rewind_Frame* oldest = &rb->frames[rb->first];
+        bool overlaps = oldest->offset < rb->write + MAX_FRAME_SIZE && oldest->offset + oldest->size > rb->write;
+        if(!overlaps && rb->count < REWIND_MAX_FRAMES) break;
+        drop_oldest(rb);
+    }
+
+    bool is_keyframe = rb->count == 0 || rb->since_keyframe >= REWIND_KEYFRAME_INTERVAL;
+    const Rewind_State* base = is_keyframe ? NULL : &rb->keyframe;
+    unsigned char* out = rb->data + rb->write;
+    out = delta_encode(out, base ? &base->player : NULL, player, WORDS(Mob));
+    out = delta_encode(out, base ? &base->mobs : NULL, mobs, WORDS(Mob_Handler));
+    out = delta_encode(out, base ? &base->projectiles : NULL, projectiles, WORDS(Projectile_Pool));
+    if(is_keyframe) {
+        rb->keyframe.player      = *player;
+        rb->keyframe.mobs        = *mobs;
+        rb->keyframe.projectiles = *projectiles;
+        rb->since_keyframe = 0;
+    }
+    rb->since_keyframe++;
+
+    Rewind_Frame* f = frame_at(rb, rb->count++);
+    f->tick        = tick;
+    f->offset      = rb->write;
+    f->size        = out - (rb->data + rb->write);
+    f->is_keyframe = is_keyframe;
+    rb->write += f->size;
+    rb->bytes += f->size;
+    rb->record_ms = (al_get_time() - start) * 1000.0;
+}
+
+/*
+* Put the recorded state of frame cursor (0 is the oldest) back into the
+* game. Returns ERROR if there is no such frame.
+*/
+int rewind_seek(Rewind_Buffer* rb, int cursor, Mob* player, Mob_Handler* mobs, Projectile_Pool* projectiles) {
+    if(cursor < 0 || cursor >= rb->count) {
+        return ERROR;
+    }
+    Rewind_State* view = &rb->view;
+    decode_frame(rb, cursor, view);
+    *player      = view->player;
+    *mobs        = view->mobs;
+    *projectiles = view->projectiles;
+    rb->cursor   = cursor;
+    return OK;
+}
+
+/*
+* Stop recording, with the cursor on the newest frame (the current state).
+*/
+void rewind_pause(Rewind_Buffer* rb) {
+    rb->paused = true;
+    rb->cursor = rb->count - 1;
+}
+
+/*
+* Carry on from the frame the cursor is on. Anything recorded after it is
+* discarded, the game goes a different way from here.
+*/
+void rewind_resume(Rewind_Buffer* rb) {
+    rb->paused = false;
+    if(rb->count == 0) {
+        return;
+    }
+    while(rb->count > rb->cursor + 1) {
+        rb->bytes -= frame_at(rb, --rb->count)->size;
+    }
+    Rewind_Frame* last = frame_at(rb, rb->cursor);
+    rb->write = last->offset + last->size;
+
+    int key = rb->cursor;
+    while(key > 0 && !frame_at(rb, key)->is_keyframe) key--;
+    decode_frame(rb, key, &rb->keyframe);
+    rb->since_keyframe = rb->cursor - key + 1;
+}
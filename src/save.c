@@ -0,0 +1,229 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* Local Includes */
+#include "save.h"
+#include "random.h"
+#include "asset_pack.h"
+#include "mem_track.h"
+#include "log.h"
+
+#define SAVE_WRITE_BUFFER (256 * 1024)   /* stdio buffer, so chunks go out in big writes */
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static Save_Header save_header(Simulation* sim) {
+    Save_Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SAVE_MAGIC, sizeof(h.magic));
+    h.version      = SAVE_VERSION;
+    h.room_size    = sizeof(Room);
+    h.mob_size     = sizeof(Mob);
+    h.chunk_size   = sizeof(Floor_Chunk);
+    h.handler_size = sizeof(Mob_Handler);
+    h.pool_size    = sizeof(Projectile_Pool);
+    h.rng_state    = rng_get_state(&sim->game.rng);
+    h.tick         = sim->scheduler.tick_count;
+    h.floor_number = sim->floor.number;
+    h.rows         = sim->floor.rows;
+    h.cols         = sim->floor.cols;
+    h.key_found    = sim->floor.key_found;
+    h.room_count   = sim->floor.room_count;
+    h.chunk_count  = sim->floor.chunk_count;
+    h.room_row     = sim->current_room->row_pos;
+    h.room_col     = sim->current_room->col_pos;
+    return h;
+}
+
+/*
+* Check everything about a mapped save before any of it is trusted: the
+* version, the struct layout it was written with, and that the chunk index
+* fits the floor and the file.
+*/
+static int validate_save(const unsigned char* data, size_t size, const char* path) {
+    if(size < sizeof(Save_State)) {
+        LOG_ERROR("%s is too small to be a save.", path);
+        return ERROR;
+    }
+    const Save_Header* h = (const Save_Header*)data;
+    if(memcmp(h->magic, SAVE_MAGIC, sizeof(h->magic)) != 0 || h->version != SAVE_VERSION) {
+        LOG_ERROR("%s is not a version %d save.", path, SAVE_VERSION);
+        return ERROR;
+    }
+    if(h->room_size != sizeof(Room) || h->mob_size != sizeof(Mob) || h->chunk_size != sizeof(Floor_Chunk) ||
+       h->handler_size != sizeof(Mob_Handler) || h->pool_size != sizeof(Projectile_Pool)) {
+        LOG_ERROR("%s was written by a build with a different layout.", path);
+        return ERROR;
+    }
+    if(h->rows <= 0 || h->cols <= 0 || h->chunk_count <= 0) {
+        LOG_ERROR("%s has an empty floor.", path);
+        return ERROR;
+    }
+    int64_t table = (int64_t)((h->rows + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT) * ((h->cols + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT);
+    uint64_t expected = sizeof(Save_State) + (uint64_t)h->chunk_count * (sizeof(int32_t) + sizeof(Floor_Chunk));
+    if(h->chunk_count > table || expected != size) {
+        LOG_ERROR("%s is truncated or corrupt.", path);
+        return ERROR;
+    }
+    const int32_t* index = (const int32_t*)(data + sizeof(Save_State));
+    for(int32_t c = 0; c < h->chunk_count; c++) {
+        if(index[c] < 0 || index[c] >= table) {
+            LOG_ERROR("%s has a bad chunk index %d.", path, index[c]);
+            return ERROR;
+        }
+    }
+    return OK;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Write the running game to path in one sequential pass. The file is written
+* next to path first and renamed over it, so a failed save never clobbers the
+* last good one. Spells that are still mid cast aren't saved, their
+* projectiles are.
+*/
+int save_game(Simulation* sim, const char* path) {
+    if(sim->game_state != GS_RUNNING || !sim->current_room) {
+        LOG_WARN("nothing to save, no game is running.");
+        return ERROR;
+    }
+    double start = al_get_time();
+    char temp_path[512];
+    if(snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        LOG_ERROR("save path %s is too long.", path);
+        return ERROR;
+    }
+    FILE* fp = fopen(temp_path, "wb");
+    if(!fp) {
+        LOG_ERROR("couldn't open %s.", temp_path);
+        return ERROR;
+    }
+    char* buffer = MEM_ALLOC(MEM_SIM, SAVE_WRITE_BUFFER);
+    if(buffer) {
+        setvbuf(fp, buffer, _IOFBF, SAVE_WRITE_BUFFER);
+    }
+
+    Floor* f = &sim->floor;
+    int table = f->chunk_rows * f->chunk_cols;
+    Save_State state;
+    memset(&state, 0, sizeof(state));
+    state.header      = save_header(sim);
+    state.player      = sim->player;
+    state.mobs        = *sim->current_room->m_handler_p;
+    state.projectiles = sim->projectiles;
+    bool written = fwrite(&state, sizeof(state), 1, fp) == 1;
+
+    for(int32_t c = 0; c < table && written; c++) {
+        if(f->chunks[c]) {
+            written = fwrite(&c, sizeof(c), 1, fp) == 1;
+        }
+    }
+    for(int c = 0; c < table && written; c++) {
+        if(f->chunks[c]) {
+            written = fwrite(f->chunks[c], sizeof(Floor_Chunk), 1, fp) == 1;
+        }
+    }
+    written = (fclose(fp) == 0) && written;
+    mem_free(buffer);
+
+#ifdef _WIN32
+    /* rename doesn't replace an existing file on windows */
+    if(written) remove(path);
+#endif
+    if(!written || rename(temp_path, path) != 0) {
+        LOG_ERROR("couldn't write %s.", path);
+        remove(temp_path);
+        return ERROR;
+    }
+    LOG_INFO("saved floor %d (%d chunks) to %s in %.2f ms", f->number, f->chunk_count, path, (al_get_time() - start) * 1000.0);
+    return OK;
+}
+
+/*
+* Replace whatever game is running with the one saved at path. The file is
+* mapped and validated before anything is torn down, so a bad save leaves the
+* current game alone. Chunks are copied out of the mapping, then every pointer
+* they held is fixed up and the mobs get their functions back.
+*/
+int load_game(Simulation* sim, const char* path) {
+    double start = al_get_time();
+    size_t size = 0;
+    const unsigned char* data = map_file(path, &size);
+    if(!data) {
+        LOG_ERROR("couldn't open %s.", path);
+        return ERROR;
+    }
+    if(validate_save(data, size, path) != OK) {
+        unmap_file(data, size);
+        return ERROR;
+    }
+    const Save_State* state = (const Save_State*)data;
+    const Save_Header* h = &state->header;
+    const int32_t* index = (const int32_t*)(data + sizeof(Save_State));
+    const unsigned char* chunk_data = (const unsigned char*)(index + h->chunk_count);
+
+    Floor loaded;
+    if(create_floor_map(&loaded, h->floor_number, h->rows, h->cols) != OK) {
+        unmap_file(data, size);
+        return ERROR;
+    }
+    for(int32_t c = 0; c < h->chunk_count; c++) {
+        Floor_Chunk* chunk = MEM_ALLOC(MEM_TERRAIN, sizeof(Floor_Chunk));
+        if(!chunk) {
+            LOG_ERROR("out of memory loading %s.", path);
+            destroy_floor(&loaded);
+            unmap_file(data, size);
+            return ERROR;
+        }
+        memcpy(chunk, chunk_data + (size_t)c * sizeof(Floor_Chunk), sizeof(Floor_Chunk));
+        mem_free(loaded.chunks[index[c]]);
+        loaded.chunks[index[c]] = chunk;
+    }
+    loaded.chunk_count = h->chunk_count;
+    loaded.room_count  = h->room_count;
+    loaded.key_found   = h->key_found;
+
+    /* The saved room has to exist before the old game is given up for it */
+    Room* saved_room = floor_room(&loaded, h->room_row, h->room_col);
+    if(!saved_room || !saved_room->is_initialized) {
+        LOG_ERROR("%s has no room at %d-%d.", path, h->room_row, h->room_col);
+        destroy_floor(&loaded);
+        unmap_file(data, size);
+        return ERROR;
+    }
+
+    /* Only now is the old game dropped */
+    if(sim->game_state == GS_RUNNING && sim->current_room) {
+        unload_room(sim->current_room);
+        destroy_floor(&sim->floor);
+    }
+    sim->floor = loaded;
+    sim->current_room = relink_floor(&sim->floor, &sim->game, &state->mobs, h->room_row, h->room_col);
+    sim->player = state->player;
+    bind_mob_functions(&sim->player);
+    sim->projectiles = state->projectiles;
+    rng_set_state(&sim->game.rng, h->rng_state);
+    unmap_file(data, size);
+
+    /* Spells mid cast weren't saved */
+    spell_vm_initialize(&sim->spells);
+    sim->spell_cache.replay_count = 0;
+    input_clear(&sim->input);
+    rewind_reset(&sim->rewind);
+    combat_bus_clear(&sim->combat);
+    sim->game_state = GS_RUNNING;
+    LOG_INFO("loaded floor %d (%d chunks) from %s in %.2f ms", sim->floor.number, sim->floor.chunk_count, path, (al_get_time() - start) * 1000.0);
+    return OK;
+}
@@ -0,0 +1,266 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* Allegro Includes */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+#include <allegro5/allegro_font.h>          /* Allegro Font library */
+
+/* Local Includes */
+#include "scene.h"
+#include "global.h"
+#include "atlas.h"
+#include "render.h"
+#include "mem_track.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Variables
+ *******************************************************************************
+*/
+static int dev_tool_pos = 16;
+
+/* Overlay text lines, each formatted again only when what it shows changes */
+enum overlay_text_slot {
+    TXT_KEY_FOUND,
+    TXT_PLAYER,
+    TXT_ROOM,
+    TXT_FPS,
+    TXT_MOUSE,
+    TXT_TICKS,
+    TXT_LOS,
+    TXT_SPELLS,
+    TXT_PARTICLES,
+    TXT_SCRATCH,
+    TXT_REWIND,
+    TXT_CROWD,
+    TXT_COMBAT,
+    TXT_OVERLAY,
+    TXT_RENDER,
+    TXT_LATENCY,
+    TXT_SPELL_CACHE = TXT_LATENCY + LAT_KIND_COUNT,
+    TXT_MEMORY      = TXT_SPELL_CACHE + 1 + SPELL_CACHE_SIZE,
+    TXT_SLOT_COUNT  = TXT_MEMORY + 1 + MEM_TAG_COUNT
+};
+_Static_assert(TXT_SLOT_COUNT <= OVERLAY_TEXT_SLOTS, "not enough overlay text slots");
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Dev tools: input to present latency, one summary line and histogram per kind.
+*/
+static void draw_latency_overlay(Overlay* ov, Latency_Recorder* latency, float y) {
+    float bar_width = 3;
+    float graph_height = 32;
+    for(int k = 0; k < LAT_KIND_COUNT; k++) {
+        Latency_Histogram* h = &latency->histograms[k];
+        overlay_textf(ov, TXT_LATENCY + k, 0, y, al_map_rgb(0, 0, 0), OVERLAY_KEY(h->count, h->max_ms),
+                      "Latency %s: n %d, mean %.1f ms, p95 %.0f ms, max %.1f ms",
+                      latency_kind_name(k), h->count, latency_mean(h), latency_percentile(h, 0.95), h->max_ms);
+        y += dev_tool_pos;
+
+        int tallest = 1;
+        for(int b = 0; b < LATENCY_BUCKETS; b++) {
+            if(h->buckets[b] > tallest) tallest = h->buckets[b];
+        }
+        overlay_outline(ov, 0, y, LATENCY_BUCKETS * bar_width, y + graph_height, 1, al_map_rgb(0, 0, 0));
+        for(int b = 0; b < LATENCY_BUCKETS; b++) {
+            if(h->buckets[b] == 0) continue;
+            float bar = graph_height * h->buckets[b] / tallest;
+            overlay_rect(ov, b * bar_width, y + graph_height - bar, (b + 1) * bar_width, y + graph_height, al_map_rgb(200, 30, 30));
+        }
+        y += graph_height + 4;
+    }
+}
+
+/*
+* Dev tools: every spell the cache has seen, and whether it is replayed from a
+* precompiled table or interpreted.
+*/
+static void draw_spell_cache_overlay(Overlay* ov, Snapshot* snap, float x, float y) {
+    overlay_textf(ov, TXT_SPELL_CACHE, x, y, al_map_rgb(0, 0, 0), OVERLAY_KEY(snap->spell_pattern_count),
+                  "Spell cache: %d entries", snap->spell_pattern_count);
+    for(int i = 0; i < snap->spell_pattern_count; i++) {
+        Spell_Pattern* pattern = &snap->spell_patterns[i];
+        y += dev_tool_pos;
+        if(pattern->is_pattern) {
+            overlay_textf(ov, TXT_SPELL_CACHE + 1 + i, x, y, al_map_rgb(0, 0, 0),
+                          OVERLAY_KEY(pattern->hash, 1, pattern->count, pattern->duration, pattern->casts),
+                          "  %08x %-16s %3d shots over %3d ticks, cast %d", pattern->hash, pattern->name, pattern->count, pattern->duration, pattern->casts);
+        } else {
+            overlay_textf(ov, TXT_SPELL_CACHE + 1 + i, x, y, al_map_rgb(0, 0, 0), OVERLAY_KEY(pattern->hash, 0),
+                          "  %08x %-16s interpreted", pattern->hash, pattern->name);
+        }
+    }
+}
+
+/*
+* Dev tools: live heap and bitmap bytes charged to each subsystem.
+*/
+static void draw_memory_overlay(Overlay* ov, float x, float y) {
+    overlay_textf(ov, TXT_MEMORY, x, y, al_map_rgb(0, 0, 0), OVERLAY_KEY(0), "Memory (live / peak heap, bitmaps):");
+    for(int t = 0; t < MEM_TAG_COUNT; t++) {
+        Mem_Tag_Stats s = mem_tag_stats(t);
+        y += dev_tool_pos;
+        overlay_textf(ov, TXT_MEMORY + 1 + t, x, y, al_map_rgb(0, 0, 0), OVERLAY_KEY(s.live_bytes, s.peak_bytes, s.bitmaps, s.bitmap_bytes),
+                      "  %-10s %8.1f / %8.1f KB, %d bitmaps %8.1f KB",
+                      mem_tag_name(t), s.live_bytes / 1024.0, s.peak_bytes / 1024.0, s.bitmaps, s.bitmap_bytes / 1024.0);
+    }
+}
+
+/*
+* Dev tools: one line per system, each keyed on the values it prints.
+*/
+static void draw_dev_tools(Overlay* ov, Snapshot* snap, double fps, Latency_Recorder* latency, Particle_System* particles, double particle_ms) {
+    ALLEGRO_COLOR black = al_map_rgb(0, 0, 0);
+    int live_particles = particles_live(particles);
+    overlay_textf(ov, TXT_PLAYER, 0, dev_tool_pos * 1, black, OVERLAY_KEY(snap->player.position[0], snap->player.position[1]),
+                  "Player position. x: %d, y: %d", snap->player.position[0], snap->player.position[1]);
+    overlay_textf(ov, TXT_ROOM, 0, dev_tool_pos * 2, black, OVERLAY_KEY(snap->floor_number, snap->room.row_pos, snap->room.col_pos),
+                  "Current Room: %d - %s", snap->floor_number, snap->room.id);
+    overlay_textf(ov, TXT_FPS, 0, dev_tool_pos * 3, black, OVERLAY_KEY(round(fps * 10)), "FPS: %.1f", fps);
+    overlay_textf(ov, TXT_MOUSE, 0, dev_tool_pos * 4, black, OVERLAY_KEY(snap->mouse_x, snap->mouse_y),
+                  "Mouse Position: %d, %d", snap->mouse_x, snap->mouse_y);
+    overlay_textf(ov, TXT_TICKS, 0, dev_tool_pos * 5, black, OVERLAY_KEY(snap->tick, snap->dropped_ticks),
+                  "Ticks: %lld (dropped %lld)", (long long)snap->tick, (long long)snap->dropped_ticks);
+    overlay_textf(ov, TXT_LOS, 0, dev_tool_pos * 6, black,
+                  OVERLAY_KEY(snap->mobs_seeing_player, snap->visibility.queries, snap->visibility.cache_hits, snap->visibility.tiles_walked, snap->visibility.mob_tests),
+                  "LOS: %d/%d mobs see player (%d cached, %d tiles, %d mob tests)",
+                  snap->mobs_seeing_player, snap->visibility.queries, snap->visibility.cache_hits, snap->visibility.tiles_walked, snap->visibility.mob_tests);
+    overlay_textf(ov, TXT_SPELLS, 0, dev_tool_pos * 7, black, OVERLAY_KEY(snap->active_spells, snap->spell_instructions, snap->projectile_count),
+                  "Spells: %d running, %d instructions, %d projectiles", snap->active_spells, snap->spell_instructions, snap->projectile_count);
+    overlay_textf(ov, TXT_PARTICLES, 0, dev_tool_pos * 8, black, OVERLAY_KEY(live_particles, round(particle_ms * 100)),
+                  "Particles: %d (update %.2f ms)", live_particles, particle_ms);
+    overlay_textf(ov, TXT_SCRATCH, 0, dev_tool_pos * 9, black, OVERLAY_KEY(snap->scratch_used, snap->scratch_capacity, snap->scratch_peak),
+                  "Scratch: tick %zu/%zu B (peak %zu)", snap->scratch_used, snap->scratch_capacity, snap->scratch_peak);
+    if(snap->rewind_paused) {
+        overlay_textf(ov, TXT_REWIND, 0, dev_tool_pos * 10, black, OVERLAY_KEY(1, snap->rewind_cursor, snap->rewind_frames),
+                      "Rewind: paused on tick %d of %d, left/right step, P resumes", snap->rewind_cursor + 1, snap->rewind_frames);
+    } else {
+        overlay_textf(ov, TXT_REWIND, 0, dev_tool_pos * 10, black, OVERLAY_KEY(0, snap->rewind_frames, round(snap->rewind_bytes / 102.4), round(snap->rewind_record_ms * 1000)),
+                      "Rewind: %d ticks, %.1f KB, record %.3f ms (P pauses)", snap->rewind_frames, snap->rewind_bytes / 1024.0, snap->rewind_record_ms);
+    }
+    overlay_textf(ov, TXT_CROWD, 0, dev_tool_pos * 11, black,
+                  OVERLAY_KEY(snap->crowd.mobs, snap->crowd.pairs, snap->crowd.iterations, round(snap->crowd.solve_ms * 1000)),
+                  "Crowd: %d mobs, %d overlapping, %d passes, %.3f ms", snap->crowd.mobs, snap->crowd.pairs, snap->crowd.iterations, snap->crowd.solve_ms);
+    overlay_textf(ov, TXT_COMBAT, 0, dev_tool_pos * 12, black, OVERLAY_KEY(snap->combat_events, snap->combat_dropped),
+                  "Combat: %d events resolved, %d dropped", snap->combat_events, snap->combat_dropped);
+    /* Last frame's numbers, this frame's batch isn't finished yet */
+    Overlay_Stats* os = &ov->last_stats;
+    overlay_textf(ov, TXT_OVERLAY, 0, dev_tool_pos * 13, black, OVERLAY_KEY(os->quads, os->dropped, os->formatted, os->texts),
+                  "Overlay: %d quads (%d dropped), %d/%d lines formatted", os->quads, os->dropped, os->formatted, os->texts);
+    /* Only a recording backend counts, otherwise these stay zero */
+    Render_Stats* rs = &render_backend()->last_stats;
+    overlay_textf(ov, TXT_RENDER, 0, dev_tool_pos * 14, black, OVERLAY_KEY(rs->draw_calls, rs->texture_switches, rs->vertices),
+                  "Render (%s): %d draw calls, %d texture switches, %d vertices", render_backend()->name, rs->draw_calls, rs->texture_switches, rs->vertices);
+    draw_latency_overlay(ov, latency, dev_tool_pos * 15);
+    draw_spell_cache_overlay(ov, snap, SCREEN_WIDTH / 2, dev_tool_pos * 2);
+    draw_memory_overlay(ov, SCREEN_WIDTH / 2, dev_tool_pos * (snap->spell_pattern_count + 4));
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void camera_update(float* cameraPosition, float x, float y, float width, float height, float x_max, float y_max) {
+    cameraPosition[0] = -(SCREEN_WIDTH / 2) + (x + width/2);
+    cameraPosition[1] = -(SCREEN_HEIGHT / 2) + (y + height/2);
+
+    cameraPosition[0] = constrain_f(0, abs(x_max - SCREEN_WIDTH), cameraPosition[0]);
+    cameraPosition[1] = constrain_f(0, abs(y_max - SCREEN_HEIGHT), cameraPosition[1]);
+}
+
+/*
+* Render one snapshot published by the simulation thread. Positions are blended
+* between the snapshot's previous and current tick using alpha. Everything
+* goes through the current render backend, so this runs headless too.
+*/
+void draw_snapshot(Snapshot* snap, double alpha, ALLEGRO_FONT* font, Overlay* ov, double fps, Latency_Recorder* latency, Particle_System* particles, double particle_ms) {
+    if(snap->game_state == GS_RUNNING) {
+        /* Update camera position and transform everything on the screen */
+        float cameraPosition[2] = {0, 0};
+        ALLEGRO_TRANSFORM camera;
+        float player_pos[2];
+        interpolate_mob_position(&snap->player, alpha, player_pos);
+        camera_update(cameraPosition, player_pos[0], player_pos[1], snap->player.width, snap->player.height, snap->room.width, snap->room.height);
+        al_identity_transform(&camera);
+        al_translate_transform(&camera, -cameraPosition[0], -cameraPosition[1]);
+        render_use_transform(&camera);
+
+        /* Everything in the world samples the atlas, so let allegro batch it */
+        render_hold_drawing(true);
+        draw_room(&snap->room, snap->tileset);
+        for(int i = 0; i < snap->mob_count; i++) {
+            snap->mobs[i].draw(&snap->mobs[i], alpha);
+        }
+        snap->player.draw(&snap->player, alpha);
+        for(int b = 0; b < snap->projectile_count; b++) {
+            draw_projectile(&snap->projectiles[b], alpha);
+        }
+        render_hold_drawing(false);
+        particles_draw(particles);
+
+        /* Bars, hitboxes, text and the minimap all go out in one batch */
+        overlay_begin(ov);
+        for(int i = 0; i < snap->mob_count; i++) {
+            draw_mob_overlay(ov, &snap->mobs[i], alpha, snap->show_hitboxes);
+        }
+        draw_mob_overlay(ov, &snap->player, alpha, snap->show_hitboxes);
+        for(int b = 0; b < snap->projectile_count; b++) {
+            draw_projectile_overlay(ov, &snap->projectiles[b], snap->show_hitboxes);
+        }
+        overlay_textf(ov, TXT_KEY_FOUND, 0, dev_tool_pos * 0, al_map_rgb(0, 0, 0), OVERLAY_KEY(snap->key_found), "key found: %d", snap->key_found);
+        if(snap->show_dev_tools) {
+            draw_dev_tools(ov, snap, fps, latency, particles, particle_ms);
+        }
+        /* Draw Minimap */
+        float box_len = 10;
+        float scl = 1.1;
+        float startx = SCREEN_WIDTH - ((scl * box_len) * MINIMAP_SIZE);
+        float starty = 0;
+        ALLEGRO_COLOR c;
+        for(int i = 0; i < MINIMAP_SIZE; i++) {
+            for(int j = 0; j < MINIMAP_SIZE; j++) {
+                if(snap->minimap[i][j].is_initialized) {
+                    if(snap->minimap[i][j].is_loaded) {
+                        c = al_map_rgb(240, 201, 31);
+                    } else {
+                        switch(snap->minimap[i][j].type) {
+                            case R_CHALLENGE:
+                                c = al_map_rgb(128, 10, 100);
+                                break;
+                            case R_EXIT:
+                                c = al_map_rgb(255, 50, 50);
+                                break;
+                            case R_KEY:
+                                c = al_map_rgb(50, 255, 50);
+                                break;
+                            case R_SHOP:
+                                c = al_map_rgb(25, 2, 104);
+                                break;
+                            default:
+                                c = al_map_rgb(128, 128, 128);
+                                break;
+                        }
+                    }
+                    int x1 = startx + (j * scl * box_len);
+                    int y1 = starty + (i * scl * box_len);
+                    overlay_rect(ov, x1, y1, x1 + box_len, y1 + box_len, c);
+                }
+            }
+        }
+        overlay_flush(ov);
+    }
+    else if(snap->game_state == GS_MENU) {
+        if(atlas_is_initialized()) {
+            render_draw_text(font, al_map_rgb(255, 255, 255), SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2, "Press [ENTER] to Begin");
+        } else {
+            render_draw_text(font, al_map_rgb(255, 255, 255), SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2, "Loading...");
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include "scheduler.h"
+#include "global.h"
+
+Scheduler create_scheduler(double tick_rate, int max_catchup, double now) {
+    Scheduler s = {
+        .tick_dt          = 1.0 / tick_rate,
+        .accumulator      = 0,
+        .last_time        = now,
+        .max_catchup      = max_catchup,
+        .steps_this_frame = 0,
+        .tick_count       = 0,
+        .dropped_ticks    = 0
+    };
+    return s;
+}
+
+/*
+*  Add the real time elapsed since the last frame. If we fell further behind
+*  than max_catchup ticks (debugger, window drag, etc.) the extra time is
+*  dropped rather than trying to simulate it all at once.
+*/
+void scheduler_begin_frame(Scheduler* s, double now) {
+    s->accumulator += now - s->last_time;
+    s->last_time = now;
+    s->steps_this_frame = 0;
+
+    double max_accumulated = s->max_catchup * s->tick_dt;
+    if(s->accumulator > max_accumulated) {
+        s->dropped_ticks += (int64_t)((s->accumulator - max_accumulated) / s->tick_dt);
+        s->accumulator = max_accumulated;
+    }
+}
+
+/*
+*  Returns true while there is at least one whole tick of time to simulate.
+*/
+bool scheduler_step(Scheduler* s) {
+    if(s->accumulator < s->tick_dt) {
+        return false;
+    }
+    s->accumulator -= s->tick_dt;
+    s->steps_this_frame++;
+    s->tick_count++;
+    return true;
+}
+
+/*
+*  How far we are between the last simulated state and the next one, [0, 1).
+*/
+double scheduler_alpha(Scheduler* s) {
+    return constrain_f(0, 1, s->accumulator / s->tick_dt);
+}
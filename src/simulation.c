@@ -0,0 +1,630 @@
+/* Standard Libraries */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Allegro Libraries */
+#include <allegro5/allegro5.h>              /* Base Allegro library */
+
+/* local Libraries */
+#include "simulation.h"
+#include "random.h"
+#include "asset_pack.h"
+#include "log.h"
+#include "mem_track.h"
+#include "save.h"
+
+/* Used when the spell files in assets/spells are missing or do not compile */
+static const char* default_primary_spell =
+    "speed = 50\n"
+    "damage = 10\n"
+    "size = 5\n"
+    "fire\n";
+
+static const char* default_secondary_spell =
+    "speed = 10\n"
+    "damage = 20\n"
+    "size = 10\n"
+    "fire\n";
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static void load_spell(const char* file, const char* fallback, Spell_Program* out) {
+    char path[512];
+    if(asset_path(file, path, sizeof(path)) == OK && spell_load(path, out) == OK) {
+        return;
+    }
+    LOG_WARN("using built in spell for %s", file);
+    spell_compile(fallback, file, out, NULL, 0);
+}
+
+static void emit_projectile(const Spell_Emit* e, void* ctx) {
+    Projectile_Pool* pool = ctx;
+    spawn_projectile(pool, e->x, e->y, e->vx, e->vy, e->size, e->damage);
+}
+
+/*
+* Precompiled spells are replayed from the cache, only spells that could not
+* be flattened go through the interpreter.
+*/
+static void cast_spell(Simulation* sim, const Spell_Program* spell) {
+    Mob* p = &sim->player;
+    float cx = p->position[0] + p->width/2;
+    float cy = p->position[1] + p->height/2;
+    float dx = sim->input.mouse_x - cx;
+    float dy = sim->input.mouse_y - cy;
+    float len = sqrtf(dx*dx + dy*dy);
+    if(len == 0) {
+        dx  = 1;
+        len = 1;
+    }
+
+    effect_queue_push(&sim->effects, FX_CAST, cx, cy, dx / len, dy / len);
+    Spell_Pattern* pattern = spell_cache_lookup(&sim->spell_cache, spell);
+    if(pattern && pattern->is_pattern) {
+        spell_cache_cast(&sim->spell_cache, pattern, cx, cy, dx / len, dy / len);
+    } else {
+        spell_cast(&sim->spells, spell, cx, cy, atan2f(dy, dx));
+    }
+}
+
+static int initialize_game_state(Game_Context* game, Mob* p_p, Floor* f_p) {
+    Mob p;
+    Room* r;
+    int size = floor_size(1);
+
+    if(generate_floor(f_p, game, 1, size, size, size/2, size/2) != OK) {
+        return ERROR;
+    }
+
+    r = floor_room(f_p, size/2, size/2);
+
+    int start_player_pos_x = r->width/2 - PLAYER_WIDTH/2;
+    int start_player_pos_y = r->height/2 - PLAYER_HEIGHT/2;
+    p = initialize_mob(PLAYER, 0, start_player_pos_x, start_player_pos_y);
+    memcpy(p_p, &p, sizeof(Mob));
+    return OK;
+}
+
+/*
+* Temp -- move to the next floor from the exit room, or pick up the key.
+*/
+static void interact(Simulation* sim) {
+    Room* current_room = sim->current_room;
+    if(current_room->type == R_EXIT && sim->floor.key_found) {
+        Floor new_floor;
+        int row = current_room->row_pos;
+        int col = current_room->col_pos;
+        /* Floors only grow, so the exit position is always on the next one */
+        int size = floor_size(sim->floor.number+1);
+        if(generate_floor(&new_floor, &sim->game, sim->floor.number+1, size, size, row, col) != OK) {
+            return;
+        }
+        /* Insert Loading Screen or spawning animation here */
+        unload_room(current_room);
+        destroy_floor(&sim->floor);
+        sim->floor = new_floor;
+        sim->current_room = floor_room(&sim->floor, row, col);
+        load_room(&sim->game, sim->current_room);
+    }
+    else if(current_room->type == R_KEY && !sim->floor.key_found) {
+        Mob* p = &sim->player;
+        combat_emit(&sim->combat, CP_INTERACT, (Combat_Event){
+            .type = CE_PICKUP, .target = COMBAT_PLAYER, .source = PICKUP_KEY,
+            .x = p->position[0] + p->width/2, .y = p->position[1] + p->height/2});
+    }
+}
+
+/*
+* Tag inputs this tick acts on, so the render thread can time them to the first
+* frame that shows the result.
+*/
+static void track_input_latency(Simulation* sim) {
+    Input_State* input = &sim->input;
+    double now = al_get_time();
+    if(input_pressed(input, ACT_FIRE_PRIMARY)) {
+        latency_queue_push(&sim->latency, LAT_FIRE, sim->scheduler.tick_count, input->press_time[ACT_FIRE_PRIMARY], now);
+    }
+    if(input_pressed(input, ACT_FIRE_SECONDARY)) {
+        latency_queue_push(&sim->latency, LAT_FIRE, sim->scheduler.tick_count, input->press_time[ACT_FIRE_SECONDARY], now);
+    }
+    for(int a = ACT_MOVE_UP; a <= ACT_MOVE_RIGHT; a++) {
+        if(input_pressed(input, a)) {
+            latency_queue_push(&sim->latency, LAT_MOVE, sim->scheduler.tick_count, input->press_time[a], now);
+        }
+    }
+}
+
+/*
+* One batch of line of sight checks per tick, every mob to the player. This is
+* where mob AI and auto-aim add their own queries.
+*/
+static void update_visibility(Simulation* sim) {
+    Room* room = sim->current_room;
+    Mob_Handler* handler = room->m_handler_p;
+    Visibility_Service* vs = &sim->visibility;
+    Mob* p = &sim->player;
+    int* handles = FRAME_ARENA_ARRAY(&sim->scratch, int, handler->local_max_mobs);
+    if(!handles) {
+        return;
+    }
+
+    visibility_begin(vs, &room->tiles->solidity, room->tiles->generation, handler);
+    float px = p->position[0] + p->width/2;
+    float py = p->position[1] + p->height/2;
+    for(int i = 0; i < handler->local_max_mobs; i++) {
+        Mob* m = &handler->mobs[i];
+        handles[i] = (m->type == DEFAULT)? -1 : visibility_add_query(vs, m->position[0] + m->width/2, m->position[1] + m->height/2, px, py, i, -1);
+    }
+    visibility_resolve(vs);
+
+    sim->mobs_seeing_player = 0;
+    for(int i = 0; i < handler->local_max_mobs; i++) {
+        if(visibility_result(vs, handles[i])) sim->mobs_seeing_player++;
+    }
+}
+
+/*
+* Contact damage, every live mob touching the player. Only reads the room, so
+* it can run alongside the projectile sweep.
+*/
+static void detect_contacts(Simulation* sim, Room* room) {
+    Mob* p = &sim->player;
+    Mob_Handler* handler = room->m_handler_p;
+    for(int i = 0; i < handler->local_max_mobs; i++) {
+        Mob* m = &handler->mobs[i];
+        if(m->type != DEFAULT && is_collision(&p->hb, &m->hb)) {
+            combat_emit(&sim->combat, CP_CONTACT, (Combat_Event){
+                .type = CE_CONTACT, .target = COMBAT_PLAYER, .source = i, .amount = 10,
+                .x = m->position[0] + m->width/2, .y = m->position[1] + m->height/2});
+        }
+    }
+}
+
+static void apply_combat_events(Simulation* sim, const Combat_Event* events, int count) {
+    Mob* p = &sim->player;
+    Mob_Handler* handler = sim->current_room->m_handler_p;
+    for(int e = 0; e < count; e++) {
+        const Combat_Event* ev = &events[e];
+        Mob* m = (ev->target == COMBAT_PLAYER)? p : &handler->mobs[ev->target];
+        /* Removed by an earlier death this tick */
+        if(m->type == DEFAULT) {
+            continue;
+        }
+        switch(ev->type) {
+            case CE_HIT:
+                effect_queue_push(&sim->effects, FX_SPELL_HIT, ev->x, ev->y, ev->dir_x, ev->dir_y);
+                /* fall through */
+            case CE_CONTACT:
+                if(m->current_state == DEAD) break;
+                m->current_health -= ev->amount;
+                if(m != p && m->current_health <= 0) {
+                    m->current_state = DEAD;
+                    combat_emit(&sim->combat, CP_RESOLVE, (Combat_Event){
+                        .type = CE_DEATH, .target = ev->target, .source = ev->source,
+                        .x = m->position[0] + m->width/2, .y = m->position[1] + m->height/2, .dir_y = -1});
+                }
+                break;
+            case CE_DEATH:
+                effect_queue_push(&sim->effects, FX_SLIME_DEATH, ev->x, ev->y, ev->dir_x, ev->dir_y);
+                remove_mob(handler, m);
+                break;
+            case CE_PICKUP:
+                if(ev->source == PICKUP_KEY) sim->floor.key_found = true;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/*
+* Apply everything detected this tick in one batch. Events come back sorted,
+* so the outcome doesn't depend on which pass found them first. Mobs that run
+* out of health raise a death, resolved in a second round so every hit on them
+* lands first.
+*/
+static void resolve_combat(Simulation* sim) {
+    int count, deaths;
+    Combat_Event* events = combat_collect(&sim->combat, CP_CONTACT, CP_INTERACT, &sim->scratch, &count);
+    apply_combat_events(sim, events, count);
+    events = combat_collect(&sim->combat, CP_RESOLVE, CP_RESOLVE, &sim->scratch, &deaths);
+    apply_combat_events(sim, events, deaths);
+    sim->combat.resolved = count + deaths;
+}
+
+/*
+* Dev tools rewind: P pauses, then left and right step through the recorded
+* ticks, and P again carries on from the shown tick. Returns true while
+* paused, when the rest of the tick is skipped.
+*/
+static bool rewind_controls(Simulation* sim) {
+    Input_State* input = &sim->input;
+    Rewind_Buffer* rb = &sim->rewind;
+    if(sim->show_dev_tools && input_pressed(input, ACT_REWIND_PAUSE)) {
+        if(rb->paused) {
+            rewind_resume(rb);
+        } else {
+            rewind_pause(rb);
+        }
+    }
+    if(!rb->paused) {
+        return false;
+    }
+    int step = input_pressed(input, ACT_STEP_FORWARD) - input_pressed(input, ACT_STEP_BACK);
+    if(step != 0) {
+        rewind_seek(rb, rb->cursor + step, &sim->player, sim->current_room->m_handler_p, &sim->projectiles);
+    }
+    return true;
+}
+
+static void running_tick(Simulation* sim) {
+    Mob* p = &sim->player;
+    Input_State* input = &sim->input;
+
+    if(rewind_controls(sim)) {
+        if(input_down(&sim->input, ACT_QUIT)) {
+            __atomic_store_n(&sim->quit_requested, true, __ATOMIC_RELEASE);
+        }
+        return;
+    }
+
+    /* Cast spells */
+    if(input_pressed(input, ACT_FIRE_PRIMARY)) {
+        cast_spell(sim, &sim->primary_spell);
+    }
+    if(input_pressed(input, ACT_FIRE_SECONDARY)) {
+        cast_spell(sim, &sim->secondary_spell);
+    }
+    /* K kill all mobs in the room */
+    if(input_pressed(input, ACT_KILL_ROOM)) {
+        reset_handler(sim->current_room->m_handler_p);
+        p->current_health -= 10;
+    }
+    /* Turn on Hitboxes*/
+    if(input_pressed(input, ACT_TOGGLE_HITBOXES)) {
+        sim->show_hitboxes = !sim->show_hitboxes;
+    }
+    if(input_pressed(input, ACT_INTERACT)) {
+        interact(sim);
+    }
+    /* F5 quick save, F9 quick load */
+    if(input_pressed(input, ACT_QUICKSAVE)) {
+        save_game(sim, QUICKSAVE_FILE);
+    }
+    if(input_pressed(input, ACT_QUICKLOAD)) {
+        load_game(sim, QUICKSAVE_FILE);
+    }
+    track_input_latency(sim);
+
+    Room* current_room = sim->current_room;
+
+    /* Update Player */
+    p->update(input, p, current_room->width, current_room->height);
+
+    if(p->current_state == DEAD) {
+        // STRETCH: End Run screen with stats.
+        // clear all keyboard inputs, change game state to menu
+        // TODO: Free memory of everything --> dungeon, mobs, etc.
+        sim->game_state = GS_MENU;
+        input_clear(&sim->input);
+        destroy_floor(&sim->floor);
+        rewind_reset(&sim->rewind);
+        combat_bus_clear(&sim->combat);
+        LOG_INFO("player died on floor %d.", sim->floor.number);
+        return;
+    }
+
+    /* Run spells, they spawn this tick's new projectiles */
+    spell_cache_tick(&sim->spell_cache, emit_projectile, &sim->projectiles);
+    sim->spell_instructions = spell_vm_tick(&sim->spells, emit_projectile, &sim->projectiles);
+
+    /* Detect contact and projectile hits, they only queue events */
+    detect_contacts(sim, current_room);
+    Hitbox walls[MAX_ROOM_WALLS];
+    int wall_count = get_room_walls(current_room, walls);
+    for(int b = 0; b < MAX_PROJECTILES; b++) {
+        Projectile* bullet = &sim->projectiles.projectiles[b];
+        if(!bullet->live) continue;
+        Projectile_Hit hit = update_projectile(bullet, current_room->m_handler_p, &current_room->tiles->solidity, walls, wall_count);
+        float bx = bullet->x + bullet->r;
+        float by = bullet->y + bullet->r;
+        if(hit.type == HIT_MOB) {
+            combat_emit(&sim->combat, CP_PROJECTILES, (Combat_Event){
+                .type = CE_HIT, .target = hit.mob_index, .source = b, .amount = bullet->damage,
+                .x = bx, .y = by, .dir_x = -bullet->xspeed, .dir_y = -bullet->yspeed});
+        }
+        else if(hit.type == HIT_WALL) {
+            effect_queue_push(&sim->effects, FX_WALL_HIT, bx, by, -bullet->xspeed, -bullet->yspeed);
+        }
+    }
+    resolve_combat(sim);
+
+    /* Update all elements of the dungeon */
+    sim->current_room = update_dungeon_state(&sim->game, &sim->floor, current_room, p);
+    Mob_Handler* mobs = sim->current_room->m_handler_p;
+    if(mobs->is_initialized) {
+        crowd_separate(&sim->crowd, mobs->mobs, mobs->local_max_mobs, sim->current_room->width, sim->current_room->height, &sim->scratch);
+    }
+    update_visibility(sim);
+    rewind_record(&sim->rewind, sim->scheduler.tick_count, sim->current_room, p, sim->current_room->m_handler_p, &sim->projectiles);
+
+    /* ESC key to exit game */
+    if(input_down(&sim->input, ACT_QUIT)) {
+        __atomic_store_n(&sim->quit_requested, true, __ATOMIC_RELEASE);
+        return;
+    }
+
+    /* T key to show dev tools */
+    if(input_down(&sim->input, ACT_DEV_TOOLS)) {
+        sim->show_dev_tools = true;
+    }
+}
+
+static void menu_tick(Simulation* sim) {
+    /* ESC key to exit game */
+    if(input_down(&sim->input, ACT_QUIT)) {
+        __atomic_store_n(&sim->quit_requested, true, __ATOMIC_RELEASE);
+        return;
+    }
+    /* A save given on the command line, as soon as rooms can be loaded */
+    if(sim->load_path && __atomic_load_n(&sim->assets_ready, __ATOMIC_ACQUIRE)) {
+        const char* path = sim->load_path;
+        sim->load_path = NULL;
+        if(load_game(sim, path) == OK) {
+            return;
+        }
+    }
+    /* ENTER key, only once the render thread has the atlas up */
+    if(input_down(&sim->input, ACT_CONFIRM) && __atomic_load_n(&sim->assets_ready, __ATOMIC_ACQUIRE)) {
+        sim->game_state = GS_RUNNING;
+        /* clears keyboard inputs */
+        input_clear(&sim->input);
+        /* Initialize Dungeon and Load Room */
+        if(initialize_game_state(&sim->game, &sim->player, &sim->floor) != OK) {
+            sim->game_state = GS_MENU;
+            return;
+        }
+        sim->current_room = floor_room(&sim->floor, sim->floor.rows/2, sim->floor.cols/2);
+        load_room(&sim->game, sim->current_room);
+    }
+}
+
+/*
+* Simulation thread: wakes on its own TICK_RATE timer, so it never waits on the
+* display. Input arrives through the lock-free input ring and is folded into
+* the action bitsets at the start of every tick. Publishes one snapshot per
+* batch of ticks.
+*/
+static void* simulation_thread(ALLEGRO_THREAD* thread, void* arg) {
+    Simulation* sim = arg;
+    ALLEGRO_EVENT_QUEUE* queue = al_create_event_queue();
+    ALLEGRO_TIMER* timer = al_create_timer(sim->scheduler.tick_dt);
+    if(!queue || !timer) {
+        LOG_ERROR("couldn't create simulation queue/timer.");
+        __atomic_store_n(&sim->quit_requested, true, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    al_register_event_source(queue, al_get_timer_event_source(timer));
+
+    sim->scheduler = create_scheduler(TICK_RATE, MAX_CATCHUP_TICKS, al_get_time());
+    al_start_timer(timer);
+
+    ALLEGRO_EVENT event;
+    while(!al_get_thread_should_stop(thread) && !__atomic_load_n(&sim->quit_requested, __ATOMIC_ACQUIRE)) {
+        /* Sleep until the tick timer, dropping any timer events we fell behind on */
+        al_wait_for_event(queue, &event);
+        while(al_get_next_event(queue, &event));
+
+        /* Run as many fixed ticks as real time has accumulated */
+        scheduler_begin_frame(&sim->scheduler, al_get_time());
+        while(scheduler_step(&sim->scheduler)) {
+            simulation_tick(sim);
+        }
+        if(sim->scheduler.steps_this_frame > 0) {
+            simulation_publish(sim);
+        }
+    }
+
+    al_destroy_timer(timer);
+    al_destroy_event_queue(queue);
+    return NULL;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* A simulation with its own game context, generating from seed. Simulations
+* share nothing mutable, so any number can tick on as many threads.
+*/
+Simulation* create_simulation(uint64_t seed) {
+    Simulation* sim = MEM_CALLOC(MEM_SIM, 1, sizeof(Simulation));
+    if(!sim) {
+        LOG_ERROR("out of memory.");
+        return NULL;
+    }
+    sim->scheduler    = create_scheduler(TICK_RATE, MAX_CATCHUP_TICKS, al_get_time());
+    sim->game_state   = GS_MENU;
+    sim->player       = default_mob();
+    sim->current_room = NULL;
+    sim->input        = default_input_state();
+    game_context_initialize(&sim->game, seed);
+    input_ring_initialize(&sim->input_ring);
+    latency_queue_initialize(&sim->latency);
+    visibility_initialize(&sim->visibility);
+    effect_queue_initialize(&sim->effects);
+    initialize_projectile_pool(&sim->projectiles);
+    spell_vm_initialize(&sim->spells);
+    spell_cache_initialize(&sim->spell_cache);
+    load_spell("spells/primary.spell", default_primary_spell, &sim->primary_spell);
+    load_spell("spells/secondary.spell", default_secondary_spell, &sim->secondary_spell);
+    spell_cache_lookup(&sim->spell_cache, &sim->primary_spell);
+    spell_cache_lookup(&sim->spell_cache, &sim->secondary_spell);
+    triple_buffer_initialize(&sim->snapshots);
+    if(frame_arena_create(&sim->scratch, SIM_SCRATCH_SIZE, MEM_SIM) != OK) {
+        mem_free(sim);
+        return NULL;
+    }
+    if(rewind_create(&sim->rewind, MEM_SIM) != OK) {
+        frame_arena_destroy(&sim->scratch);
+        mem_free(sim);
+        return NULL;
+    }
+    crowd_create(&sim->crowd, SIM_CROWD_THREADS);
+    combat_bus_initialize(&sim->combat);
+    return sim;
+}
+
+void destroy_simulation(Simulation* sim) {
+    if(!sim) return;
+    simulation_stop(sim);
+    if(sim->game_state == GS_RUNNING && sim->current_room) {
+        unload_room(sim->current_room);
+        destroy_floor(&sim->floor);
+    }
+    crowd_destroy(&sim->crowd);
+    rewind_destroy(&sim->rewind);
+    frame_arena_destroy(&sim->scratch);
+    mem_free(sim);
+}
+
+int simulation_start(Simulation* sim) {
+    sim->thread = al_create_thread(simulation_thread, sim);
+    if(!sim->thread) {
+        LOG_ERROR("couldn't create simulation thread.");
+        return ERROR;
+    }
+    al_start_thread(sim->thread);
+    return OK;
+}
+
+void simulation_stop(Simulation* sim) {
+    if(sim->thread) {
+        al_join_thread(sim->thread, NULL);
+        al_destroy_thread(sim->thread);
+        sim->thread = NULL;
+    }
+}
+
+/*
+* Called by the render thread once the atlas is uploaded, gameplay can start.
+*/
+void simulation_set_assets_ready(Simulation* sim) {
+    __atomic_store_n(&sim->assets_ready, true, __ATOMIC_RELEASE);
+}
+
+bool simulation_quit_requested(Simulation* sim) {
+    return __atomic_load_n(&sim->quit_requested, __ATOMIC_ACQUIRE);
+}
+
+/*
+* Called on the render thread for every device event. Returns false if the
+* event is not gameplay input or the input ring is full.
+*/
+bool simulation_push_input(Simulation* sim, ALLEGRO_EVENT* event) {
+    Input_Event input_event;
+    if(!input_translate_event(event, &input_event)) {
+        return false;
+    }
+    return input_push(&sim->input_ring, &input_event);
+}
+
+/*
+* One fixed step of gameplay.
+*/
+void simulation_tick(Simulation* sim) {
+    input_begin_tick(&sim->input, &sim->input_ring);
+    if(sim->game_state == GS_RUNNING) {
+        running_tick(sim);
+    } else {
+        menu_tick(sim);
+    }
+    frame_arena_reset(&sim->scratch);
+}
+
+/*
+* Copy the render relevant state into the triple buffer's back slot and
+* publish it.
+*/
+void simulation_publish(Simulation* sim) {
+    Snapshot* snap = triple_buffer_back(&sim->snapshots);
+
+    snap->tick           = sim->scheduler.tick_count;
+    snap->publish_time   = al_get_time();
+    snap->tick_dt        = sim->scheduler.tick_dt;
+    snap->dropped_ticks  = sim->scheduler.dropped_ticks;
+    snap->game_state     = sim->game_state;
+    snap->show_dev_tools = sim->show_dev_tools;
+    snap->show_hitboxes  = sim->show_hitboxes;
+    snap->mouse_x        = sim->input.mouse_x;
+    snap->mouse_y        = sim->input.mouse_y;
+    memcpy(snap->latency, sim->latency.samples, sizeof(snap->latency));
+    memcpy(snap->effects, sim->effects.events, sizeof(snap->effects));
+    snap->scratch_used     = sim->scratch.last_used;
+    snap->scratch_peak     = sim->scratch.high_water;
+    snap->scratch_capacity = sim->scratch.capacity;
+    snap->rewind_paused    = sim->rewind.paused;
+    snap->rewind_frames    = sim->rewind.count;
+    snap->rewind_cursor    = sim->rewind.cursor;
+    snap->rewind_bytes     = sim->rewind.bytes;
+    snap->rewind_record_ms = sim->rewind.record_ms;
+    snap->crowd            = sim->crowd.stats;
+    snap->combat_events    = sim->combat.resolved;
+    snap->combat_dropped   = sim->combat.dropped;
+
+    if(sim->game_state == GS_RUNNING) {
+        Room* room = sim->current_room;
+        snap->player = sim->player;
+        snap->projectile_count = 0;
+        for(int b = 0; b < MAX_PROJECTILES; b++) {
+            if(sim->projectiles.projectiles[b].live) {
+                snap->projectiles[snap->projectile_count++] = sim->projectiles.projectiles[b];
+            }
+        }
+        snap->active_spells       = sim->spells.count + sim->spell_cache.replay_count;
+        snap->spell_instructions  = sim->spell_instructions;
+        snap->spell_pattern_count = sim->spell_cache.pattern_count;
+        memcpy(snap->spell_patterns, sim->spell_cache.patterns, sizeof(Spell_Pattern) * sim->spell_cache.pattern_count);
+
+        snap->mob_count = 0;
+        if(room->m_handler_p->is_initialized) {
+            for(int i = 0; i < room->m_handler_p->local_max_mobs; i++) {
+                if(room->m_handler_p->mobs[i].type != DEFAULT) {
+                    snap->mobs[snap->mob_count++] = room->m_handler_p->mobs[i];
+                }
+            }
+        }
+
+        snap->room = *room;
+        snap->room.m_handler_p = NULL;
+        snap->room_tiles = *room->tiles;
+        snap->room.tiles = &snap->room_tiles;
+        snap->visibility         = sim->visibility.stats;
+        snap->mobs_seeing_player = sim->mobs_seeing_player;
+        snap->floor_number = sim->floor.number;
+        snap->key_found    = sim->floor.key_found;
+        snap->tileset      = sim->floor.tileset;
+        /* The minimap is a window of the floor, kept around the current room */
+        int max_row = (sim->floor.rows > MINIMAP_SIZE)? sim->floor.rows - MINIMAP_SIZE : 0;
+        int max_col = (sim->floor.cols > MINIMAP_SIZE)? sim->floor.cols - MINIMAP_SIZE : 0;
+        snap->minimap_row = constrain(0, max_row, room->row_pos - MINIMAP_SIZE/2);
+        snap->minimap_col = constrain(0, max_col, room->col_pos - MINIMAP_SIZE/2);
+        for(int i = 0; i < MINIMAP_SIZE; i++) {
+            for(int j = 0; j < MINIMAP_SIZE; j++) {
+                Room* cell = floor_room(&sim->floor, snap->minimap_row + i, snap->minimap_col + j);
+                snap->minimap[i][j].is_initialized = cell && cell->is_initialized;
+                snap->minimap[i][j].is_loaded      = cell && cell->is_loaded;
+                snap->minimap[i][j].type           = cell ? cell->type : R_DEFAULT;
+            }
+        }
+    }
+
+    triple_buffer_publish(&sim->snapshots);
+}
@@ -0,0 +1,54 @@
+#include <string.h>
+
+#include "snapshot.h"
+
+/* Set on the middle slot when it holds a snapshot the reader has not seen */
+#define SNAPSHOT_FRESH 4
+#define SNAPSHOT_INDEX 3
+
+void triple_buffer_initialize(Triple_Buffer* tb) {
+    memset(tb, 0, sizeof(Triple_Buffer));
+    for(int i = 0; i < 3; i++) {
+        tb->buffers[i].game_state = GS_MENU;
+        tb->buffers[i].tileset    = SPR_NONE;
+    }
+    tb->back   = 0;
+    tb->middle = 1;
+    tb->front  = 2;
+}
+
+/*
+* Writer side: the buffer to fill for the next publish.
+*/
+Snapshot* triple_buffer_back(Triple_Buffer* tb) {
+    return &tb->buffers[tb->back];
+}
+
+/*
+* Writer side: hand the back buffer over and take whatever was in the middle.
+* Never blocks, an unread snapshot in the middle is simply replaced.
+*/
+void triple_buffer_publish(Triple_Buffer* tb) {
+    int old_middle = __atomic_exchange_n(&tb->middle, tb->back | SNAPSHOT_FRESH, __ATOMIC_ACQ_REL);
+    tb->back = old_middle & SNAPSHOT_INDEX;
+}
+
+/*
+* Reader side: swap in the newest snapshot if one was published since the last
+* call. Returns false (and keeps the current front) otherwise.
+*/
+bool triple_buffer_consume(Triple_Buffer* tb) {
+    if(!(__atomic_load_n(&tb->middle, __ATOMIC_ACQUIRE) & SNAPSHOT_FRESH)) {
+        return false;
+    }
+    int old_middle = __atomic_exchange_n(&tb->middle, tb->front, __ATOMIC_ACQ_REL);
+    tb->front = old_middle & SNAPSHOT_INDEX;
+    return true;
+}
+
+/*
+* Reader side: the snapshot currently being rendered.
+*/
+Snapshot* triple_buffer_front(Triple_Buffer* tb) {
+    return &tb->buffers[tb->front];
+}
@@ -0,0 +1,364 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+/* Local Includes */
+#include "spell.h"
+#include "global.h"
+#include "mem_track.h"
+
+#define SPELL_MAX_SOURCE  16384
+#define SPELL_MAX_LINE    128
+#define DEG_TO_RAD        0.017453292519943295f
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static const char* register_names[] = {"angle", "speed", "damage", "size", "a", "b", "c", "d"};
+
+static int register_index(const char* name) {
+    for(int r = 0; r < R_LOOP; r++) {
+        if(strcmp(name, register_names[r]) == 0) return r;
+    }
+    return -1;
+}
+
+static bool parse_number(const char* token, float* out) {
+    char* end;
+    *out = strtof(token, &end);
+    return end != token && *end == '\0';
+}
+
+static int compile_error(char* error, int error_size, int line, const char* fmt, ...) {
+    if(error && error_size > 0) {
+        int n = snprintf(error, error_size, "line %d: ", line);
+        va_list args;
+        va_start(args, fmt);
+        if(n >= 0 && n < error_size) vsnprintf(error + n, error_size - n, fmt, args);
+        va_end(args);
+    }
+    return ERROR;
+}
+
+static bool emit_instr(Spell_Program* out, Spell_Op op, int a, int b, float imm) {
+    /* Always leave room for the closing halt */
+    if(out->length >= SPELL_MAX_CODE - 1) {
+        return false;
+    }
+    Spell_Instr* in = &out->code[out->length++];
+    in->op  = op;
+    in->a   = a;
+    in->b   = b;
+    in->imm = imm;
+    return true;
+}
+
+/*
+* Run one spell until it waits, halts or uses up its budget for this tick.
+* Returns true once the spell has finished.
+*/
+static bool run_instance(Spell_Instance* s, Spell_Emitter emit, void* ctx, int* executed) {
+    if(s->wait > 0 && --s->wait > 0) {
+        return false;
+    }
+    const Spell_Instr* code = s->program->code;
+    for(int budget = SPELL_TICK_BUDGET; budget > 0; budget--) {
+        const Spell_Instr* in = &code[s->pc++];
+        (*executed)++;
+        switch(in->op) {
+            case OP_HALT:
+                return true;
+            case OP_SET:
+                s->reg[in->a] = in->imm;
+                break;
+            case OP_ADD:
+                s->reg[in->a] += in->imm;
+                break;
+            case OP_MUL:
+                s->reg[in->a] *= in->imm;
+                break;
+            case OP_MOV:
+                s->reg[in->a] = s->reg[in->b];
+                break;
+            case OP_ADDR:
+                s->reg[in->a] += s->reg[in->b];
+                break;
+            case OP_FIRE: {
+                float angle = s->aim + s->reg[R_ANGLE] * DEG_TO_RAD;
+                Spell_Emit e = {
+                    .x      = s->x,
+                    .y      = s->y,
+                    .vx     = s->reg[R_SPEED] * cosf(angle),
+                    .vy     = s->reg[R_SPEED] * sinf(angle),
+                    .damage = s->reg[R_DAMAGE],
+                    .size   = s->reg[R_SIZE]
+                };
+                if(emit) emit(&e, ctx);
+                break;
+            }
+            case OP_WAIT:
+                s->wait = in->imm;
+                return false;
+            case OP_DJNZ:
+                if(--s->reg[in->a] > 0) s->pc = in->b;
+                break;
+            default:
+                return true;
+        }
+    }
+    return false;
+}
+
+/* Registers a spell starts with, fire works without setting anything */
+static void reset_registers(float reg[SPELL_REGISTERS]) {
+    memset(reg, 0, sizeof(float) * SPELL_REGISTERS);
+    reg[R_SPEED]  = 10;
+    reg[R_DAMAGE] = 10;
+    reg[R_SIZE]   = 5;
+}
+
+static uint32_t hash_program(const Spell_Program* program) {
+    uint32_t h = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)program->code;
+    for(size_t i = 0; i < program->length * sizeof(Spell_Instr); i++) {
+        h ^= bytes[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+typedef struct trace_state {
+    Spell_Emit* emits;
+    uint16_t* ticks;
+    int max_emits;
+    int count;
+    int tick;
+} Trace_State;
+
+static void trace_emit(const Spell_Emit* e, void* ctx) {
+    Trace_State* trace = ctx;
+    if(trace->count < trace->max_emits) {
+        trace->emits[trace->count] = *e;
+        trace->ticks[trace->count] = trace->tick;
+    }
+    trace->count++;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Compile spell source into bytecode. The language is one statement per line,
+* '#' starts a comment:
+*
+*   speed = 40          set a register (angle, speed, damage, size, a-d)
+*   damage *= 1.5       also +=, -= and *=, with a number or a register
+*   turn 45             shorthand for angle += 45
+*   fire                launch a projectile from the fire registers
+*   wait 3              sleep for 3 ticks
+*   repeat 8 ... end    run the block 8 times, nesting up to 4 deep
+*
+* On failure the reason is written to error and ERROR is returned.
+*/
+int spell_compile(const char* source, const char* name, Spell_Program* out, char* error, int error_size) {
+    memset(out, 0, sizeof(Spell_Program));
+    snprintf(out->name, SPELL_NAME_SIZE, "%s", name);
+
+    int loop_start[SPELL_MAX_NESTING];
+    int depth = 0;
+    int line_no = 0;
+    const char* p = source;
+
+    while(*p) {
+        char line[SPELL_MAX_LINE];
+        int len = strcspn(p, "\n");
+        snprintf(line, sizeof(line), "%.*s", len, p);
+        p += len + (p[len] == '\n');
+        line_no++;
+
+        char* comment = strchr(line, '#');
+        if(comment) *comment = '\0';
+
+        char* tok[4];
+        int ntok = 0;
+        char* save;
+        for(char* t = strtok_r(line, " \t\r", &save); t && ntok < 4; t = strtok_r(NULL, " \t\r", &save)) {
+            tok[ntok++] = t;
+        }
+        if(ntok == 0) continue;
+
+        bool ok = true;
+        float value;
+        if(strcmp(tok[0], "fire") == 0 && ntok == 1) {
+            ok = emit_instr(out, OP_FIRE, 0, 0, 0);
+        }
+        else if(strcmp(tok[0], "wait") == 0 && ntok == 2) {
+            if(!parse_number(tok[1], &value) || value < 0 || value > 60000) {
+                return compile_error(error, error_size, line_no, "wait needs a tick count");
+            }
+            ok = emit_instr(out, OP_WAIT, 0, 0, (int)value);
+        }
+        else if(strcmp(tok[0], "turn") == 0 && ntok == 2) {
+            if(!parse_number(tok[1], &value)) {
+                return compile_error(error, error_size, line_no, "turn needs an angle in degrees");
+            }
+            ok = emit_instr(out, OP_ADD, R_ANGLE, 0, value);
+        }
+        else if(strcmp(tok[0], "repeat") == 0 && ntok == 2) {
+            if(!parse_number(tok[1], &value) || value < 1 || value > SPELL_MAX_REPEAT) {
+                return compile_error(error, error_size, line_no, "repeat needs a count from 1 to %d", SPELL_MAX_REPEAT);
+            }
+            if(depth >= SPELL_MAX_NESTING) {
+                return compile_error(error, error_size, line_no, "repeat nested more than %d deep", SPELL_MAX_NESTING);
+            }
+            ok = emit_instr(out, OP_SET, R_LOOP + depth, 0, (int)value);
+            loop_start[depth++] = out->length;
+        }
+        else if(strcmp(tok[0], "end") == 0 && ntok == 1) {
+            if(depth == 0) {
+                return compile_error(error, error_size, line_no, "end without repeat");
+            }
+            depth--;
+            ok = emit_instr(out, OP_DJNZ, R_LOOP + depth, loop_start[depth], 0);
+        }
+        else if(ntok == 3 && register_index(tok[0]) >= 0) {
+            int reg = register_index(tok[0]);
+            int src = register_index(tok[2]);
+            bool is_number = parse_number(tok[2], &value);
+            if(!is_number && src < 0) {
+                return compile_error(error, error_size, line_no, "expected a number or register, got '%s'", tok[2]);
+            }
+            if(strcmp(tok[1], "=") == 0) {
+                ok = is_number? emit_instr(out, OP_SET, reg, 0, value) : emit_instr(out, OP_MOV, reg, src, 0);
+            } else if(strcmp(tok[1], "+=") == 0) {
+                ok = is_number? emit_instr(out, OP_ADD, reg, 0, value) : emit_instr(out, OP_ADDR, reg, src, 0);
+            } else if(strcmp(tok[1], "-=") == 0 && is_number) {
+                ok = emit_instr(out, OP_ADD, reg, 0, -value);
+            } else if(strcmp(tok[1], "*=") == 0 && is_number) {
+                ok = emit_instr(out, OP_MUL, reg, 0, value);
+            } else {
+                return compile_error(error, error_size, line_no, "unsupported operator '%s'", tok[1]);
+            }
+        }
+        else {
+            return compile_error(error, error_size, line_no, "unknown statement '%s'", tok[0]);
+        }
+        if(!ok) {
+            return compile_error(error, error_size, line_no, "spell is longer than %d instructions", SPELL_MAX_CODE - 1);
+        }
+    }
+    if(depth != 0) {
+        return compile_error(error, error_size, line_no, "repeat without end");
+    }
+    emit_instr(out, OP_HALT, 0, 0, 0);
+    out->hash = hash_program(out);
+    return OK;
+}
+
+/*
+* Read and compile a spell file, the file name becomes the spell's name.
+*/
+int spell_load(const char* path, Spell_Program* out) {
+    FILE* fp = fopen(path, "r");
+    if(!fp) {
+        return ERROR;
+    }
+    char* source = MEM_ALLOC(MEM_SPELLS, SPELL_MAX_SOURCE);
+    if(!source) {
+        fclose(fp);
+        return ERROR;
+    }
+    size_t size = fread(source, 1, SPELL_MAX_SOURCE - 1, fp);
+    source[size] = '\0';
+    fclose(fp);
+
+    const char* name = strrchr(path, '/');
+    name = name? name + 1 : path;
+    char error[128];
+    int status = spell_compile(source, name, out, error, sizeof(error));
+    if(status != OK) {
+        printf("(spell_load): %s: %s\n", path, error);
+    }
+    mem_free(source);
+    return status;
+}
+
+void spell_vm_initialize(Spell_VM* vm) {
+    vm->count        = 0;
+    vm->instructions = 0;
+}
+
+/*
+* Start a spell at the caster's position, aimed at 'aim' radians. Returns
+* ERROR if every instance slot is busy.
+*/
+int spell_cast(Spell_VM* vm, const Spell_Program* program, float x, float y, float aim) {
+    if(vm->count >= SPELL_MAX_INSTANCES || program->length == 0) {
+        return ERROR;
+    }
+    Spell_Instance* s = &vm->instances[vm->count++];
+    reset_registers(s->reg);
+    s->program = program;
+    s->x       = x;
+    s->y       = y;
+    s->aim     = aim;
+    s->pc      = 0;
+    s->wait    = 0;
+    return OK;
+}
+
+/*
+* Advance every running spell by one tick. Finished spells are swapped out
+* with the last instance. Returns the number of instructions executed.
+*/
+int spell_vm_tick(Spell_VM* vm, Spell_Emitter emit, void* ctx) {
+    int executed = 0;
+    for(int i = 0; i < vm->count;) {
+        if(run_instance(&vm->instances[i], emit, ctx, &executed)) {
+            vm->instances[i] = vm->instances[--vm->count];
+        } else {
+            i++;
+        }
+    }
+    vm->instructions += executed;
+    return executed;
+}
+
+/*
+* Run a spell to completion from the origin, aimed along +x, recording every
+* emission and the tick it happened on. Returns the number of emissions, or
+* ERROR if the spell runs longer than max_ticks or emits more than max_emits.
+*/
+int spell_trace(const Spell_Program* program, int max_ticks, Spell_Emit emits[], uint16_t ticks[], int max_emits, int* duration) {
+    Spell_Instance s;
+    memset(&s, 0, sizeof(Spell_Instance));
+    reset_registers(s.reg);
+    s.program = program;
+
+    Trace_State trace = {
+        .emits     = emits,
+        .ticks     = ticks,
+        .max_emits = max_emits,
+        .count     = 0,
+        .tick      = 0
+    };
+    int executed = 0;
+    for(trace.tick = 0; trace.tick < max_ticks; trace.tick++) {
+        bool done = run_instance(&s, trace_emit, &trace, &executed);
+        if(trace.count > max_emits) {
+            return ERROR;
+        }
+        if(done) {
+            *duration = trace.tick + 1;
+            return trace.count;
+        }
+    }
+    return ERROR;
+}
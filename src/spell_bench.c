@@ -0,0 +1,100 @@
+/*
+* Spell VM benchmark. Keeps the instance pool full of a few representative
+* spells and reports interpreter throughput and per-spell cost.
+*
+* usage: spell_bench [instances] [ticks]
+*/
+/* Standard Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Local Includes */
+#include "spell.h"
+#include "spell_cache.h"
+#include "global.h"
+
+static const char* bench_sources[] = {
+    "speed = 50\ndamage = 10\nfire\n",
+    "speed = 20\nrepeat 8\n  fire\n  turn 45\nend\n",
+    "speed = 15\nrepeat 36\n  fire\n  turn 10\n  speed += 0.5\n  wait 1\nend\n",
+    "damage = 5\nrepeat 4\n  repeat 5\n    fire\n    turn 3\n  end\n  damage *= 1.5\n  wait 2\nend\n"
+};
+#define BENCH_SPELLS (int)(sizeof(bench_sources) / sizeof(bench_sources[0]))
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void count_emit(const Spell_Emit* e, void* ctx) {
+    (*(long long*)ctx)++;
+}
+
+int main(int argc, char** argv) {
+    int instances = (argc > 1)? atoi(argv[1]) : SPELL_MAX_INSTANCES;
+    int ticks     = (argc > 2)? atoi(argv[2]) : 10000;
+    instances = constrain(1, SPELL_MAX_INSTANCES, instances);
+
+    static Spell_Program programs[BENCH_SPELLS];
+    for(int i = 0; i < BENCH_SPELLS; i++) {
+        char name[16], error[128];
+        snprintf(name, sizeof(name), "bench%d", i);
+        if(spell_compile(bench_sources[i], name, &programs[i], error, sizeof(error)) != OK) {
+            printf("(main): %s: %s\n", name, error);
+            return ERROR;
+        }
+    }
+
+    static Spell_VM vm;
+    spell_vm_initialize(&vm);
+    long long emitted = 0;
+    long long casts = 0;
+    long long instance_ticks = 0;
+
+    double start = now_seconds();
+    for(int t = 0; t < ticks; t++) {
+        /* Recast finished spells so the pool stays full */
+        while(vm.count < instances) {
+            spell_cast(&vm, &programs[casts % BENCH_SPELLS], 0, 0, 0);
+            casts++;
+        }
+        instance_ticks += vm.count;
+        spell_vm_tick(&vm, count_emit, &emitted);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%d instances, %d ticks, %.3f s\n", instances, ticks, elapsed);
+    printf("  instructions:   %lld (%.1f M/s, %.2f ns each)\n", (long long)vm.instructions,
+           vm.instructions / elapsed / 1e6, elapsed * 1e9 / vm.instructions);
+    printf("  spells cast:    %lld (%.2f us each, start to finish)\n", casts, elapsed * 1e6 / casts);
+    printf("  per tick:       %.3f ms for a full pool (%.1f ns per running spell)\n",
+           elapsed * 1e3 / ticks, elapsed * 1e9 / instance_ticks);
+    printf("  projectiles:    %lld emitted\n", emitted);
+
+    /* Same workload replayed from precompiled tables */
+    static Spell_Cache cache;
+    spell_cache_initialize(&cache);
+    Spell_Pattern* patterns[BENCH_SPELLS];
+    for(int i = 0; i < BENCH_SPELLS; i++) {
+        patterns[i] = spell_cache_lookup(&cache, &programs[i]);
+    }
+    long long replay_emitted = 0;
+    long long replay_casts = 0;
+    int replays = constrain(1, SPELL_MAX_REPLAYS, instances);
+
+    start = now_seconds();
+    for(int t = 0; t < ticks; t++) {
+        while(cache.replay_count < replays) {
+            spell_cache_cast(&cache, patterns[replay_casts % BENCH_SPELLS], 0, 0, 1, 0);
+            replay_casts++;
+        }
+        spell_cache_tick(&cache, count_emit, &replay_emitted);
+    }
+    elapsed = now_seconds() - start;
+    printf("precompiled replay, %d instances, %d ticks, %.3f s\n", replays, ticks, elapsed);
+    printf("  spells cast:    %lld (%.2f us each, start to finish)\n", replay_casts, elapsed * 1e6 / replay_casts);
+    printf("  projectiles:    %lld emitted (%.2f ns each)\n", replay_emitted, elapsed * 1e9 / replay_emitted);
+    return OK;
+}
@@ -0,0 +1,139 @@
+/* Standard Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Local Includes */
+#include "spell_cache.h"
+#include "global.h"
+#include "log.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/*
+* Flatten a spell into the emission table. Every spell is deterministic given
+* its caster position and aim, so this only fails for spells that run too long,
+* emit too much, or do not fit in the remaining table.
+*/
+static bool precompile(Spell_Cache* cache, Spell_Pattern* pattern, const Spell_Program* program) {
+    Spell_Emit* emits = cache->trace_emits;
+    uint16_t* ticks   = cache->trace_ticks;
+    int duration = 0;
+    int count = spell_trace(program, SPELL_PATTERN_MAX_TICKS, emits, ticks, SPELL_PATTERN_MAX_EMITS, &duration);
+    if(count < 0 || cache->emission_count + count > SPELL_CACHE_EMISSIONS) {
+        return false;
+    }
+
+    pattern->first    = cache->emission_count;
+    pattern->count    = count;
+    pattern->duration = duration;
+    for(int i = 0; i < count; i++) {
+        Spell_Emission* e = &cache->emissions[cache->emission_count++];
+        e->tick     = ticks[i];
+        e->offset_x = emits[i].x;
+        e->offset_y = emits[i].y;
+        e->vx       = emits[i].vx;
+        e->vy       = emits[i].vy;
+        e->damage   = emits[i].damage;
+        e->size     = emits[i].size;
+    }
+    return true;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void spell_cache_initialize(Spell_Cache* cache) {
+    cache->pattern_count  = 0;
+    cache->emission_count = 0;
+    cache->replay_count   = 0;
+}
+
+/*
+* Find the cache entry for a spell by its bytecode, precompiling it the first
+* time it is seen. The hash only picks candidates, a hit also needs the same
+* instructions so two spells that collide never share an entry. Call this when
+* a spell is authored or loaded so the work is done before the first cast.
+* Returns NULL only when the cache is full.
+*/
+Spell_Pattern* spell_cache_lookup(Spell_Cache* cache, const Spell_Program* program) {
+    for(int i = 0; i < cache->pattern_count; i++) {
+        Spell_Pattern* pattern = &cache->patterns[i];
+        if(pattern->hash == program->hash && pattern->length == program->length &&
+           memcmp(cache->codes[i], program->code, sizeof(Spell_Instr) * program->length) == 0) {
+            return pattern;
+        }
+    }
+    if(cache->pattern_count >= SPELL_CACHE_SIZE) {
+        return NULL;
+    }
+    int slot = cache->pattern_count++;
+    Spell_Pattern* pattern = &cache->patterns[slot];
+    memset(pattern, 0, sizeof(Spell_Pattern));
+    pattern->hash   = program->hash;
+    pattern->length = program->length;
+    memcpy(cache->codes[slot], program->code, sizeof(Spell_Instr) * program->length);
+    snprintf(pattern->name, SPELL_NAME_SIZE, "%s", program->name);
+    pattern->is_pattern = precompile(cache, pattern, program);
+    if(!pattern->is_pattern) {
+        LOG_INFO("%s can't be precompiled, it will be interpreted.", program->name);
+    }
+    return pattern;
+}
+
+/*
+* Start replaying a precompiled pattern. dir_x, dir_y is the unit aim vector.
+*/
+int spell_cache_cast(Spell_Cache* cache, Spell_Pattern* pattern, float x, float y, float dir_x, float dir_y) {
+    if(!pattern->is_pattern || cache->replay_count >= SPELL_MAX_REPLAYS) {
+        return ERROR;
+    }
+    Spell_Replay* r = &cache->replays[cache->replay_count++];
+    r->pattern = pattern;
+    r->x       = x;
+    r->y       = y;
+    r->dir_x   = dir_x;
+    r->dir_y   = dir_y;
+    r->tick    = 0;
+    r->next    = 0;
+    pattern->casts++;
+    return OK;
+}
+
+/*
+* Play this tick's emissions of every running pattern, rotated onto each
+* caster's aim. Returns the number of emissions.
+*/
+int spell_cache_tick(Spell_Cache* cache, Spell_Emitter emit, void* ctx) {
+    int emitted = 0;
+    for(int i = 0; i < cache->replay_count;) {
+        Spell_Replay* r = &cache->replays[i];
+        const Spell_Pattern* pattern = r->pattern;
+        const Spell_Emission* table = &cache->emissions[pattern->first];
+
+        while(r->next < pattern->count && table[r->next].tick == r->tick) {
+            const Spell_Emission* e = &table[r->next++];
+            Spell_Emit out = {
+                .x      = r->x + e->offset_x * r->dir_x - e->offset_y * r->dir_y,
+                .y      = r->y + e->offset_x * r->dir_y + e->offset_y * r->dir_x,
+                .vx     = e->vx * r->dir_x - e->vy * r->dir_y,
+                .vy     = e->vx * r->dir_y + e->vy * r->dir_x,
+                .damage = e->damage,
+                .size   = e->size
+            };
+            if(emit) emit(&out, ctx);
+            emitted++;
+        }
+        r->tick++;
+        if(r->next >= pattern->count) {
+            cache->replays[i] = cache->replays[--cache->replay_count];
+        } else {
+            i++;
+        }
+    }
+    return emitted;
+}
@@ -1,5 +1,6 @@
 /* Standard Libraries */
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
@@ -11,9 +12,14 @@
 #include <allegro5/allegro_primitives.h>    /* Allegro Primatives library */
 
 #include "terrain.h"
+#include "game_context.h"
 #include "random.h"
+#include "log.h"
+#include "mem_track.h"
 
 #define MIN_SUBGRAPH_SIZE 2
+#define BSP_STACK_SIZE    128   /* each level halves a side, so depth stays tiny */
+#define PRINT_FLOOR_MAX_COLS 32
 
 Room default_room() {
   Room room = {
@@ -22,8 +28,8 @@ Room default_room() {
     .row_pos            = -1,                   /* row position */
     .col_pos            = -1,                   /* column position */
     .id                 = {""},                 /* id string */
-    .texture_map        = {{0}},                /* texture map */
-    .door               = NULL,                 /* ALLEGRO_BITMAP* door */
+    .tile_seed          = 0,                    /* texture map seed */
+    .start_distance     = -1,                   /* doorways from the start room */
     .type               = R_DEFAULT,            /* room type */
     .is_initialized     = false,                /* is_initialized */
     .is_loaded          = false,                /* is_loaded */
@@ -34,29 +40,112 @@ Room default_room() {
     .south_door         = default_hitbox(),     /* south_door hitbox */
     .east_door          = default_hitbox(),     /* east_door hitbox */
     .west_door          = default_hitbox(),     /* west_door hitbox */
-    .m_handler_p        = NULL                  /* mob handler pointer */
+    .m_handler_p        = NULL,                 /* mob handler pointer */
+    .tiles              = NULL                  /* tiles, only while loaded */
   };
   return room;
 }
+/* One pending subgraph of the BSP, kept on an explicit stack */
+typedef struct bsp_frame {
+  int start_row, end_row, start_col, end_col;
+  int stage;            /* 0: not split, 1: first half done, 2: both halves done */
+  bool vertical_splice;
+  int r1_row, r1_col;   /* room returned by the first half */
+} Bsp_Frame;
+
+/* Constraints for handing out one special room type */
+typedef struct placement_rule {
+  Room_Type type;
+  int amount;
+  int min_distance;         /* doorways from the start room */
+  Room_Type not_next_to;    /* R_DEFAULT for no restriction */
+} Placement_Rule;
+
 /*
  *******************************************************************************
- * Internally Visible Variables
+ * Internally Visible Functions
  *******************************************************************************
 */
-Mob_Handler current_mh;
+static uint32_t tile_rng_next(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
 
 /*
- *******************************************************************************
- * Internally Visible Functions
- *******************************************************************************
+* Build the texture map and solidity of a room from its seed. The same seed
+* always gives the same floor tiles, so a room looks the same every time it is
+* loaded.
 */
-Room generate_room(int row_pos, int col_pos, Room_Type type) {
+static void build_room_tiles(Room* r, Room_Tiles* tiles) {
+  /* TODO: smarter algorithm for generating different size/shaped rooms. */
+  uint32_t rng_state = r->tile_seed ? r->tile_seed : 1;
+  int selected_texture = 0;
+  for(int i = 0; i < MAX_ROOM_WIDTH_IDX; i++) {
+    for(int j = 0; j < MAX_ROOM_HEIGHT_IDX; j++) {
+      if (i == 0) {
+        switch(j) {
+          case 0:
+            selected_texture = 8;
+            break;
+          case MAX_ROOM_HEIGHT_IDX-1:
+            selected_texture = 10;
+            break;
+          default:
+            selected_texture = 4;
+            break;
+        }
+      } else if (i == MAX_ROOM_WIDTH_IDX-1) {
+        switch(j) {
+          case 0:
+            selected_texture = 9;
+            break;
+          case MAX_ROOM_HEIGHT_IDX-1:
+            selected_texture = 11;
+            break;
+          default:
+            selected_texture = 5;
+            break;
+        }
+      } else if (j == 0) {
+        selected_texture = 6;
+      } else if (j == MAX_ROOM_HEIGHT_IDX-1) {
+        selected_texture = 7;
+      } else {
+        /* 75% plain floor, otherwise one of the three decorated tiles */
+        uint32_t roll = tile_rng_next(&rng_state);
+        selected_texture = (roll % 100 < 75)? 3 : (int)((roll >> 8) % 3);
+      }
+
+      tiles->texture_map[i][j] = selected_texture;
+    }
+  }
+
+  /* Wall tiles are solid, except where a doorway is cut through */
+  solid_map_initialize(&tiles->solidity, MAX_ROOM_WIDTH_IDX, MAX_ROOM_HEIGHT_IDX, PX_PER_TILE);
+  for(int i = 0; i < MAX_ROOM_WIDTH_IDX; i++) {
+    for(int j = 0; j < MAX_ROOM_HEIGHT_IDX; j++) {
+      solid_map_set(&tiles->solidity, i, j, tiles->texture_map[i][j] >= FIRST_WALL_TEXTURE);
+    }
+  }
+  if(r->room_configuration[0] == 1) solid_map_clear_box(&tiles->solidity, &r->north_door);
+  if(r->room_configuration[1] == 1) solid_map_clear_box(&tiles->solidity, &r->south_door);
+  if(r->room_configuration[2] == 1) solid_map_clear_box(&tiles->solidity, &r->east_door);
+  if(r->room_configuration[3] == 1) solid_map_clear_box(&tiles->solidity, &r->west_door);
+  tiles->generation++;
+}
+
+Room generate_room(Game_Context* game, int row_pos, int col_pos, Room_Type type) {
     Room r = {
       .width          = 1280, //SCREEN_WIDTH,
       .height         = 960, //SCREEN_HEIGHT,
       .row_pos        = row_pos,
       .col_pos        = col_pos,
-      .door           = NULL,
+      .tile_seed      = (uint32_t)rng_random_int(&game->rng, 1, INT32_MAX),
+      .start_distance = -1,
       .type           = type,
       .is_initialized = true,
       .is_loaded      = false,
@@ -65,256 +154,357 @@ Room generate_room(int row_pos, int col_pos, Room_Type type) {
       .north_door     = default_hitbox(),
       .south_door     = default_hitbox(),
       .east_door      = default_hitbox(),
-      .west_door      = default_hitbox()
+      .west_door      = default_hitbox(),
+      .tiles          = NULL
     };
-
-    /* Generate Texture Map */
-    /* TODO: smarter algorithm for generating different size/shaped rooms. */
-    int selected_texture = 0;
-    for(int i = 0; i < MAX_ROOM_WIDTH_IDX; i++) {
-      for(int j = 0; j < MAX_ROOM_HEIGHT_IDX; j++) {
-        if (i == 0) {
-          switch(j) {
-            case 0:
-              selected_texture = 8;
-              break;
-            case MAX_ROOM_HEIGHT_IDX-1:
-              selected_texture = 10;
-              break;
-            default:
-              selected_texture = 4;
-              break;
-          }
-        } else if (i == MAX_ROOM_WIDTH_IDX-1) {
-          switch(j) {
-            case 0:
-              selected_texture = 9;
-              break;
-            case MAX_ROOM_HEIGHT_IDX-1:
-              selected_texture = 11;
-              break;
-            default:
-              selected_texture = 5;
-              break;
-          }
-        } else if (j == 0) {
-          selected_texture = 6;
-        } else if (j == MAX_ROOM_HEIGHT_IDX-1) {
-          selected_texture = 7;
-        } else {
-          selected_texture = rng_percent_chance(0.75)? 3 : rng_random_int(0,2);
-        }
-
-        r.texture_map[i][j] = selected_texture;
-      }
-    }
     /*
      * because there can only be one active mob handler anyways, we will
-     * use a reference to the statically allocated one, which will be reused.
+     * use a reference to the game's one, which will be reused.
     */
-    current_mh = default_mob_handler();
-    r.m_handler_p = &current_mh;
-    /* generate id as row-col, always set to be 3 chars on each side of the dash */
+    r.m_handler_p = &game->mobs;
+    /* generate id as row-col, always at least 3 chars on each side of the dash */
     snprintf(r.id, ID_SIZE, "%03d-%03d", r.row_pos, r.col_pos);
 
     return r;
 }
 
-void link_rooms(Room map[MAX_ROWS][MAX_COLS]) {
-  for(int i = 0; i < MAX_ROWS; ++i) {
-    for(int j = 0; j < MAX_COLS; ++j) {
-      /* Verify room is initialized before trying to create doorways */
-      if(map[i][j].is_initialized) {
-        int room_width  = map[i][j].width;
-        int room_height = map[i][j].height;
+/*
+* Room at a floor position, allocating its chunk on first touch. Returns NULL
+* if the position is off the floor or the chunk couldn't be allocated.
+*/
+static Room* floor_touch_room(Floor* f, int row, int col) {
+  if(row < 0 || col < 0 || row >= f->rows || col >= f->cols) {
+    return NULL;
+  }
+  Floor_Chunk** chunk = &f->chunks[(row >> FLOOR_CHUNK_SHIFT) * f->chunk_cols + (col >> FLOOR_CHUNK_SHIFT)];
+  if(!*chunk) {
+    *chunk = MEM_ALLOC(MEM_TERRAIN, sizeof(Floor_Chunk));
+    if(!*chunk) {
+      LOG_ERROR("couldn't allocate chunk for room %d-%d.", row, col);
+      return NULL;
+    }
+    for(int i = 0; i < FLOOR_CHUNK_SIZE; i++) {
+      for(int j = 0; j < FLOOR_CHUNK_SIZE; j++) {
+        (*chunk)->rooms[i][j] = default_room();
+      }
+    }
+    f->chunk_count++;
+  }
+  return &(*chunk)->rooms[row & FLOOR_CHUNK_MASK][col & FLOOR_CHUNK_MASK];
+}
+
+static bool room_exists(Floor* f, int row, int col) {
+  Room* r = floor_room(f, row, col);
+  return r && r->is_initialized;
+}
+
+/*
+* Generate a room at a position unless one is already there, either way
+* returning the room now at that position.
+*/
+static Room* place_room(Floor* f, Game_Context* game, int row, int col, Room_Type type) {
+  Room* r = floor_touch_room(f, row, col);
+  if(r && !r->is_initialized) {
+    *r = generate_room(game, row, col, type);
+    f->room_count++;
+  }
+  return r;
+}
+
+void link_rooms(Floor* f) {
+  /* Only allocated chunks can hold rooms */
+  for(int c = 0; c < f->chunk_rows * f->chunk_cols; c++) {
+    Floor_Chunk* chunk = f->chunks[c];
+    if(!chunk) continue;
+    for(int ci = 0; ci < FLOOR_CHUNK_SIZE; ++ci) {
+      for(int cj = 0; cj < FLOOR_CHUNK_SIZE; ++cj) {
+        Room* r = &chunk->rooms[ci][cj];
+        /* Verify room is initialized before trying to create doorways */
+        if(!r->is_initialized) continue;
+        int i = r->row_pos;
+        int j = r->col_pos;
+        int room_width  = r->width;
+        int room_height = r->height;
         /* North */
-        if(i > 0) {
-          if(map[i-1][j].is_initialized) {
-            //printf("found north room.\n");
-            create_hitbox(&map[i][j].north_door, room_width/2 - DOOR_HEIGHT/2, 0, DOOR_HEIGHT, DOOR_WIDTH);
-            map[i][j].room_configuration[0] = 1;
-          }
+        if(room_exists(f, i-1, j)) {
+          create_hitbox(&r->north_door, room_width/2 - DOOR_HEIGHT/2, 0, DOOR_HEIGHT, DOOR_WIDTH);
+          r->room_configuration[0] = 1;
         }
         /* South */
-        if(i < MAX_ROWS-1) {
-          if(map[i+1][j].is_initialized) {
-            //printf("found south room.\n");
-            create_hitbox(&map[i][j].south_door, room_width/2 - DOOR_HEIGHT/2, room_height - DOOR_WIDTH, DOOR_HEIGHT, DOOR_WIDTH);
-            map[i][j].room_configuration[1] = 1;
-          }
+        if(room_exists(f, i+1, j)) {
+          create_hitbox(&r->south_door, room_width/2 - DOOR_HEIGHT/2, room_height - DOOR_WIDTH, DOOR_HEIGHT, DOOR_WIDTH);
+          r->room_configuration[1] = 1;
         }
         /* East */
-        if(j < MAX_COLS-1) {
-          if(map[i][j+1].is_initialized) {
-            //printf("found east room.\n");
-            create_hitbox(&map[i][j].east_door, room_width - DOOR_WIDTH, room_height/2 - DOOR_HEIGHT/2, DOOR_WIDTH, DOOR_HEIGHT);
-            map[i][j].room_configuration[2] = 1;
-          }
+        if(room_exists(f, i, j+1)) {
+          create_hitbox(&r->east_door, room_width - DOOR_WIDTH, room_height/2 - DOOR_HEIGHT/2, DOOR_WIDTH, DOOR_HEIGHT);
+          r->room_configuration[2] = 1;
         }
         /* West */
-        if(j > 0) {
-          if(map[i][j-1].is_initialized) {
-            //printf("found west room.\n");
-            create_hitbox(&map[i][j].west_door, 0, room_height/2 - DOOR_HEIGHT/2, DOOR_WIDTH, DOOR_HEIGHT);
-            map[i][j].room_configuration[3] = 1;
-          }
+        if(room_exists(f, i, j-1)) {
+          create_hitbox(&r->west_door, 0, room_height/2 - DOOR_HEIGHT/2, DOOR_WIDTH, DOOR_HEIGHT);
+          r->room_configuration[3] = 1;
         }
       }
     }
   }
 }
 
-int generate_path_between_rooms(Room map[MAX_ROWS][MAX_COLS], int r1, int c1, int r2, int c2) {
-  if(!map[r1][c1].is_initialized && !map[r2][c2].is_initialized) {
+int generate_path_between_rooms(Floor* f, Game_Context* game, int r1, int c1, int r2, int c2) {
+  if(!room_exists(f, r1, c1) && !room_exists(f, r2, c2)) {
     return ERROR;
   }
   int current_row = r1;
   int current_col = c1;
+  int row_step = (r2 > r1)? 1 : -1;
+  int col_step = (c2 > c1)? 1 : -1;
 
-  /* Start with a 50% chance to move in the x or y direction to try to avoid row/col bias */
-  double chance = 0.5;
+  /*
+  * Every step moves one room closer, so carving is linear in the path length.
+  * While both directions are left, pick one at random to avoid row/col bias,
+  * then walk the other one straight.
+  */
   while((current_row != r2) || (current_col != c2)) {
-    if(rng_percent_chance(chance) && current_row != r2) {
-      /* Handle Row first */
-      if(current_row < r2) current_row+=1;
-      else if(current_row > r2) current_row-=1;
-
-      /* Generate room if it is not already initialized */
-      if(!map[current_row][current_col].is_initialized) {
-        map[current_row][current_col] = generate_room(current_row, current_col, R_HALLWAY);
-      }
+    if(current_col == c2 || (current_row != r2 && rng_percent_chance(&game->rng, 0.5))) {
+      current_row += row_step;
     }
-    else if(current_col != c2) {
-      /* Handle Column next */
-      if(current_col < c2) current_col+=1;
-      else if(current_col > c2) current_col-=1;
-
-      /* Generate room if it is not already initialized */
-      if(!map[current_row][current_col].is_initialized) {
-        map[current_row][current_col] = generate_room(current_row, current_col, R_HALLWAY);
-      }
-      /* Set Chance to be 100% as to not waste loops. */
-      if(current_col == c2) chance = 1;
+    else {
+      current_col += col_step;
     }
+    place_room(f, game, current_row, current_col, R_HALLWAY);
   }
   return OK;
 }
 
-Room bsp_step(Room map[MAX_ROWS][MAX_COLS],
-              int init_row_pos,
-              int init_col_pos,
-              int start_row,
-              int end_row,
-              int start_col,
-              int end_col) {
+void bsp_generate(Floor* f,
+                  Game_Context* game,
+                  int init_row_pos,
+                  int init_col_pos,
+                  int start_row,
+                  int end_row,
+                  int start_col,
+                  int end_col) {
   /*
   * Here are the steps to the Binary Space Partitioning (BSP) algorithm:
   * 1. check if we are in exit condition
   *   -> if so, return a generated room within the range.
   * 2. else decide wether to split the map vertically or horizontally
-  *   -> split current map sections, and call bsp_step on each subgraph.
+  *   -> split current map sections, and run the BSP on each subgraph.
   *     -> This should (eventually) return rooms R1 and R2
   *   -> create path between the R1 and R2
   *   -> return either R1 or R2 (for future linking)
+  *
+  * Subgraphs wait on an explicit stack rather than the call stack, and
+  * "returning" a room means leaving its position in out_row/out_col for the
+  * frame below.
   */
+  Bsp_Frame stack[BSP_STACK_SIZE];
+  int top = 0;
+  int out_row = init_row_pos;
+  int out_col = init_col_pos;
+  stack[top++] = (Bsp_Frame){start_row, end_row, start_col, end_col, 0, false, -1, -1};
+
+  while(top > 0) {
+    Bsp_Frame* s = &stack[top-1];
+    Bsp_Frame child;
+
+    switch(s->stage) {
+      case 0:
+        /* Exit condition: if subgraph is <= minimum size, generate a room */
+        if((s->end_row-s->start_row <= MIN_SUBGRAPH_SIZE) ||
+           (s->end_col-s->start_col <= MIN_SUBGRAPH_SIZE) ||
+           top == BSP_STACK_SIZE) {
+          bool is_start_room = false;
+          /* Check if starting position is in subgraph. If so, use that as the generated room */
+          if((init_row_pos >= s->start_row && init_row_pos <= s->end_row) &&
+             (init_col_pos >= s->start_col && init_col_pos <= s->end_col)) {
+            out_row = init_row_pos;
+            out_col = init_col_pos;
+            is_start_room = true;
+          }
+          else {
+            /* Otherwise, generate random position within row/col range */
+            out_row = rng_random_int(&game->rng, s->start_row, s->end_row);
+            out_col = rng_random_int(&game->rng, s->start_col, s->end_col);
+          }
+          Room* r = place_room(f, game, out_row, out_col, R_BASIC);
+          if(r && is_start_room) r->type = R_START;
+          top--;
+          break;
+        }
+        /* Choose to splice the subtree vertically or horizontally, 50% chance either way */
+        /*
+        * TODO: right now each section bisects in half perfectly, it may be intersting to
+        * have a more dynamic system...
+        */
+        s->vertical_splice = rng_percent_chance(&game->rng, 0.5);
+        s->stage = 1;
+        child = *s;
+        child.stage = 0;
+        if(s->vertical_splice) child.end_row = s->start_row + (s->end_row-s->start_row)/2;
+        else                   child.end_col = s->start_col + (s->end_col-s->start_col)/2;
+        stack[top++] = child;
+        break;
+      case 1:
+        s->r1_row = out_row;
+        s->r1_col = out_col;
+        s->stage = 2;
+        child = *s;
+        child.stage = 0;
+        if(s->vertical_splice) child.start_row = s->start_row + (s->end_row-s->start_row)/2 + 1;
+        else                   child.start_col = s->start_col + (s->end_col-s->start_col)/2 + 1;
+        stack[top++] = child;
+        break;
+      default:
+        /* Once the two subgraphs return, create a path between their generated rooms */
+        generate_path_between_rooms(f, game, s->r1_row, s->r1_col, out_row, out_col);
 
-  /* Recursive exit condition: if subgraph is <= minimum size, generate a room and exit */
-  if((end_row-start_row <= MIN_SUBGRAPH_SIZE) || (end_col-start_col <= MIN_SUBGRAPH_SIZE)) {
-    int row_pos, col_pos;
-    bool is_start_room = false;
-    /* Check if starting position is in subgraph. If so, use that as the generated room */
-    if((init_row_pos >= start_row && init_row_pos <= end_row) &&
-       (init_col_pos >= start_col && init_col_pos <= end_col)) {
-      row_pos = init_row_pos;
-      col_pos = init_col_pos;
-      is_start_room = true;
-    }
-    else {
-      /* Otherwise, generate random position within row/col range */
-      row_pos = rng_random_int(start_row, end_row);
-      col_pos = rng_random_int(start_col, end_col);
-    }
-    /* Check if room is initialized, if not, generate new room.*/
-    if(!map[row_pos][col_pos].is_initialized) {
-      Room r = default_room();
-      r = generate_room(row_pos, col_pos, R_BASIC);
-      map[row_pos][col_pos] = r;
+        /* Randomly select one of the 2 connected rooms, and choose that as the output */
+        if(rng_percent_chance(&game->rng, 0.5)) {
+          out_row = s->r1_row;
+          out_col = s->r1_col;
+        }
+        top--;
+        break;
     }
+  }
+}
 
-    if(is_start_room) map[row_pos][col_pos].type = R_START;
-
-    /* Return selected room position, whether it be generated or selected */
-    return map[row_pos][col_pos];
+/*
+* Breadth first search through the doorways from the start room, setting the
+* start_distance of every reachable room. Returns the reachable rooms in visit
+* order, so nearest first, or NULL if the list couldn't be allocated.
+*/
+static Room** rooms_by_distance(Floor* f, Room* start, int* count, int* max_distance) {
+  Room** queue = MEM_ALLOC(MEM_TERRAIN, sizeof(Room*) * (f->room_count + 1));
+  int head = 0, tail = 0;
+  *count = 0;
+  *max_distance = 0;
+  if(!queue) {
+    LOG_ERROR("couldn't allocate room queue.");
+    return NULL;
   }
-  else {
-    bool vertical_splice = rng_percent_chance(0.5);
-    Room r1 = default_room();
-    Room r2 = default_room();
-    Room output = default_room();
-    int bisect_length;
-    /* Choose to splice the subtree vertically or horizontally, 50% chance either way */
-    /*
-    * TODO: right now each section bisects in half perfectly, it may be intersting to
-    * have a more dynamic system...
-    */
-    if(vertical_splice) {
-      bisect_length = floor((end_row-start_row)/2);
-      //bisect_length = rng_random_int(2, (end_row - 2));
-      r1 = bsp_step(map, init_row_pos, init_col_pos, start_row, start_row+bisect_length, start_col, end_col);
-      r2 = bsp_step(map, init_row_pos, init_col_pos, start_row+bisect_length+1, end_row, start_col, end_col);
-    }
-    else {
-      bisect_length = floor((end_col-start_col)/2);
-      //bisect_length = rng_random_int(2, (end_col - 2));
-      r1 = bsp_step(map, init_row_pos, init_col_pos, start_row, end_row, start_col, start_col+bisect_length);
-      r2 = bsp_step(map, init_row_pos, init_col_pos, start_row, end_row, start_col+bisect_length+1, end_col);
-    }
 
-    /* Once the two subgraphs return, create a path between their generated rooms */
-    generate_path_between_rooms(map, r1.row_pos, r1.col_pos, r2.row_pos, r2.col_pos);
+  start->start_distance = 0;
+  queue[tail++] = start;
+  while(head < tail) {
+    Room* r = queue[head++];
+    Room* next[4] = {
+      r->room_configuration[0] ? floor_room(f, r->row_pos-1, r->col_pos) : NULL,
+      r->room_configuration[1] ? floor_room(f, r->row_pos+1, r->col_pos) : NULL,
+      r->room_configuration[2] ? floor_room(f, r->row_pos, r->col_pos+1) : NULL,
+      r->room_configuration[3] ? floor_room(f, r->row_pos, r->col_pos-1) : NULL
+    };
+    for(int d = 0; d < 4; d++) {
+      if(next[d] && next[d]->is_initialized && next[d]->start_distance < 0) {
+        next[d]->start_distance = r->start_distance + 1;
+        queue[tail++] = next[d];
+      }
+    }
+    if(r->start_distance > *max_distance) *max_distance = r->start_distance;
+  }
+  *count = tail;
+  return queue;
+}
 
-    /* Randomly select one of the 2 connected rooms, and choose that as the output */
-    output = rng_percent_chance(0.5)? r1 : r2;
-    return output;
+static bool is_next_to(Floor* f, Room* r, Room_Type type) {
+  Room* next[4] = {
+    floor_room(f, r->row_pos-1, r->col_pos),
+    floor_room(f, r->row_pos+1, r->col_pos),
+    floor_room(f, r->row_pos, r->col_pos+1),
+    floor_room(f, r->row_pos, r->col_pos-1)
+  };
+  for(int d = 0; d < 4; d++) {
+    if(next[d] && next[d]->is_initialized && next[d]->type == type) return true;
   }
+  return false;
 }
 
 /*
-* Randomly distribute a room attribute type across a generated floor.
+* Give rule.type to rule.amount rooms drawn from pool[0, available). Picks are
+* a partial Fisher-Yates shuffle: each draw swaps a random room out of the
+* range still to be drawn from, so every pick is O(1). A room that breaks the
+* rule's constraints stays out of the draw for the rest of the rule (placing
+* more rooms of one type never makes a rejected room acceptable), so each rule
+* looks at every candidate at most once. Placed rooms leave the pool for good,
+* rejected ones go back for the next rule. If nothing meets the constraints
+* the farthest rejected room is used, so a floor always gets its key and exit.
+* Returns how many rooms are left in the pool.
 */
-void distr_attribute(Floor* f, int amount, Room_Type type) {
-  int pos = 0;
-  typedef struct coord{
-    int row;
-    int col;
-  } Coord;
-  Coord available_coords[MAX_ROWS * MAX_COLS] = {{0,0}};
-  int total = 0;
-
-  //Populate list of available (rows/cols)
-  for(int i = 0; i < MAX_ROWS; i++) {
-    for(int j = 0; j < MAX_COLS; j++) {
-        if(f->map[i][j].type == R_BASIC || f->map[i][j].type == R_HALLWAY) {
-          available_coords[total].row = i;
-          available_coords[total].col = j;
-          total++;
+static int place_rooms(Floor* f, Rng* rng, Room** pool, int available, Placement_Rule rule) {
+  /* pool[0, end) is still to be drawn from, pool[end, available) was rejected */
+  int end = available;
+  for(int placed = 0; placed < rule.amount && available > 0; placed++) {
+    int chosen_index = -1;
+    while(end > 0) {
+      int pick = rng_random_int(rng, 0, end-1);
+      Room* r = pool[pick];
+      pool[pick] = pool[end-1];
+      pool[end-1] = r;
+      end--;
+      if(r->start_distance >= rule.min_distance &&
+         (rule.not_next_to == R_DEFAULT || !is_next_to(f, r, rule.not_next_to))) {
+        chosen_index = end;
+        break;
+      }
+    }
+    if(chosen_index < 0) {
+      /* Everything left was rejected, settle for the farthest of it */
+      chosen_index = 0;
+      for(int i = 1; i < available; i++) {
+        if(pool[i]->start_distance > pool[chosen_index]->start_distance) {
+          chosen_index = i;
         }
+      }
     }
-  }
-  /* Loop until all the rooms have been distributed */
-  for(int iter = 0; iter < amount; iter++) {
-    //select which room to distribute
 
-    pos = rng_random_int(0, total-1);
-    f->map[available_coords[pos].row][available_coords[pos].col].type = type;
+    /* The last slot is rejected (or the chosen room), so the split holds */
+    Room* chosen = pool[chosen_index];
+    chosen->type = rule.type;
+    pool[chosen_index] = pool[available-1];
+    pool[available-1] = chosen;
+    available--;
+  }
+  return available;
+}
 
-    for(int i = 0; i < total-2; i++) {
-      if(i >= pos) {
-        available_coords[i] = available_coords[i+1];
-      }
+/*
+* Hand out the special room types once a floor is laid out and linked. One
+* search for distances, then each rule looks at every candidate at most once,
+* so the pass is linear in the number of rooms. Only a rule that no room can
+* meet pays an extra scan of the pool for each fallback room.
+*/
+void place_special_rooms(Floor* f, Game_Context* game, Room* start) {
+  int count, max_distance;
+  Room** rooms = rooms_by_distance(f, start, &count, &max_distance);
+  if(!rooms) return;
+
+  /* Only plain rooms and hallways can be turned into something else */
+  int available = 0;
+  for(int i = 0; i < count; i++) {
+    if(rooms[i]->type == R_BASIC || rooms[i]->type == R_HALLWAY) {
+      rooms[available++] = rooms[i];
     }
-    total-=1;
   }
+
+  /*
+   * ALWAYS generate 1 key and 1 exit per floor. The exit is at least half way
+   * across the floor, and the key can't sit right next to it.
+   * TODO: figure out a better method of calculating how many shops/challenge
+   * rooms to generate, here are some thoughts:
+   *  1. purely based off floor number rand(1, floor_num)
+   *  2. Based off the total number of available rooms on the floor
+   */
+  Placement_Rule rules[] = {
+    {R_EXIT,      1,                                          max_distance/2, R_DEFAULT},
+    {R_KEY,       1,                                          2,              R_EXIT},
+    {R_SHOP,      rng_random_int(&game->rng, 1, f->number+1), 1,              R_DEFAULT},
+    {R_CHALLENGE, rng_random_int(&game->rng, 1, f->number),   1,              R_DEFAULT}
+  };
+  for(int i = 0; i < (int)(sizeof(rules) / sizeof(rules[0])); i++) {
+    available = place_rooms(f, &game->rng, rooms, available, rules[i]);
+  }
+  mem_free(rooms);
 }
 
 /*
@@ -322,14 +512,17 @@ void distr_attribute(Floor* f, int amount, Room_Type type) {
  * Externally Visible Functions
  *******************************************************************************
 */
-int load_room(Room* r) {
+int load_room(Game_Context* game, Room* r) {
   if(r->is_initialized && !r->is_loaded) {
-    /* load in graphics for room */
-    r->door = al_load_bitmap("../assets/door.png");
-    if(!r->door) {
-        printf("(load_room): couldn't load door image.\n");
+    /* Room graphics (tiles and doors) live in the texture atlas */
+    if(!atlas_is_initialized()) {
+        LOG_ERROR("texture atlas is not loaded.");
         return ERROR;
     }
+    /* Tiles are rebuilt from the room's seed into the game's one buffer */
+    build_room_tiles(r, &game->tiles);
+    r->tiles = &game->tiles;
+
     /* Spawn in Mobs and other things based on room type */
 
     switch(r->type) {
@@ -340,119 +533,185 @@ int load_room(Room* r) {
         initialize_handler(r->m_handler_p, 100);
         break;
       default:
-        current_mh = default_mob_handler();
+        game->mobs = default_mob_handler();
         break;
     }
 
     if(r->is_spawnable && r->m_handler_p->is_initialized) {
-      spawn_mobs(r->m_handler_p, r->width, r->height, 1);
+      spawn_mobs(r->m_handler_p, &game->rng, r->width, r->height, 1);
     }
 
     r->is_loaded = true;
     //printf("Loaded Room %s\n", r->id);
     return OK;
   } else {
-      printf("Room %s load error: Initialization Status: %d, Load Status: %d\n", r->id, r->is_initialized, r->is_loaded);
+      LOG_ERROR("room %s load error: Initialization Status: %d, Load Status: %d", r->id, r->is_initialized, r->is_loaded);
     return ERROR;
   }
 }
 
 int unload_room(Room* r) {
   if(r->is_loaded) {
-    al_destroy_bitmap(r->door);
     r->is_loaded = false;
+    r->tiles = NULL;
     return OK;
   } else {
-    printf("Room is not loaded, and cannot be unloaded.\n");
+    LOG_WARN("room %s is not loaded, and cannot be unloaded.", r->id);
     return ERROR;
   }
 }
 
-Room* change_rooms(Room map[MAX_ROWS][MAX_COLS], Room* current_room, Mob* p) {
+Room* change_rooms(Game_Context* game, Floor* f, Room* current_room, Mob* p) {
   /* TODO: implement exception handling via status */
   int status;
   int curr_row = current_room->row_pos;
   int curr_col = current_room->col_pos;
+  Room* north = floor_room(f, curr_row-1, curr_col);
+  Room* south = floor_room(f, curr_row+1, curr_col);
+  Room* east  = floor_room(f, curr_row, curr_col+1);
+  Room* west  = floor_room(f, curr_row, curr_col-1);
 
   /* Check for north door collision */
-  if(is_collision(&p->hb, &current_room->north_door) && map[curr_row-1][curr_col].is_initialized) {
-    status = load_room(&map[curr_row-1][curr_col]);
+  if(is_collision(&p->hb, &current_room->north_door) && north && north->is_initialized) {
+    status = load_room(game, north);
     status = unload_room(current_room);
-    move_mob(p, p->position[0], map[curr_row-1][curr_col].height - PLAYER_HEIGHT - DOOR_WIDTH - 1);
-    return &map[curr_row-1][curr_col];
+    move_mob(p, p->position[0], north->height - PLAYER_HEIGHT - DOOR_WIDTH - 1);
+    return north;
   }
   /* Check for south door collision */
-  else if(is_collision(&p->hb, &current_room->south_door) && map[curr_row+1][curr_col].is_initialized) {
-    status = load_room(&map[curr_row+1][curr_col]);
+  else if(is_collision(&p->hb, &current_room->south_door) && south && south->is_initialized) {
+    status = load_room(game, south);
     status = unload_room(current_room);
     move_mob(p, p->position[0], DOOR_WIDTH + 1);
-    return &map[curr_row+1][curr_col];
+    return south;
   }
   /* Check for east door collision */
-  else if(is_collision(&p->hb, &current_room->east_door) && map[curr_row][curr_col+1].is_initialized) {
-    status = load_room(&map[curr_row][curr_col+1]);
+  else if(is_collision(&p->hb, &current_room->east_door) && east && east->is_initialized) {
+    status = load_room(game, east);
     status = unload_room(current_room);
     move_mob(p, 1 + DOOR_WIDTH, p->position[1]);
-    return &map[curr_row][curr_col+1];
+    return east;
   }
   /* Check for west door collision */
-  else if(is_collision(&p->hb, &current_room->west_door) && map[curr_row][curr_col-1].is_initialized) {
-    status = load_room(&map[curr_row][curr_col-1]);
+  else if(is_collision(&p->hb, &current_room->west_door) && west && west->is_initialized) {
+    status = load_room(game, west);
     status = unload_room(current_room);
-    move_mob(p, map[curr_row][curr_col-1].width-DOOR_WIDTH-PLAYER_WIDTH-1, p->position[1]);
-    return &map[curr_row][curr_col-1];
+    move_mob(p, west->width-DOOR_WIDTH-PLAYER_WIDTH-1, p->position[1]);
+    return west;
   }
   else {
     return current_room;
   }
 }
 
-void generate_floor(Floor* f, int floor_num, int init_row, int init_col) {
-  /* Fill floor map with rooms:
-  *  Current Algorithm is using Binary Space Partitioning with the caveat of a starting square.
-  */
-  for(int i = 0; i < MAX_ROWS; ++i) {
-    for(int j = 0; j < MAX_COLS; ++j) {
-        f->map[i][j] = default_room();
-    }
+/*
+* Rows and columns of a floor, growing with depth so later floors never run
+* out of space.
+*/
+int floor_size(int floor_num) {
+  return FLOOR_BASE_SIZE + 2 * (floor_num - 1);
+}
+
+/*
+* Room at a floor position, or NULL if it is off the floor or in a chunk
+* generation never touched.
+*/
+Room* floor_room(Floor* f, int row, int col) {
+  if(row < 0 || col < 0 || row >= f->rows || col >= f->cols) {
+    return NULL;
   }
+  Floor_Chunk* chunk = f->chunks[(row >> FLOOR_CHUNK_SHIFT) * f->chunk_cols + (col >> FLOOR_CHUNK_SHIFT)];
+  return chunk ? &chunk->rooms[row & FLOOR_CHUNK_MASK][col & FLOOR_CHUNK_MASK] : NULL;
+}
 
-  /* set floor number and floor "size" */
-  f->key_found = false;
-  f->number = floor_num;
+/*
+* Set up an empty rows x cols floor: the header and a chunk table with no
+* chunks in it yet.
+*/
+int create_floor_map(Floor* f, int floor_num, int rows, int cols) {
+  f->key_found   = false;
+  f->number      = floor_num;
+  f->rows        = rows;
+  f->cols        = cols;
+  f->chunk_rows  = (rows + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT;
+  f->chunk_cols  = (cols + FLOOR_CHUNK_MASK) >> FLOOR_CHUNK_SHIFT;
+  f->chunk_count = 0;
+  f->room_count  = 0;
+  f->chunks      = MEM_CALLOC(MEM_TERRAIN, (size_t)f->chunk_rows * f->chunk_cols, sizeof(Floor_Chunk*));
+  if(!f->chunks) {
+    LOG_ERROR("couldn't allocate a %dx%d floor.", rows, cols);
+    f->rows = f->cols = 0;
+    return ERROR;
+  }
 
   switch(f->number){
     default:
-      f->texture_p = al_load_bitmap("../assets/forest_texture.png");
+      f->tileset = SPR_FOREST_TILES;
       break;
   }
-  if(f->texture_p == NULL) {
-    printf("(generate_floor): ERROR loading floor texture sheet.\n");
+  return OK;
+}
+
+/*
+* Generate a rows x cols floor around the starting room. The floor must be
+* empty or destroyed, since its chunks are allocated here.
+*/
+int generate_floor(Floor* f, Game_Context* game, int floor_num, int rows, int cols, int init_row, int init_col) {
+  if(create_floor_map(f, floor_num, rows, cols) != OK) {
+    return ERROR;
   }
 
-  f->start_row = constrain(0, MAX_ROWS, MAX_ROWS/2 - (4 + f->number));
-  f->start_col = constrain(0, MAX_COLS, MAX_COLS/2 - (4 + f->number));
-  f->stop_row  = constrain(0, MAX_ROWS-1, MAX_ROWS/2 + (4 + f->number));
-  f->stop_col  = constrain(0, MAX_COLS-1, MAX_COLS/2 + (4 + f->number));
+  /* Whatever the last floor left in the game's mob handler is stale now */
+  game->mobs = default_mob_handler();
 
-  bsp_step(f->map, init_row, init_col, f->start_row, f->stop_row, f->start_col, f->stop_col);
-  //bsp_step(f->map, start_row, start_col, 5, MAX_ROWS-5, 5, MAX_COLS-5);
-  link_rooms(f->map);
+  /* Fill floor map with rooms:
+  *  Current Algorithm is using Binary Space Partitioning with the caveat of a starting square.
+  */
+  bsp_generate(f, game, init_row, init_col, 0, rows-1, 0, cols-1);
+  link_rooms(f);
 
   /* Once the floor layout is generated, Need to populate it with...stuff */
-  /* ALWAYS generate 1 key and 1 exit per floor */
-  distr_attribute(f, 1, R_KEY);
-  distr_attribute(f, 1, R_EXIT);
-  /*
-   * TODO: figure out a better method of calculating how many shops/challenge
-   * rooms to generate, here are some thoughts:
-   *  1. purely based off floor number rand(1, floor_num)
-   *  2. Based off the total number of available rooms on the floor
-   */
-  distr_attribute(f, rng_random_int(1, f->number+1), R_SHOP);
-  distr_attribute(f, rng_random_int(1, f->number), R_CHALLENGE);
-  printf("Generated Floor %d\n",f->number);
-  print_floor(f);
+  Room* start = floor_room(f, init_row, init_col);
+  if(start && start->is_initialized) {
+    place_special_rooms(f, game, start);
+  }
+  LOG_INFO("generated floor %d, %dx%d with %d rooms", f->number, f->rows, f->cols, f->room_count);
+  if(f->cols <= PRINT_FLOOR_MAX_COLS) {
+    print_floor(f);
+  }
+  return OK;
+}
+
+/*
+* Make a floor whose chunks were copied in from a save usable again. Pointers
+* in the rooms are stale, so every room gets the game's mob handler (holding
+* mobs) and the loaded room at row, col has its tiles rebuilt from the seed.
+* Returns the loaded room, or NULL if there is no room there.
+*/
+Room* relink_floor(Floor* f, Game_Context* game, const Mob_Handler* mobs, int row, int col) {
+  for(int c = 0; c < f->chunk_rows * f->chunk_cols; c++) {
+    Floor_Chunk* chunk = f->chunks[c];
+    if(!chunk) continue;
+    for(int i = 0; i < FLOOR_CHUNK_SIZE; i++) {
+      for(int j = 0; j < FLOOR_CHUNK_SIZE; j++) {
+        chunk->rooms[i][j].m_handler_p = &game->mobs;
+        chunk->rooms[i][j].tiles       = NULL;
+        chunk->rooms[i][j].is_loaded   = false;
+      }
+    }
+  }
+  Room* r = floor_room(f, row, col);
+  if(!r || !r->is_initialized) {
+    return NULL;
+  }
+  game->mobs = *mobs;
+  for(int i = 0; i < ABSOLUTE_MAX_MOBS; i++) {
+    bind_mob_functions(&game->mobs.mobs[i]);
+  }
+  build_room_tiles(r, &game->tiles);
+  r->tiles     = &game->tiles;
+  r->is_loaded = true;
+  return r;
 }
 
 /*
@@ -461,7 +720,19 @@ void generate_floor(Floor* f, int floor_num, int init_row, int init_col) {
 * Remove any artifacts from a floor that is no longer being used.
 */
 void destroy_floor(Floor* floor_p) {
-  al_destroy_bitmap(floor_p->texture_p);
+  /* Tile sets are owned by the texture atlas, only drop the reference */
+  floor_p->tileset = SPR_NONE;
+  if(floor_p->chunks) {
+    for(int c = 0; c < floor_p->chunk_rows * floor_p->chunk_cols; c++) {
+      mem_free(floor_p->chunks[c]);
+    }
+    mem_free(floor_p->chunks);
+  }
+  floor_p->chunks      = NULL;
+  floor_p->chunk_count = 0;
+  floor_p->room_count  = 0;
+  floor_p->rows        = 0;
+  floor_p->cols        = 0;
 }
 
 /*
@@ -471,7 +742,7 @@ void destroy_floor(Floor* floor_p) {
 * Update all artifacts of the current dungeon state including mobs and room
 * changes.
 */
-Room* update_dungeon_state(Floor* floor, Room* room, Mob* player) {
+Room* update_dungeon_state(Game_Context* game, Floor* floor, Room* room, Mob* player) {
   /*
   * No mobs on screen, means we can start checking to see if we need to change
   * rooms.
@@ -481,8 +752,8 @@ Room* update_dungeon_state(Floor* floor, Room* room, Mob* player) {
   if(room->m_handler_p->mob_count <= 0) {
     room->is_locked    = false;
     room->is_spawnable = false;
-    Room* new_room = change_rooms(floor->map, room, player);
-    if(strcmp(new_room->id, room->id) != 0) {
+    Room* new_room = change_rooms(game, floor, room, player);
+    if(new_room != room) {
       room = new_room;
       //print_floor(floor);
     }
@@ -497,61 +768,85 @@ Room* update_dungeon_state(Floor* floor, Room* room, Mob* player) {
   return room;
 }
 
-void draw_room(Room* r, ALLEGRO_BITMAP* room_texture_p, double delta_time) {
+/*
+* ==============
+* Get_Room_Walls
+* ==============
+* Fill walls with the solid boxes of a room: one slab just outside each edge,
+* plus any doorways. Returns the number of boxes written.
+*/
+int get_room_walls(Room* r, Hitbox walls[MAX_ROOM_WALLS]) {
+  int count = 0;
+  create_hitbox(&walls[count++], -WALL_THICKNESS, -WALL_THICKNESS, r->width + 2*WALL_THICKNESS, WALL_THICKNESS);
+  create_hitbox(&walls[count++], -WALL_THICKNESS, r->height, r->width + 2*WALL_THICKNESS, WALL_THICKNESS);
+  create_hitbox(&walls[count++], -WALL_THICKNESS, 0, WALL_THICKNESS, r->height);
+  create_hitbox(&walls[count++], r->width, 0, WALL_THICKNESS, r->height);
+
+  if(r->room_configuration[0] == 1) walls[count++] = r->north_door;
+  if(r->room_configuration[1] == 1) walls[count++] = r->south_door;
+  if(r->room_configuration[2] == 1) walls[count++] = r->east_door;
+  if(r->room_configuration[3] == 1) walls[count++] = r->west_door;
+  return count;
+}
+
+/*
+* Draw the tiles and doors of a room. Mobs are drawn separately by the caller,
+* since the render thread only sees copies of them.
+*/
+void draw_room(Room* r, Atlas_Sprite tileset) {
   if(!r->is_loaded) {
-    printf("(draw_room): Trying to display unloaded room: %s.\n", r->id);
+    LOG_ERROR("trying to display unloaded room: %s.", r->id);
+    exit(1);
+  }
+  if(atlas_frame_count(tileset) == 0) {
+    LOG_ERROR("provided tile set not loaded.");
     exit(1);
   }
-  if(!room_texture_p) {
-    printf("(draw_room): Provided texture map not loaded.\n");
+  if(!r->tiles) {
+    LOG_ERROR("room %s has no tiles.", r->id);
     exit(1);
   }
-  //al_draw_bitmap(r->map, 0, 0, 0);
-  /* draw tiles based on generated texture map */
+  /* draw tiles based on generated texture map, each tile id is an atlas frame */
   for(int i = 0; i < MAX_ROOM_WIDTH_IDX; i++) {
     for(int j = 0; j < MAX_ROOM_HEIGHT_IDX; j++) {
-      al_draw_bitmap_region(room_texture_p,
-                            (r->texture_map[i][j]%4)*PX_PER_TILE,
-                            floor(r->texture_map[i][j]/4)*PX_PER_TILE,
-                            PX_PER_TILE,
-                            PX_PER_TILE,
-                            i * PX_PER_TILE,
-                            j * PX_PER_TILE,
-                            0);
+      atlas_draw_frame(tileset, r->tiles->texture_map[i][j], i * PX_PER_TILE, j * PX_PER_TILE, 0);
     }
   }
 
-  if(r->m_handler_p->is_initialized) {
-    draw_all_active_mobs(r->m_handler_p, delta_time);
-  }
-
   /* draw doors of the room as well in order: N, S, E, W */
   if(!r->is_locked) {
     if(r->room_configuration[0] == 1) {
-      al_draw_rotated_bitmap(r->door, 0, DOOR_HEIGHT/2, r->width/2, 0, ALLEGRO_PI/2, 0);
+      atlas_draw_rotated_frame(SPR_DOOR, 0, 0, DOOR_HEIGHT/2, r->width/2, 0, ALLEGRO_PI/2, 0);
     }
     if(r->room_configuration[1] == 1) {
-      al_draw_rotated_bitmap(r->door, 0, DOOR_HEIGHT/2, r->width/2, r->height - DOOR_WIDTH, ALLEGRO_PI/2, ALLEGRO_FLIP_HORIZONTAL);
+      atlas_draw_rotated_frame(SPR_DOOR, 0, 0, DOOR_HEIGHT/2, r->width/2, r->height - DOOR_WIDTH, ALLEGRO_PI/2, ALLEGRO_FLIP_HORIZONTAL);
     }
     if(r->room_configuration[2] == 1) {
-      al_draw_bitmap(r->door, r->width - DOOR_WIDTH, r->height/2 - DOOR_HEIGHT/2, ALLEGRO_FLIP_HORIZONTAL);
+      atlas_draw_frame(SPR_DOOR, 0, r->width - DOOR_WIDTH, r->height/2 - DOOR_HEIGHT/2, ALLEGRO_FLIP_HORIZONTAL);
     }
     if(r->room_configuration[3] == 1) {
-      al_draw_bitmap(r->door, 0, r->height/2 - DOOR_HEIGHT/2, 0);
+      atlas_draw_frame(SPR_DOOR, 0, 0, r->height/2 - DOOR_HEIGHT/2, 0);
     }
   }
 }
 
+/*
+* Log the floor layout at debug level, one record per row. The rows aren't
+* rate limited since they only make sense together.
+*/
 void print_floor(Floor* f) {
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
   char room_token;
-  for(int i = 0; i < MAX_ROWS; ++i){
-    printf("%02d. |", i);
-    for(int j = 0; j < MAX_COLS; ++j) {
-      if(f->map[i][j].is_loaded) {
+  char line[PRINT_FLOOR_MAX_COLS + 1];
+  for(int i = 0; i < f->rows; ++i){
+    int length = 0;
+    for(int j = 0; j < f->cols && j < PRINT_FLOOR_MAX_COLS; ++j) {
+      Room* r = floor_room(f, i, j);
+      if(r && r->is_loaded) {
         room_token = 'P';
       }
-      else if(f->map[i][j].is_initialized) {
-        switch(f->map[i][j].type) {
+      else if(r && r->is_initialized) {
+        switch(r->type) {
           case R_BASIC:
             room_token = '.';
             break;
@@ -584,8 +879,10 @@ void print_floor(Floor* f) {
       else {
         room_token = ' ';
       }
-      printf("%c", room_token);
+      line[length++] = room_token;
     }
-    printf("|\n");
+    line[length] = '\0';
+    log_write(LOG_LEVEL_DEBUG, __func__, NULL, "%02d. |%s|", i, line);
   }
+#endif
 }
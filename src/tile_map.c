@@ -0,0 +1,164 @@
+/* Standard Includes */
+#include <math.h>
+#include <string.h>
+
+/* Local Includes */
+#include "tile_map.h"
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+/* Bits first..last (inclusive) set, 0 <= first <= last < 32 */
+static uint32_t span_mask(int first, int last) {
+    uint32_t upper = (last >= 31)? 0xFFFFFFFFu : ((1u << (last + 1)) - 1);
+    return upper & ~((1u << first) - 1);
+}
+
+static int tile_of(Solid_Map* map, float px) {
+    return (int)floorf(px / map->tile_size);
+}
+
+typedef struct raycast_state {
+    Solid_Map* map;
+    int col, row;
+    double t;
+} Raycast_State;
+
+static bool raycast_visit(int col, int row, double t, void* ctx) {
+    Raycast_State* state = ctx;
+    if(!solid_map_tile(state->map, col, row)) {
+        return false;
+    }
+    state->col = col;
+    state->row = row;
+    state->t   = t;
+    return true;
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void solid_map_initialize(Solid_Map* map, int cols, int rows, int tile_size) {
+    memset(map, 0, sizeof(Solid_Map));
+    map->cols      = (cols < SOLID_MAP_MAX_COLS)? cols : SOLID_MAP_MAX_COLS;
+    map->rows      = (rows < SOLID_MAP_MAX_ROWS)? rows : SOLID_MAP_MAX_ROWS;
+    map->tile_size = tile_size;
+}
+
+void solid_map_set(Solid_Map* map, int col, int row, bool solid) {
+    if(col < 0 || row < 0 || col >= map->cols || row >= map->rows) {
+        return;
+    }
+    if(solid) {
+        map->bits[row] |= 1u << col;
+    } else {
+        map->bits[row] &= ~(1u << col);
+    }
+}
+
+/*
+* Open up every tile the box touches, used to cut doorways into walls.
+*/
+void solid_map_clear_box(Solid_Map* map, Hitbox* box) {
+    int c0 = tile_of(map, box->x);
+    int c1 = tile_of(map, box->x + box->width - 1);
+    int r0 = tile_of(map, box->y);
+    int r1 = tile_of(map, box->y + box->height - 1);
+    for(int r = r0; r <= r1; r++) {
+        for(int c = c0; c <= c1; c++) {
+            solid_map_set(map, c, r, false);
+        }
+    }
+}
+
+bool solid_map_tile(Solid_Map* map, int col, int row) {
+    if(col < 0 || row < 0 || col >= map->cols || row >= map->rows) {
+        return true;
+    }
+    return (map->bits[row] >> col) & 1;
+}
+
+bool solid_map_point(Solid_Map* map, float x, float y) {
+    return solid_map_tile(map, tile_of(map, x), tile_of(map, y));
+}
+
+/*
+* Does the box overlap any solid tile? One mask test per tile row covered.
+*/
+bool solid_map_box(Solid_Map* map, Hitbox* box) {
+    int c0 = tile_of(map, box->x);
+    int c1 = tile_of(map, box->x + box->width - 1);
+    int r0 = tile_of(map, box->y);
+    int r1 = tile_of(map, box->y + box->height - 1);
+    if(c0 < 0 || r0 < 0 || c1 >= map->cols || r1 >= map->rows) {
+        return true;
+    }
+    uint32_t mask = span_mask(c0, c1);
+    for(int r = r0; r <= r1; r++) {
+        if(map->bits[r] & mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+* Visit the tiles under the segment (x0,y0)->(x1,y1) in order (Amanatides-Woo
+* DDA), with t the fraction of the segment at which each tile is entered.
+* Returns true if the visitor stopped the walk.
+*/
+bool solid_map_walk(Solid_Map* map, float x0, float y0, float x1, float y1, Tile_Visitor visit, void* ctx) {
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    int col = tile_of(map, x0);
+    int row = tile_of(map, y0);
+
+    int step_col = (dx > 0) - (dx < 0);
+    int step_row = (dy > 0) - (dy < 0);
+    double t_max_x   = (dx != 0)? (((col + (step_col > 0)) * map->tile_size) - x0) / dx : INFINITY;
+    double t_max_y   = (dy != 0)? (((row + (step_row > 0)) * map->tile_size) - y0) / dy : INFINITY;
+    double t_delta_x = (dx != 0)? map->tile_size / fabs(dx) : INFINITY;
+    double t_delta_y = (dy != 0)? map->tile_size / fabs(dy) : INFINITY;
+    double t = 0;
+
+    while(true) {
+        if(visit(col, row, t, ctx)) {
+            return true;
+        }
+        if(t_max_x < t_max_y) {
+            t = t_max_x;
+            t_max_x += t_delta_x;
+            col += step_col;
+        } else {
+            t = t_max_y;
+            t_max_y += t_delta_y;
+            row += step_row;
+        }
+        if(t > 1.0) {
+            return false;
+        }
+    }
+}
+
+/*
+* First solid tile along the segment. A segment that starts inside a solid
+* tile hits it at t = 0. Returns false if the whole segment is clear.
+*/
+bool solid_map_raycast(Solid_Map* map, float x0, float y0, float x1, float y1, Tile_Hit* hit) {
+    Raycast_State state = { .map = map };
+    if(!solid_map_walk(map, x0, y0, x1, y1, raycast_visit, &state)) {
+        return false;
+    }
+    if(hit) {
+        hit->col = state.col;
+        hit->row = state.row;
+        hit->t   = state.t;
+        hit->x   = x0 + (x1 - x0) * state.t;
+        hit->y   = y0 + (y1 - y0) * state.t;
+    }
+    return true;
+}
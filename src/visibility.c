@@ -0,0 +1,209 @@
+/* Standard Includes */
+#include <string.h>
+#include <math.h>
+
+/* Local Includes */
+#include "visibility.h"
+#include "collisions.h"
+
+#define BUCKET_OVERFLOW 0xFF
+
+/*
+ *******************************************************************************
+ * Internally Visible Functions
+ *******************************************************************************
+*/
+static uint32_t hash_ints(const int* values, int count, uint32_t h) {
+    for(int i = 0; i < count; i++) {
+        h ^= (uint32_t)values[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool is_blocker(Mob* m) {
+    return m->type != DEFAULT && m->current_state != DEAD;
+}
+
+/*
+* Bucket every live mob under the tiles its hitbox covers, and hash their
+* boxes so we know whether cached answers still hold.
+*/
+static uint32_t bucket_mobs(Visibility_Service* vs) {
+    uint32_t signature = 2166136261u;
+    memset(vs->occupied, 0, sizeof(vs->occupied));
+    memset(vs->bucket_count, 0, sizeof(vs->bucket_count));
+
+    Mob_Handler* handler = vs->handler;
+    if(!handler || !handler->is_initialized) {
+        return signature;
+    }
+    int ts = vs->tiles->tile_size;
+    for(int i = 0; i < handler->local_max_mobs; i++) {
+        Mob* m = &handler->mobs[i];
+        if(!is_blocker(m)) continue;
+        int box[5] = {i, m->hb.x, m->hb.y, m->hb.width, m->hb.height};
+        signature = hash_ints(box, 5, signature);
+
+        int c0 = m->hb.x / ts, c1 = (m->hb.x + m->hb.width) / ts;
+        int r0 = m->hb.y / ts, r1 = (m->hb.y + m->hb.height) / ts;
+        for(int r = r0; r <= r1; r++) {
+            if(r < 0 || r >= vs->tiles->rows) continue;
+            for(int c = c0; c <= c1; c++) {
+                if(c < 0 || c >= vs->tiles->cols) continue;
+                vs->occupied[r] |= 1u << c;
+                uint8_t* count = &vs->bucket_count[r][c];
+                if(*count == BUCKET_OVERFLOW) continue;
+                if(*count == VIS_BUCKET_SIZE) {
+                    *count = BUCKET_OVERFLOW;
+                    continue;
+                }
+                vs->bucket[r][c][(*count)++] = i;
+            }
+        }
+    }
+    return signature;
+}
+
+typedef struct trace {
+    Visibility_Service* vs;
+    Visibility_Query* q;
+    int start_col, start_row, end_col, end_row;
+} Trace;
+
+static bool segment_hits_mob(Trace* tr, int index) {
+    Visibility_Query* q = tr->q;
+    if(index == q->ignore_a || index == q->ignore_b) {
+        return false;
+    }
+    tr->vs->stats.mob_tests++;
+    Hitbox point = {q->from_x, q->from_y, 0, 0};
+    double toi;
+    return swept_collision(&point, q->to_x - q->from_x, q->to_y - q->from_y, &tr->vs->handler->mobs[index].hb, &toi);
+}
+
+/*
+* Tile visitor: stop at the first wall or mob in the way. The tiles holding
+* the endpoints never block, so mobs standing on wall art can still see.
+*/
+static bool trace_visit(int col, int row, double t, void* ctx) {
+    Trace* tr = ctx;
+    Visibility_Service* vs = tr->vs;
+    vs->stats.tiles_walked++;
+    bool endpoint = (col == tr->start_col && row == tr->start_row) || (col == tr->end_col && row == tr->end_row);
+    if(!endpoint && solid_map_tile(vs->tiles, col, row)) {
+        return true;
+    }
+    if(col < 0 || row < 0 || col >= vs->tiles->cols || row >= vs->tiles->rows) {
+        return false;
+    }
+    if(!((vs->occupied[row] >> col) & 1)) {
+        return false;
+    }
+    if(vs->bucket_count[row][col] == BUCKET_OVERFLOW) {
+        for(int i = 0; i < vs->handler->local_max_mobs; i++) {
+            if(is_blocker(&vs->handler->mobs[i]) && segment_hits_mob(tr, i)) return true;
+        }
+        return false;
+    }
+    for(int k = 0; k < vs->bucket_count[row][col]; k++) {
+        if(segment_hits_mob(tr, vs->bucket[row][col][k])) return true;
+    }
+    return false;
+}
+
+static bool trace_query(Visibility_Service* vs, Visibility_Query* q) {
+    int ts = vs->tiles->tile_size;
+    Trace tr = {
+        .vs        = vs,
+        .q         = q,
+        .start_col = (int)floorf(q->from_x / ts),
+        .start_row = (int)floorf(q->from_y / ts),
+        .end_col   = (int)floorf(q->to_x / ts),
+        .end_row   = (int)floorf(q->to_y / ts)
+    };
+    return !solid_map_walk(vs->tiles, q->from_x, q->from_y, q->to_x, q->to_y, trace_visit, &tr);
+}
+
+/*
+ *******************************************************************************
+ * Externally Visible Functions
+ *******************************************************************************
+*/
+void visibility_initialize(Visibility_Service* vs) {
+    memset(vs, 0, sizeof(Visibility_Service));
+    vs->generation = 1;
+}
+
+/*
+* Start a new batch against the given room. If any blocker moved, or the room
+* changed, every cached answer is dropped by bumping the cache generation.
+* Every room shares one tile buffer, so a room change is seen through the
+* generation its tiles were built with rather than their address.
+*/
+void visibility_begin(Visibility_Service* vs, Solid_Map* tiles, uint32_t tiles_generation, Mob_Handler* handler) {
+    if(tiles_generation != vs->tiles_generation) {
+        vs->tiles_generation = tiles_generation;
+        vs->generation++;
+    }
+    vs->tiles       = tiles;
+    vs->handler     = handler;
+    vs->query_count = 0;
+    memset(&vs->stats, 0, sizeof(Visibility_Stats));
+
+    uint32_t signature = bucket_mobs(vs);
+    if(signature != vs->blocker_signature) {
+        vs->blocker_signature = signature;
+        vs->generation++;
+    }
+}
+
+/*
+* Returns a handle for visibility_result, or -1 if the batch is full.
+*/
+int visibility_add_query(Visibility_Service* vs, float from_x, float from_y, float to_x, float to_y, int ignore_a, int ignore_b) {
+    if(vs->query_count >= VIS_MAX_QUERIES) {
+        return -1;
+    }
+    Visibility_Query* q = &vs->queries[vs->query_count];
+    q->from_x   = from_x;
+    q->from_y   = from_y;
+    q->to_x     = to_x;
+    q->to_y     = to_y;
+    q->ignore_a = ignore_a;
+    q->ignore_b = ignore_b;
+    q->visible  = false;
+    return vs->query_count++;
+}
+
+/*
+* Answer every query in the batch, from the cache where possible.
+*/
+void visibility_resolve(Visibility_Service* vs) {
+    if(!vs->tiles) {
+        return;
+    }
+    for(int i = 0; i < vs->query_count; i++) {
+        Visibility_Query* q = &vs->queries[i];
+        int key[6] = {q->from_x, q->from_y, q->to_x, q->to_y, q->ignore_a, q->ignore_b};
+        Visibility_Cache_Entry* entry = &vs->cache[hash_ints(key, 6, 2166136261u) & (VIS_CACHE_SIZE - 1)];
+        vs->stats.queries++;
+
+        if(entry->generation == vs->generation && memcmp(entry->key, key, sizeof(key)) == 0) {
+            q->visible = entry->visible;
+            vs->stats.cache_hits++;
+            continue;
+        }
+        q->visible = trace_query(vs, q);
+        memcpy(entry->key, key, sizeof(key));
+        entry->generation = vs->generation;
+        entry->visible    = q->visible;
+    }
+}
+
+bool visibility_result(Visibility_Service* vs, int query) {
+    if(query < 0 || query >= vs->query_count) {
+        return false;
+    }
+    return vs->queries[query].visible;
+}